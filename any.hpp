@@ -2,8 +2,73 @@
 #define ANY_H
 
 #include <cstddef>
+#include <cstdint>
 #include <type_traits>
 #include <utility>
+#include <new>
+#include <cstring>
+#include <atomic>
+#include <typeindex>   // declares std::hash, without the <functional> and <string> weight
+
+#if __cplusplus >= 202002L
+#include <bit>
+#endif
+
+/* 
+ * Exception-free mode: defined automatically when compiling with -fno-exceptions 
+ * (or explicitly by the user). Failures are reported through AnyError / AnyExpected
+ * and the remaining fatal paths abort instead of throwing.
+ */
+#if !defined(ANY_NO_EXCEPTIONS) && !defined(__cpp_exceptions) && !defined(__EXCEPTIONS) && !defined(_CPPUNWIND)
+#define ANY_NO_EXCEPTIONS
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define ANY_COLD __attribute__((cold, noinline))
+#elif defined(_MSC_VER)
+#define ANY_COLD __declspec(noinline)
+#else
+#define ANY_COLD
+#endif
+
+/*
+ * C++20 constexpr subset: construction, copy, Is and GetValue of the types with AnyConstexprStorable
+ * stored in the small buffer are usable in constant expressions. Other types, including literal types
+ * that aren't trivially copyable, can't be stored in a constant expression (the compiler reports a call
+ * to detail::TypeNotStorableInConstantExpression).
+ * Not available in profiling and sampling modes, the counters can't be updated at compile time.
+ */
+#if defined(__cpp_lib_bit_cast) && defined(__cpp_lib_is_constant_evaluated) && defined(__cpp_constexpr_dynamic_alloc) && !defined(ANY_PROFILE) && !defined(ANY_SAMPLE)
+#define ANY_CONSTEXPR_ANY
+#define ANY_CONSTEXPR20 constexpr
+#else
+#define ANY_CONSTEXPR20
+#endif
+
+// profiling mode: stores, copies and moves are counted by SIZE, tag and type size (see any_profile.hpp)
+#ifdef ANY_PROFILE
+#include "any_profile.hpp"
+#define ANY_PROFILE_EVENT(event, typeSize, count) detail::Profile(detail::ProfileEvent::event, SIZE, typeSize, count)
+#else
+#define ANY_PROFILE_EVENT(event, typeSize, count) ((void)0)
+#endif
+
+// sampling mode: cycles spent in copies, moves and destructions (see any_sampling.hpp)
+#ifdef ANY_SAMPLE
+#include "any_sampling.hpp"
+#define ANY_SAMPLE_SCOPE(op, type) detail::SampleScope anySampleScope(AnySampleOp::op, type, SIZE)
+#else
+#define ANY_SAMPLE_SCOPE(op, type)
+#endif
+
+// used to pad concurrently accessed Any objects to avoid false sharing
+#ifndef ANY_CACHE_LINE_SIZE
+#define ANY_CACHE_LINE_SIZE 64
+#endif
+
+#ifdef ANY_NO_EXCEPTIONS
+#include <cstdlib>
+#else
 #include <exception>
 
 class BadCastException : public std::exception
@@ -14,9 +79,663 @@ public:
         return "wrong type from Get";
     }
 };
+#endif
 
 using std::size_t;
 
+enum class AnyError
+{
+    None,
+    Empty,          // Any doesn't contain an object
+    BadCast,        // Any contains an object of a different type
+    OutOfMemory,    // heap allocation of the object failed
+    Construction    // type-erased construction of the object failed
+};
+
+/*
+ * Placement of a type in Any, specialize AnyStoragePolicy to override the default:
+ *   Default  in the small buffer if the type fits (size and alignment), allocated otherwise
+ *   Inline   always in the small buffer, it's an error if the type doesn't fit
+ *   Heap     always allocated, e.g. for types with throwing moves or large rarely moved types
+ *   Shared   allocated and reference counted, copies of the Any share the object: changes through
+ *            non-const Get/TryGet are seen by all the copies (synchronize them across threads),
+ *            assigning a value to an Any gives it a new object
+ */
+enum class AnyStorage : unsigned char
+{
+    Default,
+    Inline,
+    Heap,
+    Shared
+};
+
+template <typename T>
+struct AnyStoragePolicy : std::integral_constant<AnyStorage, AnyStorage::Default> {};
+
+/*
+ * Types whose destruction is expensive whatever their size (deep trees, big maps), specialize to 
+ * std::true_type to have their heap payloads destroyed by the thread's AnyDeferredDestroyer if any.
+ */
+template <typename T>
+struct AnyDeferredDestruction : std::false_type {};
+
+/*
+ * Types an Any can hold in constant expressions (C++20), where the object is bit_cast into the small
+ * buffer: trivially copyable, without pointers (even as members) and without padding bits, which would
+ * leave the buffer partly uninitialized. Padding is ruled out by std::has_unique_object_representations,
+ * which is also false for floating-point members: specialize to std::true_type for structs with 
+ * floating-point members and no padding.
+ */
+template <typename T>
+struct AnyConstexprStorable : std::bool_constant<std::is_trivially_copyable<T>::value && !std::is_pointer<T>::value && !std::is_member_pointer<T>::value &&
+    (std::has_unique_object_representations<T>::value || std::is_same<T, float>::value || std::is_same<T, double>::value)> {};
+
+namespace detail
+{
+    // std::string, std::string_view and the like, recognized by their interface to avoid including <string>
+    template <typename T, typename = void>
+    struct IsCharString : std::false_type {};
+
+    template <typename T>
+    struct IsCharString<T, std::void_t<typename T::traits_type, decltype(std::declval<const T&>().size())>> : 
+        std::bool_constant<std::is_same<typename T::value_type, char>::value && std::is_same<decltype(std::declval<const T&>().data()), const char*>::value> {};
+}
+
+/*
+ * Hashing and equality of a type (Any::Hash and Any::Equals, MemoCache keys), opt-in so that storing
+ * a type only instantiates its copy, move and destruction: specialize to std::true_type for types with
+ * a std::hash specialization and operator==. The arithmetic, enumeration, pointer and char string types are
+ * hashable by default, with hashes of their own rather than std::hash (which would need <functional>).
+ */
+template <typename T>
+struct AnyHashable : std::bool_constant<std::is_arithmetic<T>::value || std::is_enum<T>::value || std::is_pointer<T>::value || detail::IsCharString<T>::value> {};
+
+/*
+ * Text formatting of a type (AnyFormat in any_format.hpp, AnyJsonWriter), opt-in as well: the arithmetic,
+ * character and string types are formattable, specialize AnyFormatter to make other types formattable:
+ *   static size_t Format(const T &object, char *buffer, size_t size)   writes at most size chars (not 
+ *                                                                      terminated), returns the full length
+ *   static constexpr bool TEXT                                         the output is text rather than a literal
+ *                                                                      (quoted in structured formats like JSON)
+ * Formatting must not allocate, it's used on logging hot paths.
+ */
+template <typename T, typename = void>
+struct AnyFormatter {};
+
+namespace detail
+{
+    // throw paths are kept out-of-line and cold so that they don't bloat the callers' hot paths
+    [[noreturn]] inline ANY_COLD void ThrowBadCast()
+    {
+    #ifdef ANY_NO_EXCEPTIONS
+        std::abort();
+    #else
+        throw BadCastException();
+    #endif
+    }
+
+    [[noreturn]] inline ANY_COLD void ThrowBadAlloc()
+    {
+    #ifdef ANY_NO_EXCEPTIONS
+        std::abort();
+    #else
+        throw std::bad_alloc();
+    #endif
+    }
+
+    // types formatted by any_format.hpp rather than by a descriptor operation, so that any.hpp doesn't need <charconv>
+    enum class Builtin : unsigned char
+    {
+        None,
+        Bool,
+        Char,
+        Signed,     // integers up to 64 bits
+        Unsigned,
+        Float,
+        Double,
+        LongDouble,
+        CString     // const char*
+    };
+
+    /*
+     * Type descriptor (vtable) of the object contained in an Any. There's one descriptor per type, 
+     * shared by all Any<SIZE> instantiations, and it's a plain aggregate of function pointers so it's 
+     * constant-initialized. Trivially copyable types don't instantiate any function: their operations
+     * are nullptr and Any copies/relocates them as bytes using the descriptor size.
+     */
+    struct VTable
+    {
+        size_t size;
+        size_t alignment;
+        AnyStorage storage;
+
+        void (*copy)(void *to, const void *from);   // copy construct in place
+        void (*move)(void *to, void *from);         // move construct in place and destroy source (relocation)
+        void (*destroy)(void *object);              // destroy in place
+
+        // optional operations, nullptr unless the type opts in (AnyHashable, AnyFormatter)
+        size_t (*hash)(const void *object);                  // std::hash, built-in hash of the default AnyHashable types
+        bool (*equal)(const void *a, const void *b);         // operator==
+        size_t (*format)(const void *object, char *buffer, size_t size);  // AnyFormatter, char strings
+        Builtin builtin;                                     // formatted by any_format.hpp if format is nullptr
+        bool text;                                           // AnyFormatter::TEXT
+        bool deferred;                                       // AnyDeferredDestruction
+    };
+
+    template <typename T, typename = void>
+    struct IsHashable : std::false_type {};
+
+    template <typename T>
+    struct IsHashable<T, std::void_t<decltype(std::hash<T>()(std::declval<const T&>()))>> : std::true_type {};
+
+    template <typename T, typename = void>
+    struct IsEqualityComparable : std::false_type {};
+
+    template <typename T>
+    struct IsEqualityComparable<T, std::void_t<decltype(bool(std::declval<const T&>() == std::declval<const T&>()))>> : std::true_type {};
+
+    template <typename T>
+    void CopyT(void *to, const void *from)
+    {
+        ::new(to) T(*static_cast<const T*>(from));
+    }
+
+    template <typename T>
+    void MoveT(void *to, void *from)
+    {
+        T *source = static_cast<T*>(from);
+
+        ::new(to) T(std::move(*source));
+        source->~T();
+    }
+
+    template <typename T>
+    void DestroyT(void *object)
+    {
+        static_cast<T*>(object)->~T();
+    }
+
+    template <typename T>
+    size_t HashT(const void *object)
+    {
+        return std::hash<T>()(*static_cast<const T*>(object));
+    }
+
+    inline size_t MixHash(std::uint64_t bits)
+    {
+        bits ^= bits >> 33;
+        bits *= 0xff51afd7ed558ccdull;
+        bits ^= bits >> 33;
+
+        return static_cast<size_t>(bits);
+    }
+
+    template <typename T>
+    size_t HashScalarT(const void *object)
+    {
+        const T &value = *static_cast<const T*>(object);
+
+        if constexpr (std::is_floating_point<T>::value)
+        {
+            if (value == 0)
+                return MixHash(0);  // 0.0 == -0.0
+
+            // long double is hashed as double, its padding bytes are unspecified
+            using Bits = std::conditional_t<sizeof(T) == sizeof(std::uint32_t), std::uint32_t, std::uint64_t>;
+            using Float = std::conditional_t<sizeof(T) == sizeof(std::uint32_t), float, double>;
+
+            const Float rounded = static_cast<Float>(value);
+            Bits bits;
+
+            std::memcpy(&bits, &rounded, sizeof(bits));
+
+            return MixHash(bits);
+        }
+        else if constexpr (std::is_pointer<T>::value)
+            return MixHash(reinterpret_cast<std::uintptr_t>(value));
+        else if constexpr (std::is_enum<T>::value)
+            return MixHash(static_cast<std::uint64_t>(static_cast<std::underlying_type_t<T>>(value)));
+        else
+            return MixHash(static_cast<std::uint64_t>(value));
+    }
+
+    // FNV-1a
+    template <typename T>
+    size_t HashCharsT(const void *object)
+    {
+        const T &text = *static_cast<const T*>(object);
+        std::uint64_t hash = 0xcbf29ce484222325ull;
+
+        for (size_t i = 0; i < text.size(); i++)
+            hash = (hash ^ static_cast<unsigned char>(text.data()[i])) * 0x100000001b3ull;
+
+        return static_cast<size_t>(hash);
+    }
+
+    template <typename T>
+    bool EqualT(const void *a, const void *b)
+    {
+        return *static_cast<const T*>(a) == *static_cast<const T*>(b);
+    }
+
+    template <typename T>
+    constexpr size_t (*HashFor())(const void*)
+    {
+        if constexpr (!AnyHashable<T>::value)
+            return nullptr;
+        else if constexpr (std::is_arithmetic<T>::value || std::is_enum<T>::value || std::is_pointer<T>::value)
+            return &HashScalarT<T>;
+        else if constexpr (IsCharString<T>::value)
+            return &HashCharsT<T>;
+        else
+        {
+            static_assert(IsHashable<T>::value, "type declared AnyHashable without a std::hash specialization");
+
+            return &HashT<T>;
+        }
+    }
+
+    template <typename T>
+    constexpr bool (*EqualFor())(const void*, const void*)
+    {
+        if constexpr (AnyHashable<T>::value)
+        {
+            static_assert(IsEqualityComparable<T>::value, "type declared AnyHashable without operator==");
+
+            return &EqualT<T>;
+        }
+        else
+            return nullptr;
+    }
+
+    template <typename T, typename = void>
+    struct IsFormattable : std::false_type {};
+
+    template <typename T>
+    struct IsFormattable<T, std::void_t<decltype(AnyFormatter<T>::Format(std::declval<const T&>(), std::declval<char*>(), size_t()))>> : std::true_type {};
+
+    template <typename T>
+    size_t FormatT(const void *object, char *buffer, size_t size)
+    {
+        return AnyFormatter<T>::Format(*static_cast<const T*>(object), buffer, size);
+    }
+
+    template <typename T>
+    constexpr Builtin BuiltinOf()
+    {
+        if constexpr (std::is_same<T, bool>::value)
+            return Builtin::Bool;
+        else if constexpr (std::is_same<T, char>::value)
+            return Builtin::Char;
+        else if constexpr (std::is_same<T, const char*>::value)
+            return Builtin::CString;
+        else if constexpr (std::is_same<T, float>::value)
+            return Builtin::Float;
+        else if constexpr (std::is_same<T, double>::value)
+            return Builtin::Double;
+        else if constexpr (std::is_same<T, long double>::value)
+            return Builtin::LongDouble;
+        else if constexpr (std::is_integral<T>::value && sizeof(T) <= sizeof(std::uint64_t))
+            return std::is_signed<T>::value ? Builtin::Signed : Builtin::Unsigned;
+        else
+            return Builtin::None;
+    }
+
+    // copies text to buffer (truncated to size) and returns its full length
+    inline size_t FormatText(const char *text, size_t length, char *buffer, size_t size)
+    {
+        if (size)
+            std::memcpy(buffer, text, length < size ? length : size);
+
+        return length;
+    }
+
+    template <typename T>
+    size_t FormatCharsT(const void *object, char *buffer, size_t size)
+    {
+        const T &text = *static_cast<const T*>(object);
+
+        return FormatText(text.data(), text.size(), buffer, size);
+    }
+
+    template <typename T>
+    constexpr size_t (*FormatFor())(const void*, char*, size_t)
+    {
+        if constexpr (IsFormattable<T>::value)
+            return &FormatT<T>;
+        else if constexpr (IsCharString<T>::value)
+            return &FormatCharsT<T>;
+        else
+            return nullptr;
+    }
+
+    template <typename T>
+    constexpr bool FormatsText()
+    {
+        if constexpr (IsFormattable<T>::value)
+            return AnyFormatter<T>::TEXT;
+        else
+            return IsCharString<T>::value || BuiltinOf<T>() == Builtin::Char || BuiltinOf<T>() == Builtin::CString;
+    }
+
+    template <typename T>
+    struct VTableFor
+    {
+        static constexpr bool trivial = std::is_trivially_copyable<T>::value;
+
+        static constexpr VTable value = 
+        {
+            sizeof(T), 
+            alignof(T),
+            AnyStoragePolicy<T>::value,
+            trivial ? nullptr : &CopyT<T>,
+            trivial ? nullptr : &MoveT<T>,
+            std::is_trivially_destructible<T>::value ? nullptr : &DestroyT<T>,
+            HashFor<T>(),
+            EqualFor<T>(),
+            FormatFor<T>(),
+            BuiltinOf<T>(),
+            FormatsText<T>(),
+            AnyDeferredDestruction<T>::value
+        };
+    };
+
+#ifdef ANY_CONSTEXPR_ANY
+    // not constexpr: called in a constant expression, it reports a type without AnyConstexprStorable
+    inline void TypeNotStorableInConstantExpression() {}
+
+    // an object followed by zero bytes up to the size of the small buffer, so it can be bit_cast to and from it
+    template <typename T, size_t PADDING>
+    struct PaddedObject
+    {
+        T object;
+        unsigned char padding[PADDING]{};
+    };
+
+    template <typename T>
+    struct PaddedObject<T, 0>
+    {
+        T object;
+    };
+
+    template <typename Storage, typename T>
+    constexpr Storage ToStorage(const T &object)
+    {
+        using Padded = PaddedObject<T, sizeof(Storage) - sizeof(T)>;
+        static_assert(sizeof(Padded) == sizeof(Storage), "object can't be stored in a constant expression");
+
+        return std::bit_cast<Storage>(Padded{object});
+    }
+
+    template <typename T, typename Storage>
+    constexpr T FromStorage(const Storage &storage)
+    {
+        return std::bit_cast<PaddedObject<T, sizeof(Storage) - sizeof(T)>>(storage).object;
+    }
+#endif
+
+    /**** heap path ****/
+    inline void *Allocate(size_t size, size_t alignment, std::nothrow_t)
+    {
+        if (alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+            return ::operator new(size, std::align_val_t(alignment), std::nothrow);
+        else
+            return ::operator new(size, std::nothrow);
+    }
+
+    inline void *Allocate(size_t size, size_t alignment)
+    {
+    #ifdef ANY_NO_EXCEPTIONS
+        return Allocate(size, alignment, std::nothrow);
+    #else
+        if (alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+            return ::operator new(size, std::align_val_t(alignment));
+        else
+            return ::operator new(size);
+    #endif
+    }
+
+    // matches Allocate and global new-expressions
+    inline void Deallocate(void *object, size_t alignment)
+    {
+        if (alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+            ::operator delete(object, std::align_val_t(alignment));
+        else
+            ::operator delete(object);
+    }
+
+    // returns nullptr instead of throwing in exception-free mode
+    template <typename T, typename... Args>
+    T *New(Args &&...args)
+    {
+    #ifdef ANY_NO_EXCEPTIONS
+        return ::new(std::nothrow) T(std::forward<Args>(args)...);
+    #else
+        return ::new T(std::forward<Args>(args)...);
+    #endif
+    }
+
+    inline void Copy(const VTable *vTable, void *to, const void *from)
+    {
+        if (vTable->copy)
+            vTable->copy(to, from);
+        else
+            std::memcpy(to, from, vTable->size);
+    }
+
+    inline void *HeapCopy(const VTable *vTable, const void *from)
+    {
+        void *object = Allocate(vTable->size, vTable->alignment);
+
+        if (!object)  // allocation can only fail in exception-free mode
+            return nullptr;
+
+    #ifdef ANY_NO_EXCEPTIONS
+        Copy(vTable, object, from);
+    #else
+        try
+        {
+            Copy(vTable, object, from);
+        }
+        catch (...)
+        {
+            Deallocate(object, vTable->alignment);
+            throw;
+        }
+    #endif
+
+        return object;
+    }
+
+    inline void HeapDestroy(const VTable *vTable, void *object)
+    {
+        if (vTable->destroy)
+            vTable->destroy(object);
+
+        Deallocate(object, vTable->alignment);
+    }
+
+    /**** shared path: payloads are [padding | reference count | object] ****/
+    using SharedCount = std::atomic<size_t>;
+
+    constexpr size_t SharedAlignment(size_t alignment)
+    {
+        return alignment > alignof(SharedCount) ? alignment : alignof(SharedCount);
+    }
+
+    constexpr size_t SharedHeaderSize(size_t alignment)
+    {
+        return SharedAlignment(alignment) > sizeof(SharedCount) ? SharedAlignment(alignment) : sizeof(SharedCount);
+    }
+
+    // address arithmetic on integers, GCC can't tell shared payloads from the others when inlining Destroy
+    inline SharedCount &ReferencesOf(void *object)
+    {
+        return *reinterpret_cast<SharedCount*>(reinterpret_cast<uintptr_t>(object) - sizeof(SharedCount));
+    }
+
+    // allocates a payload with one reference, the object isn't constructed
+    inline void *SharedAllocate(const VTable *vTable, bool nothrow = false)
+    {
+        const size_t alignment = SharedAlignment(vTable->alignment);
+        const size_t header = SharedHeaderSize(vTable->alignment);
+
+        void *block = nothrow ? Allocate(header + vTable->size, alignment, std::nothrow) : Allocate(header + vTable->size, alignment);
+
+        if (!block)
+            return nullptr;
+
+        void *object = static_cast<unsigned char*>(block) + header;
+
+        ::new(&ReferencesOf(object)) SharedCount(1);
+
+        return object;
+    }
+
+    // releases a payload whose object isn't constructed
+    inline void SharedDeallocate(const VTable *vTable, void *object)
+    {
+        Deallocate(static_cast<unsigned char*>(object) - SharedHeaderSize(vTable->alignment), SharedAlignment(vTable->alignment));
+    }
+
+    inline void SharedAcquire(void *object)
+    {
+        ReferencesOf(object).fetch_add(1, std::memory_order_relaxed);
+    }
+
+    inline void SharedRelease(const VTable *vTable, void *object)
+    {
+        if (ReferencesOf(object).fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            if (vTable->destroy)
+                vTable->destroy(object);
+
+            SharedDeallocate(vTable, object);
+        }
+    }
+}
+
+/*
+ * Result of a checked access: either a pointer to the contained object or the reason 
+ * the access failed. Value() is the only throwing (or aborting) accessor.
+ */
+template <typename T>
+class AnyExpected
+{
+public:
+    AnyExpected(T *value) : mValue(value), mError(AnyError::None) {}
+    AnyExpected(AnyError error) : mValue(nullptr), mError(error) {}
+
+    explicit operator bool() const { return mValue; }
+
+    AnyError Error() const { return mError; }
+
+    T &Value() const
+    {
+        if (!mValue)
+            detail::ThrowBadCast();
+
+        return *mValue;
+    }
+
+    T &operator*() const { return *mValue; }
+    T *operator->() const { return mValue; }
+private:
+    T *mValue;
+    AnyError mError;
+};
+
+/*
+ * Owner of heap payloads that aren't allocated with the global operator new. 
+ * Each such payload is preceded by a pointer to its resource, which is called 
+ * to release the memory after the object has been destroyed.
+ */
+class AnyHeapResource
+{
+public:
+    // memory for an object of the given type, preceded by the resource pointer (nullptr if out of memory
+    // or if the resource doesn't allocate on demand)
+    virtual void *Allocate(const detail::VTable *) { return nullptr; }
+
+    virtual void Deallocate(void *object, const detail::VTable *type) = 0;
+protected:
+    ~AnyHeapResource() = default;
+};
+
+/*
+ * Takes over the destruction of heap payloads (allocated with operator new) from the threads
+ * it's installed in, see AnyReclaimer. Payloads of types with AnyDeferredDestruction, or of at
+ * least the minimum size, are offered to Defer instead of being destroyed in ~Any.
+ */
+class AnyDeferredDestroyer
+{
+public:
+    explicit AnyDeferredDestroyer(size_t minimumSize) : mMinimumSize(minimumSize) {}
+
+    bool Wants(const detail::VTable *type) const { return type->deferred || type->size >= mMinimumSize; }
+
+    // takes ownership of the payload (destroyed and deallocated later), false to destroy it in place
+    virtual bool Defer(const detail::VTable *type, void *object) = 0;
+protected:
+    ~AnyDeferredDestroyer() = default;
+
+private:
+    size_t mMinimumSize;
+};
+
+namespace detail
+{
+    // size of the header (resource pointer) in front of a payload with the given alignment
+    constexpr size_t ResourceHeaderSize(size_t alignment)
+    {
+        return alignment > sizeof(AnyHeapResource*) ? alignment : sizeof(AnyHeapResource*);
+    }
+
+    inline AnyHeapResource *&ResourceOf(void *object)
+    {
+        return *reinterpret_cast<AnyHeapResource**>(static_cast<unsigned char*>(object) - sizeof(AnyHeapResource*));
+    }
+
+    // resource replacing the global operator new on the heap path of the current thread (FrameScope)
+    inline AnyHeapResource *&ThreadHeapResource()
+    {
+        thread_local AnyHeapResource *resource = nullptr;
+
+        return resource;
+    }
+
+    inline AnyDeferredDestroyer *&ThreadDestroyer()
+    {
+        thread_local AnyDeferredDestroyer *destroyer = nullptr;
+
+        return destroyer;
+    }
+
+    inline void *ResourceCopy(AnyHeapResource *resource, const VTable *vTable, const void *from)
+    {
+        void *object = resource->Allocate(vTable);
+
+        if (!object)
+            return nullptr;
+
+    #ifdef ANY_NO_EXCEPTIONS
+        Copy(vTable, object, from);
+    #else
+        try
+        {
+            Copy(vTable, object, from);
+        }
+        catch (...)
+        {
+            resource->Deallocate(object, vTable);
+            throw;
+        }
+    #endif
+
+        return object;
+    }
+}
+
 template <size_t SIZE, size_t ALIGNMENT = alignof(std::max_align_t)>
 struct AlignedStorage
 {
@@ -33,6 +752,15 @@ using AlignedStorageT = typename AlignedStorage<SIZE, ALIGNMENT>::Type;
 template <size_t>
 class Any;
 
+// identity of the type contained in an Any, the same for all Any sizes (nullptr if empty)
+using AnyType = const detail::VTable*;
+
+template <typename T>
+constexpr AnyType AnyTypeOf()
+{
+    return &detail::VTableFor<T>::value;
+}
+
 template <size_t SIZE>
 void swap(Any<SIZE> &a, Any<SIZE> &b)
 {
@@ -63,83 +791,76 @@ template <size_t SIZE>
 class Any
 {
 template <typename> friend class Handle;
+template <size_t> friend class Any;
+template <size_t S, typename T> friend void BoxRange(const T *objects, size_t count, Any<S> *out);
 
 private:
-    class VTable
-    {
-    public:
-        virtual void *Copy(const void *from) = 0;             // allocation copy
-        virtual void Copy(void *to, const void *from) = 0;    // SBO copy
+    using VTable = detail::VTable;
 
-        virtual void *Move(const void *from) = 0;             // allocation move
-        virtual void Move(void *to, const void *from) = 0;    // SBO move
+    template <typename T>
+    static constexpr const VTable *VTableOf() { return &detail::VTableFor<T>::value; }
 
-        virtual void Destroy(void *object, bool SBO) = 0;     // allocation and SBO 
-    protected:
-        VTable() = default;
+    enum class Placement : unsigned char
+    {
+        Inline,     // small buffer optimization
+        Heap,       // allocated and owned
+        Resource,   // owned, allocated from an AnyHeapResource
+        Shared,     // allocated and reference counted (AnyStorage::Shared)
+        Reference   // not owned (Handle)
     };
 
+    // placement chosen by the storage policy: small buffer or allocated
     template <typename T>
-    class VTableT : public VTable
+    static constexpr bool IsInline()
     {
-    public:
-        static VTableT<T> mVTable;
+        constexpr AnyStorage storage = AnyStoragePolicy<T>::value;
+        constexpr bool fits = sizeof(T) <= SIZE && alignof(T) <= alignof(AlignedStorageT<SIZE>);
 
-        void *Copy(const void *from) override;
-        void Copy(void *to, const void *from) override;
+        static_assert(storage != AnyStorage::Inline || fits, "type with inline storage policy doesn't fit in the small buffer");
 
-        void *Move(const void *from) override;
-        void Move(void *to, const void *from) override;
-
-        void Destroy(void *object, bool SBO) override;
-    private:
-        VTableT() = default;
-    };
+        return fits && (storage == AnyStorage::Default || storage == AnyStorage::Inline);
+    }
 
-    template <typename T>
-    class VTableT<Handle<T>> : public VTable
+    // type-erased construction can't reject a type, types forced inline that don't fit are allocated
+    static bool IsInline(const VTable *type)
     {
-    public:
-        static VTableT mVTable;
-
-        void *Copy(const void *from) override { return const_cast<void*>(from); }
-        void Copy(void *to, const void *from) override { /* not used */ }
+        bool fits = type->size <= SIZE && type->alignment <= alignof(AlignedStorageT<SIZE>);
 
-        void *Move(const void *from) override { return const_cast<void*>(from); }
-        void Move(void *to, const void *from) override { /* not used */ }
-
-        void Destroy(void *object, bool SBO) override { /* do nothing */ }
-    private:
-        VTableT() = default;
-    };
+        return fits && (type->storage == AnyStorage::Default || type->storage == AnyStorage::Inline);
+    }
 
 public:
-    Any() : mVTable(nullptr), mObject(nullptr), mSBO(false) {}
+    // T can be stored in constant expressions (C++20): AnyConstexprStorable and fits in the small buffer
+    template <typename T>
+    static constexpr bool IsConstexprStorable() { return AnyConstexprStorable<T>::value && IsInline<T>(); }
+
+    constexpr Any() : mVTable(nullptr), mObject(nullptr), mPlacement(Placement::Heap) {}
 
-    Any(const Any &other);
+    ANY_CONSTEXPR20 Any(const Any &other);
     
-    Any(Any &&other);
+    ANY_CONSTEXPR20 Any(Any &&other);
 
     // SFINAE'd out if allocating
-    template <typename T, typename = typename std::enable_if<!std::is_same<typename std::decay<T>::type, Any<SIZE>>::value && (sizeof(typename std::decay<T>::type) <= SIZE)>::type>
-    Any(T &&object);
+    template <typename T, typename = typename std::enable_if<!std::is_same<typename std::decay<T>::type, Any<SIZE>>::value && IsInline<typename std::decay<T>::type>()>::type>
+    ANY_CONSTEXPR20 Any(T &&object);
 
     // SFINAE'd out if using small buffer optimization
-    template <typename T, typename = typename std::enable_if<!std::is_same<typename std::decay<T>::type, Any<SIZE>>::value && (sizeof(typename std::decay<T>::type) > SIZE)>::type, typename = void>
+    template <typename T, typename = typename std::enable_if<!std::is_same<typename std::decay<T>::type, Any<SIZE>>::value && !IsInline<typename std::decay<T>::type>()>::type, typename = void>
     Any(T &&object);
 
     template <typename T>
     Any(Handle<T> handle) : Any()
     {
         mObject = handle.mReference;
-        mVTable = &VTableT<Handle<T>>::mVTable;
+        mPlacement = Placement::Reference;
+        mVTable = VTableOf<T>();
     }
 
-    ~Any();
+    ANY_CONSTEXPR20 ~Any();
 
-    Any &operator=(const Any &other);
+    ANY_CONSTEXPR20 Any &operator=(const Any &other);
 
-    Any &operator=(Any &&other);
+    ANY_CONSTEXPR20 Any &operator=(Any &&other);
 
     template <typename T, typename = typename std::enable_if<!std::is_same<typename std::decay<T>::type, Any>::value>::type>
     Any &operator=(T &&object);
@@ -154,25 +875,65 @@ public:
         return *this;
     }
 
-    explicit operator bool() const { return mVTable; }
+    explicit constexpr operator bool() const { return mVTable; }
+
+    constexpr AnyType Type() const { return mVTable; }
+
+    // type-erased access to the contained object (nullptr if empty)
+    const void *Data() const
+    {
+        if (!mVTable)
+            return nullptr;
+
+        return mPlacement == Placement::Inline ? static_cast<const void*>(&mStorage) : mObject;
+    }
+
+    void *Data() { return const_cast<void*>(static_cast<const Any&>(*this).Data()); }
+
+    // bytes used by the Any and its heap payload (not counting memory owned by the object itself)
+    size_t Footprint() const
+    {
+        bool heap = mVTable && mPlacement != Placement::Inline && mPlacement != Placement::Reference;
+
+        return sizeof(Any) + (heap ? mVTable->size : 0);
+    }
+
+    // the object belongs to this Any alone: not shared with its copies (Shared policy) nor referenced (Handle)
+    bool OwnsObject() const { return mVTable && mPlacement != Placement::Shared && mPlacement != Placement::Reference; }
+
+    // the contained type is AnyHashable
+    bool Hashable() const { return mVTable && mVTable->hash && mVTable->equal; }
+
+    // 0 if empty or not hashable
+    size_t Hash() const { return mVTable && mVTable->hash ? mVTable->hash(Data()) : 0; }
+
+    // same type and equal objects (two empty Any are equal), false for types that aren't AnyHashable
+    bool Equals(const Any &other) const
+    {
+        if (mVTable != other.mVTable)
+            return false;
+
+        return !mVTable || (mVTable->equal && mVTable->equal(Data(), other.Data()));
+    }
 
-    void Swap(Any &other);
+    ANY_CONSTEXPR20 void Swap(Any &other);
 
     template <typename T>
-    bool Is() const
+    constexpr bool Is() const
     {
-        return mVTable == &VTableT<Handle<T>>::mVTable || mVTable == &VTableT<T>::mVTable;
+        return mVTable == VTableOf<T>();
     }
 
     template <typename T>
     const T &Get() const 
     {
-        if (mSBO)
+        if (mPlacement == Placement::Inline)
             return *reinterpret_cast<const T*>(&mStorage);
         else
             return *static_cast<T*>(mObject);
     }
 
+    // with the Shared policy, the object of all the copies of this Any
     template <typename T>
     T &Get()
     {
@@ -180,6 +941,19 @@ public:
         return const_cast<T&>(static_cast<const Any&>(*this).Get<T>());
     }
 
+    // returns a copy, unlike Get it's usable in constant expressions (C++20) 
+    template <typename T>
+    ANY_CONSTEXPR20 T GetValue() const
+    {
+    #ifdef ANY_CONSTEXPR_ANY
+        if constexpr (AnyConstexprStorable<T>::value && IsInline<T>())
+            if (std::is_constant_evaluated())
+                return detail::FromStorage<T>(mStorage);
+    #endif
+
+        return Get<T>();
+    }
+
     template <typename T>
     const T *TryGet() const 
     {
@@ -187,7 +961,7 @@ public:
             //throw BadCastException();
             return nullptr;
 
-        if (mSBO)
+        if (mPlacement == Placement::Inline)
             return reinterpret_cast<const T*>(&mStorage);
         else
             return static_cast<T*>(mObject);
@@ -200,8 +974,79 @@ public:
         return const_cast<T*>(static_cast<const Any&>(*this).TryGet<T>());
     }
 
+    template <typename T>
+    AnyExpected<const T> GetExpected() const
+    {
+        if (!mVTable)
+            return AnyError::Empty;
+
+        if (const T *object = TryGet<T>())
+            return object;
+
+        return AnyError::BadCast;
+    }
+
+    template <typename T>
+    AnyExpected<T> GetExpected()
+    {
+        if (!mVTable)
+            return AnyError::Empty;
+
+        if (T *object = TryGet<T>())
+            return object;
+
+        return AnyError::BadCast;
+    }
+
+    // destroys the contained object and constructs a T in place (no relocation, unlike TryEmplace)
+    template <typename T, typename... Args>
+    T &Emplace(Args &&...args);
+
+    // non-throwing construction/assignment, Any is left empty if allocation fails
+    template <typename T, typename... Args>
+    AnyError TryEmplace(Args &&...args);
+
+    AnyError TryAssign(const Any &other);
+
+    // type-erased copy of an object of the given type (empties the Any if type is nullptr)
+    AnyError Assign(AnyType type, const void *object);
+
+    // type-erased construction: construct(void *storage) -> bool builds an object of the given type in 
+    // the uninitialized storage chosen by the Any, which is left empty if it returns false
+    template <typename F>
+    AnyError Construct(AnyType type, F &&construct)
+    {
+        return ConstructWith(type, std::forward<F>(construct), nullptr);
+    }
+
+    // same as Construct but allocated payloads come from resource (types with the Shared policy keep their own allocation)
+    template <typename F>
+    AnyError Construct(AnyType type, F &&construct, AnyHeapResource &resource)
+    {
+        return ConstructWith(type, std::forward<F>(construct), &resource);
+    }
+
+    template <typename T, typename... Args>
+    AnyError EmplaceIn(AnyHeapResource &resource, Args &&...args);
+
 private:
-    VTable *mVTable;
+    // resource is nullptr to allocate with the global operator new (or the thread's FrameScope)
+    template <typename F>
+    AnyError ConstructWith(AnyType type, F &&construct, AnyHeapResource *resource);
+
+    // allocated part of ConstructWith, constructs in this empty Any
+    template <typename F>
+    AnyError ConstructAllocated(AnyType type, F &construct, AnyHeapResource *resource);
+
+    // constructs an object in this empty Any with the placement chosen by its storage policy, false if
+    // allocation fails with NOTHROW or in exception-free mode (otherwise std::bad_alloc is thrown)
+    template <typename T, bool NOTHROW, typename... Args>
+    bool EmplaceEmpty(Args &&...args);
+
+    ANY_CONSTEXPR20 void Destroy();              // destroys the contained object, leaves the Any in an invalid state
+    ANY_CONSTEXPR20 void MoveFrom(Any &other);   // relocates other's object into this empty Any and empties other
+
+    const VTable *mVTable;
 
     union
     {
@@ -209,240 +1054,534 @@ private:
         AlignedStorageT<SIZE> mStorage;
     };
 
-    bool mSBO;
+    Placement mPlacement;
 };
 
-/**** VTable implementation ****/
+/**** Any implementation ****/
 template <size_t SIZE>
-template <typename T>
-void *Any<SIZE>::VTableT<T>::Copy(const void *from)
+ANY_CONSTEXPR20 Any<SIZE>::Any(Any const &other) : Any()
 {
-    return new T(*static_cast<T const*>(from));
+    if (!other.mVTable)  // empty Any
+        return;
+
+    ANY_PROFILE_EVENT(Copy, other.mVTable->size, 1);
+    ANY_SAMPLE_SCOPE(Copy, other.mVTable);
+
+    Placement placement = other.mPlacement;
+
+    switch (other.mPlacement)
+    {
+    case Placement::Inline:
+        if (other.mVTable->copy)
+            other.mVTable->copy(&mStorage, &other.mStorage);
+        else
+            mStorage = other.mStorage;  // trivially copyable: copy the whole buffer
+        break;
+    case Placement::Heap:
+    case Placement::Resource:  // copies are allocated with operator new, or from the thread's FrameScope
+        if (AnyHeapResource *frame = detail::ThreadHeapResource())
+        {
+            mObject = detail::ResourceCopy(frame, other.mVTable, other.mObject);
+            placement = Placement::Resource;
+        }
+        else
+        {
+            mObject = detail::HeapCopy(other.mVTable, other.mObject);
+            placement = Placement::Heap;
+        }
+
+        // resources (FrameScope, AnyPoolScope) report running out of memory with nullptr in every mode
+        if (!mObject)
+        {
+        #ifndef ANY_NO_EXCEPTIONS
+            detail::ThrowBadAlloc();
+        #endif
+            return;  // stays empty in exception-free mode
+        }
+        break;
+    case Placement::Shared:
+        detail::SharedAcquire(other.mObject);
+        mObject = other.mObject;
+        break;
+    case Placement::Reference:
+        mObject = other.mObject;
+        break;
+    }
+
+    mPlacement = placement;
+    mVTable = other.mVTable;
 }
 
 template <size_t SIZE>
-template <typename T>
-void Any<SIZE>::VTableT<T>::Copy(void *to, const void *from)
+ANY_CONSTEXPR20 Any<SIZE>::Any(Any &&other) : Any()
 {
-    new(to) T(*static_cast<T const*>(from));
+    if (other.mVTable)
+        ANY_PROFILE_EVENT(Move, other.mVTable->size, 1);
+
+    MoveFrom(other);
 }
 
 template <size_t SIZE>
-template <typename T>
-void *Any<SIZE>::VTableT<T>::Move(const void *from)
+template <typename T, typename>
+ANY_CONSTEXPR20 Any<SIZE>::Any(T &&object) : Any()
 {
-    return new T(std::move(*static_cast<T const*>(from)));
+    using T_ = std::decay_t<T>;  // T can be deduced as T& (lvalue) or T (rvalue)
+
+#ifdef ANY_CONSTEXPR_ANY
+    if (std::is_constant_evaluated())  // placement new isn't allowed in constant expressions
+    {
+        if constexpr (AnyConstexprStorable<T_>::value)
+        {
+            mStorage = detail::ToStorage<AlignedStorageT<SIZE>>(static_cast<const T_&>(object));
+            mPlacement = Placement::Inline;
+
+            mVTable = VTableOf<T_>();
+
+            return;
+        }
+        else
+            detail::TypeNotStorableInConstantExpression();
+    }
+#endif
+
+    new(&mStorage) T_(std::forward<T>(object));
+    mPlacement = Placement::Inline;
+    
+    mVTable = VTableOf<T_>();
+
+    ANY_PROFILE_EVENT(Store, sizeof(T_), 1);
 }
 
 template <size_t SIZE>
-template <typename T>
-void Any<SIZE>::VTableT<T>::Move(void *to, const void *from)
+template <typename T, typename, typename>
+Any<SIZE>::Any(T &&object) : Any()
 {
-    new(to) T(std::move(*static_cast<T const*>(from)));
+    using T_ = std::decay_t<T>;  // T can be deduced as T& (lvalue) or T (rvalue)
+
+    EmplaceEmpty<T_, false>(std::forward<T>(object));
 }
 
 template <size_t SIZE>
-template <typename T>
-void Any<SIZE>::VTableT<T>::Destroy(void *object, bool SBO)
+template <typename T, bool NOTHROW, typename... Args>
+bool Any<SIZE>::EmplaceEmpty(Args &&...args)
 {
-    if (SBO)
-        static_cast<T*>(object)->~T();
+    if constexpr (IsInline<T>())
+    {
+        ::new(&mStorage) T(std::forward<Args>(args)...);
+        mPlacement = Placement::Inline;
+    }
+    else if constexpr (AnyStoragePolicy<T>::value == AnyStorage::Shared)
+    {
+        void *object = detail::SharedAllocate(VTableOf<T>(), NOTHROW);
+
+        if (!object)
+            return false;
+
+    #ifdef ANY_NO_EXCEPTIONS
+        ::new(object) T(std::forward<Args>(args)...);
+    #else
+        try
+        {
+            ::new(object) T(std::forward<Args>(args)...);
+        }
+        catch (...)
+        {
+            detail::SharedDeallocate(VTableOf<T>(), object);
+            throw;
+        }
+    #endif
+
+        mObject = object;
+        mPlacement = Placement::Shared;
+    }
+    else if (AnyHeapResource *frame = detail::ThreadHeapResource())
+    {
+        auto construct = [&](void *storage)
+        {
+            ::new(storage) T(std::forward<Args>(args)...);
+
+            return true;
+        };
+
+        // resources report running out of memory with nullptr, not with an exception
+        if (ConstructAllocated(VTableOf<T>(), construct, frame) != AnyError::None)
+        {
+        #ifndef ANY_NO_EXCEPTIONS
+            if constexpr (!NOTHROW)
+                detail::ThrowBadAlloc();
+        #endif
+
+            return false;
+        }
+    }
     else
-        delete static_cast<T*>(object);
+    {
+        if constexpr (NOTHROW)
+            mObject = ::new(std::nothrow) T(std::forward<Args>(args)...);
+        else
+            mObject = detail::New<T>(std::forward<Args>(args)...);
+
+        if (!mObject)
+            return false;
+
+        mPlacement = Placement::Heap;
+    }
+
+    mVTable = VTableOf<T>();
+
+    ANY_PROFILE_EVENT(Store, sizeof(T), 1);
+
+    return true;
 }
 
-/**** Any implementation ****/
 template <size_t SIZE>
-Any<SIZE>::Any(Any const &other) : Any()
+ANY_CONSTEXPR20 Any<SIZE>::~Any()
 {
-    if (!other.mVTable)  // empty Any
-        return;
+    if (mVTable)
+        Destroy();
+}
 
-    if (other.mSBO)
-        other.mVTable->Copy(&mStorage, &other.mStorage);
-    else
-        mObject = other.mVTable->Copy(other.mObject);
+template <size_t SIZE>
+ANY_CONSTEXPR20 void Any<SIZE>::Destroy()
+{
+    ANY_SAMPLE_SCOPE(Destroy, mVTable);
 
-    mSBO = other.mSBO;
-    mVTable = other.mVTable;
+    switch (mPlacement)
+    {
+    case Placement::Inline:
+        if (mVTable->destroy)
+            mVTable->destroy(&mStorage);
+        break;
+    case Placement::Heap:
+        if (AnyDeferredDestroyer *destroyer = detail::ThreadDestroyer())
+        {
+            if (destroyer->Wants(mVTable) && destroyer->Defer(mVTable, mObject))
+                break;
+        }
+
+        detail::HeapDestroy(mVTable, mObject);
+        break;
+    case Placement::Resource:
+        if (mVTable->destroy)
+            mVTable->destroy(mObject);
+
+        detail::ResourceOf(mObject)->Deallocate(mObject, mVTable);
+        break;
+    case Placement::Shared:
+        detail::SharedRelease(mVTable, mObject);
+        break;
+    case Placement::Reference:
+        break;
+    }
 }
 
 template <size_t SIZE>
-Any<SIZE>::Any(Any &&other) : Any()
+ANY_CONSTEXPR20 void Any<SIZE>::MoveFrom(Any &other)
 {
     if (!other.mVTable)  // empty Any
         return;
 
-    if (other.mSBO)
-        other.mVTable->Move(&mStorage, &other.mStorage);
-    else
-        mObject = other.mVTable->Move(other.mObject);
+    if (other.mPlacement == Placement::Inline)
+    {
+        ANY_SAMPLE_SCOPE(Move, other.mVTable);
 
-    mSBO = other.mSBO;
+        if (other.mVTable->move)
+            other.mVTable->move(&mStorage, &other.mStorage);
+        else
+            mStorage = other.mStorage;  // trivially copyable: relocate the whole buffer
+    }
+    else  // allocated objects and references are never moved, the pointer is stolen
+        mObject = other.mObject;
+
+    mPlacement = other.mPlacement;
     mVTable = other.mVTable;
+
+    other.mVTable = nullptr;
 }
 
+template <size_t SIZE>
+ANY_CONSTEXPR20 Any<SIZE> &Any<SIZE>::operator=(const Any &other)
+{
+    Any temp(other);
+
+    Swap(temp);
+
+    return *this;
+}
 
 template <size_t SIZE>
-template <typename T, typename>
-Any<SIZE>::Any(T &&object) : Any()
+ANY_CONSTEXPR20 Any<SIZE> &Any<SIZE>::operator=(Any &&other)
 {
-    using T_ = std::decay_t<T>;  // T can be deduced as T& (lvalue) or T (rvalue)
+    Any temp(std::move(other));
 
-    new(&mStorage) T_(std::forward<T>(object));
-    mSBO = true;
-    
-    mVTable = &VTableT<T_>::mVTable;
+    Swap(temp);
+
+    return *this;
 }
 
 template <size_t SIZE>
-template <typename T, typename, typename>
-Any<SIZE>::Any(T &&object) : Any()
+template <typename T, typename>
+Any<SIZE> &Any<SIZE>::operator=(T &&object) 
 {
-    using T_ = std::decay_t<T>;  // T can be deduced as T& (lvalue) or T (rvalue)
+    using T_ = typename std::decay<T>::type;
+
+    // if Any contains same type assign, a shared object is replaced instead: the other copies keep their value
+    if (Is<T_>() && mPlacement != Placement::Shared)
+    {
+        if (mPlacement == Placement::Inline)
+            *reinterpret_cast<T_*>(&mStorage) = std::forward<T>(object);
+        else
+            *static_cast<T_*>(mObject) = std::forward<T>(object);
+
+        return *this;
+    }
+
+    if (mVTable)  // destroy previous object and copy new object
+    {
+        Destroy();
+        mVTable = nullptr;
+    }
 
-    mObject = new T_(std::forward<T>(object));
-    mSBO = false;
+    EmplaceEmpty<T_, false>(std::forward<T>(object));  // stays empty if allocation fails in exception-free mode
 
-    mVTable = &VTableT<T_>::mVTable;
+    return *this;
 }
 
 template <size_t SIZE>
-Any<SIZE>::~Any()
+template <typename T, typename... Args>
+T &Any<SIZE>::Emplace(Args &&...args)
 {
     if (mVTable)
     {
-        if (mSBO)
-            mVTable->Destroy(&mStorage, true);
-        else
-            mVTable->Destroy(mObject, false);
+        Destroy();
+        mVTable = nullptr;
     }
+
+    if (!EmplaceEmpty<T, false>(std::forward<Args>(args)...))  // only returns false in exception-free mode
+        detail::ThrowBadAlloc();
+
+    return Get<T>();
 }
 
 template <size_t SIZE>
-Any<SIZE> &Any<SIZE>::operator=(const Any &other)
+template <typename T, typename... Args>
+AnyError Any<SIZE>::TryEmplace(Args &&...args)
 {
-    Any temp(other);
+    Any temp;
+
+    if (!temp.template EmplaceEmpty<T, true>(std::forward<Args>(args)...))
+        return AnyError::OutOfMemory;
 
     Swap(temp);
 
-    return *this;
+    return AnyError::None;
 }
 
 template <size_t SIZE>
-Any<SIZE> &Any<SIZE>::operator=(Any &&other)
+AnyError Any<SIZE>::TryAssign(const Any &other)
 {
-    Any temp(std::move(other));
+    Any temp(other);
+
+    if (other.mVTable && !temp.mVTable)  // copy failed to allocate
+        return AnyError::OutOfMemory;
 
     Swap(temp);
 
-    return *this;
+    return AnyError::None;
 }
 
 template <size_t SIZE>
-template <typename T, typename>
-Any<SIZE> &Any<SIZE>::operator=(T &&object) 
+AnyError Any<SIZE>::Assign(AnyType type, const void *object)
 {
-    using T_ = typename std::decay<T>::type;
+    if (!type)
+    {
+        Any temp;
+
+        Swap(temp);
+
+        return AnyError::None;
+    }
 
-    if (mVTable)  // Any is not empty
+    return Construct(type, [type, object](void *storage)
     {
-        if (Is<T_>())  // if (mVTable == &VTableT<T_>::mVTable) if Any contains same type assign 
-        {
-            if (mSBO)
-                *reinterpret_cast<T_*>(&mStorage) = std::forward<T>(object);
-            else
-                *static_cast<T_*>(mObject) = std::forward<T>(object);
-        }
-        else  // if Any does not contain same type destroy previous object and copy new object
-        {
-            if (mSBO)
-                mVTable->Destroy(&mStorage, true);
-            else
-                mVTable->Destroy(mObject, false);
-
-            if constexpr (sizeof(T_) <= SIZE) // constexpr if to remove warning from compiler
-            {
-                new(&mStorage) T_(std::forward<T>(object));
-                mSBO = true;
-            }
-            else
-            {   
-                mObject = new T_(std::forward<T>(object));
-                mSBO = false;
-            }
-
-            mVTable = &VTableT<T_>::mVTable;
-        }
+        detail::Copy(type, storage, object);
+
+        return true;
+    });
+}
+
+template <size_t SIZE>
+template <typename F>
+AnyError Any<SIZE>::ConstructWith(AnyType type, F &&construct, AnyHeapResource *resource)
+{
+    Any temp;
+
+    if (IsInline(type))
+    {
+        if (!construct(static_cast<void*>(&temp.mStorage)))
+            return AnyError::Construction;
+
+        temp.mPlacement = Placement::Inline;
+        temp.mVTable = type;
     }
-    else  // if this is an empty Any copy object
+    else
     {
-        if constexpr (sizeof(T_) < SIZE) // constexpr if to remove warning from compiler
-        {
-            new(&mStorage) T_(std::forward<T>(object));
-            mSBO = true;
-        }
-        else
-        {   
-            mObject = new T_(std::forward<T>(object));
-            mSBO = false;
-        }
+        AnyError error = temp.ConstructAllocated(type, construct, resource);
 
-        mVTable = &VTableT<T_>::mVTable;
+        if (error != AnyError::None)
+            return error;
     }
 
-    return *this;
+    ANY_PROFILE_EVENT(Store, type->size, 1);
+
+    Swap(temp);
+
+    return AnyError::None;
 }
 
 template <size_t SIZE>
-void Any<SIZE>::Swap(Any &other)
+template <typename F>
+AnyError Any<SIZE>::ConstructAllocated(AnyType type, F &construct, AnyHeapResource *resource)
 {
-    // swap object and SBO tag
-    if (mSBO)
-        if (other.mSBO)
-        {
-            AlignedStorageT<SIZE> storageTemp;
+    if (!resource)
+        resource = detail::ThreadHeapResource();
 
-            mVTable->Move(&storageTemp, &mStorage);
-            other.mVTable->Move(&mStorage, &other.mStorage);
-            mVTable->Move(&other.mStorage, &storageTemp);
-        }
+    const Placement placement = type->storage == AnyStorage::Shared ? Placement::Shared : resource ? Placement::Resource : Placement::Heap;
+
+    void *object;
+
+    switch (placement)
+    {
+    case Placement::Shared:
+        object = detail::SharedAllocate(type);
+        break;
+    case Placement::Resource:
+        object = resource->Allocate(type);
+        break;
+    default:
+        object = detail::Allocate(type->size, type->alignment);
+        break;
+    }
+
+    if (!object)  // resources return nullptr, global allocation only fails in exception-free mode
+        return AnyError::OutOfMemory;
+
+    auto release = [&]()
+    {
+        if (placement == Placement::Shared)
+            detail::SharedDeallocate(type, object);
+        else if (placement == Placement::Resource)
+            resource->Deallocate(object, type);
         else
-        {
-            mObject = other.mObject;
-            mSBO = false;
+            detail::Deallocate(object, type->alignment);
+    };
 
-            mVTable->Move(&other.mStorage, &mStorage);
-            other.mSBO = true;
-        }
+    bool constructed;
+
+#ifdef ANY_NO_EXCEPTIONS
+    constructed = construct(object);
+#else
+    try
+    {
+        constructed = construct(object);
+    }
+    catch (...)
+    {
+        release();
+        throw;
+    }
+#endif
+
+    if (!constructed)
+    {
+        release();
+
+        return AnyError::Construction;
+    }
+
+    mObject = object;
+    mPlacement = placement;
+    mVTable = type;
+
+    return AnyError::None;
+}
+
+template <size_t SIZE>
+template <typename T, typename... Args>
+AnyError Any<SIZE>::EmplaceIn(AnyHeapResource &resource, Args &&...args)
+{
+    if constexpr (IsInline<T>())
+        return TryEmplace<T>(std::forward<Args>(args)...);
     else
-        if (other.mSBO)
+    {
+        auto construct = [&](void *storage)
         {
-            other.mVTable->Move(&mStorage, &other.mStorage);
-            mSBO = true;
+            ::new(storage) T(std::forward<Args>(args)...);
 
-            other.mObject = mObject;
-            other.mSBO = false;
-        }
-        else
-        {
-            void *objectTemp = mObject;
-            mObject = other.mObject;
-            other.mObject = objectTemp;
-        }
+            return true;
+        };
 
-    // swap vtable
-    VTable *vTableTemp = mVTable;
-    mVTable = other.mVTable;
-    other.mVTable = vTableTemp;
+        Any temp;
+
+        AnyError error = temp.ConstructAllocated(AnyTypeOf<T>(), construct, &resource);
+
+        if (error != AnyError::None)
+            return error;
+
+        ANY_PROFILE_EVENT(Store, sizeof(T), 1);
+
+        Swap(temp);
+
+        return AnyError::None;
+    }
 }
 
 template <size_t SIZE>
-template <typename T>
-Any<SIZE>::VTableT<T> Any<SIZE>::VTableT<T>::mVTable; 
+ANY_CONSTEXPR20 void Any<SIZE>::Swap(Any &other)
+{
+    // relocate through a temporary: inline objects are moved (and the sources destroyed),
+    // heap objects and references only swap pointers
+    Any temp;
 
-template <size_t SIZE>
-template <typename T>
-Any<SIZE>::VTableT<Handle<T>> Any<SIZE>::VTableT<Handle<T>>::mVTable;
+    temp.MoveFrom(other);
+    other.MoveFrom(*this);
+    MoveFrom(temp);
+}
+
+/*
+ * Non-owning view of an object and its type descriptor, e.g. of the object contained in an Any
+ * (valid while the Any isn't modified or destroyed). The view is shallow: const only applies to it.
+ */
+class AnyRef
+{
+public:
+    constexpr AnyRef() : mType(nullptr), mObject(nullptr) {}
+    constexpr AnyRef(AnyType type, void *object) : mType(type), mObject(object) {}
+
+    template <size_t SIZE>
+    AnyRef(Any<SIZE> &any) : mType(any.Type()), mObject(any.Data()) {}
+
+    explicit constexpr operator bool() const { return mType; }
+
+    constexpr AnyType Type() const { return mType; }
+    constexpr void *Data() const { return mObject; }
+
+    template <typename T>
+    constexpr bool Is() const { return mType == AnyTypeOf<T>(); }
+
+    template <typename T>
+    T &Get() const { return *static_cast<T*>(mObject); }
+
+    template <typename T>
+    T *TryGet() const { return Is<T>() ? static_cast<T*>(mObject) : nullptr; }
+
+    // copy of the viewed object
+    template <size_t SIZE>
+    AnyError CopyTo(Any<SIZE> &any) const { return any.Assign(mType, mObject); }
+
+private:
+    AnyType mType;
+    void *mObject;
+};
 
-#endif  // ANY_H
\ No newline at end of file
+#endif  // ANY_H
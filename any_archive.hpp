@@ -0,0 +1,277 @@
+#ifndef ANY_ARCHIVE_H
+#define ANY_ARCHIVE_H
+
+#include "any_serialization.hpp"
+#include <atomic>
+#include <cstdio>
+#include <memory>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define ANY_ARCHIVE_MMAP
+#endif
+
+/*
+ * Archive layout (native byte order):
+ *   header  { magic, version, count }
+ *   index   { type id, offset, size } x count   (offsets relative to the start of the data section)
+ *   data
+ */
+namespace detail
+{
+    constexpr uint32_t ARCHIVE_MAGIC = 0x41594e41;   // "ANYA"
+    constexpr uint32_t ARCHIVE_VERSION = 1;
+
+    struct ArchiveHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t count;
+    };
+
+    struct ArchiveEntry
+    {
+        uint64_t id;
+        uint64_t offset;
+        uint64_t size;
+    };
+}
+
+class AnyArchiveWriter
+{
+public:
+    explicit AnyArchiveWriter(const AnySerializer &serializer = AnySerializer::Default()) : mSerializer(serializer) {}
+
+    // false if the Any is empty or its type isn't registered
+    template <size_t SIZE>
+    bool Add(const Any<SIZE> &any);
+
+    size_t Size() const { return mEntries.size(); }
+
+    bool Write(const char *path) const;
+
+private:
+    const AnySerializer &mSerializer;
+
+    std::vector<detail::ArchiveEntry> mEntries;
+    std::vector<unsigned char> mData;
+};
+
+template <size_t SIZE>
+bool AnyArchiveWriter::Add(const Any<SIZE> &any)
+{
+    size_t offset = mData.size();
+    AnySerializer::Id id;
+
+    if (!mSerializer.Write(any, mData, &id))
+        return false;
+
+    mEntries.push_back(detail::ArchiveEntry{ id, offset, mData.size() - offset });
+
+    return true;
+}
+
+inline bool AnyArchiveWriter::Write(const char *path) const
+{
+    std::FILE *file = std::fopen(path, "wb");
+
+    if (!file)
+        return false;
+
+    detail::ArchiveHeader header{ detail::ARCHIVE_MAGIC, detail::ARCHIVE_VERSION, mEntries.size() };
+
+    bool written = std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+                   std::fwrite(mEntries.data(), sizeof(detail::ArchiveEntry), mEntries.size(), file) == mEntries.size() &&
+                   std::fwrite(mData.data(), 1, mData.size(), file) == mData.size();
+
+    return std::fclose(file) == 0 && written;
+}
+
+/*
+ * Maps an archive and keeps each entry as an undecoded byte range tagged with its type id.
+ * An entry is decoded into an Any the first time it's accessed and the result is cached.
+ * Get can be called concurrently: racing decodes of the same entry keep the first result.
+ */
+template <size_t SIZE>
+class AnyArchiveReader
+{
+public:
+    explicit AnyArchiveReader(const AnySerializer &serializer = AnySerializer::Default()) :
+        mSerializer(serializer), mMapping(nullptr), mMappingSize(0), mEntries(nullptr), mData(nullptr), mCount(0)
+    {
+    }
+
+    ~AnyArchiveReader() { Close(); }
+
+    AnyArchiveReader(const AnyArchiveReader&) = delete;
+    AnyArchiveReader &operator=(const AnyArchiveReader&) = delete;
+
+    bool Open(const char *path);
+    void Close();
+
+    size_t Size() const { return mCount; }
+
+    // available without decoding
+    AnySerializer::Id TypeId(size_t index) const { return mEntries[index].id; }
+
+    bool IsDecoded(size_t index) const { return mDecoded[index].load(std::memory_order_acquire); }
+
+    // nullptr if the type isn't registered or the entry can't be decoded
+    const Any<SIZE> *Get(size_t index);
+
+private:
+    bool Map(const char *path);
+
+    const AnySerializer &mSerializer;
+
+    void *mMapping;
+    size_t mMappingSize;
+    std::vector<unsigned char> mBuffer;  // used when the archive can't be mapped
+
+    const detail::ArchiveEntry *mEntries;
+    const unsigned char *mData;
+    size_t mCount;
+
+    std::unique_ptr<std::atomic<Any<SIZE>*>[]> mDecoded;
+};
+
+template <size_t SIZE>
+bool AnyArchiveReader<SIZE>::Open(const char *path)
+{
+    Close();
+
+    if (!Map(path))
+        return false;
+
+    const unsigned char *bytes = mMapping ? static_cast<const unsigned char*>(mMapping) : mBuffer.data();
+    const size_t size = mMapping ? mMappingSize : mBuffer.size();
+
+    detail::ArchiveHeader header;
+
+    if (size < sizeof(header))
+    {
+        Close();
+        return false;
+    }
+
+    std::memcpy(&header, bytes, sizeof(header));
+
+    const size_t dataOffset = sizeof(header) + header.count * sizeof(detail::ArchiveEntry);
+
+    if (header.magic != detail::ARCHIVE_MAGIC || header.version != detail::ARCHIVE_VERSION ||
+        header.count > (size - sizeof(header)) / sizeof(detail::ArchiveEntry))
+    {
+        Close();
+        return false;
+    }
+
+    mEntries = reinterpret_cast<const detail::ArchiveEntry*>(bytes + sizeof(header));
+    mData = bytes + dataOffset;
+    mCount = static_cast<size_t>(header.count);
+
+    for (size_t i = 0; i < mCount; i++)
+        if (mEntries[i].offset > size - dataOffset || mEntries[i].size > size - dataOffset - mEntries[i].offset)
+        {
+            Close();
+            return false;
+        }
+
+    mDecoded.reset(new std::atomic<Any<SIZE>*>[mCount]);
+
+    for (size_t i = 0; i < mCount; i++)
+        mDecoded[i].store(nullptr, std::memory_order_relaxed);
+
+    return true;
+}
+
+template <size_t SIZE>
+void AnyArchiveReader<SIZE>::Close()
+{
+    if (mDecoded)
+        for (size_t i = 0; i < mCount; i++)
+            delete mDecoded[i].load(std::memory_order_relaxed);
+
+    mDecoded.reset();
+
+#ifdef ANY_ARCHIVE_MMAP
+    if (mMapping)
+        munmap(mMapping, mMappingSize);
+#endif
+
+    mMapping = nullptr;
+    mMappingSize = 0;
+    mBuffer.clear();
+
+    mEntries = nullptr;
+    mData = nullptr;
+    mCount = 0;
+}
+
+template <size_t SIZE>
+const Any<SIZE> *AnyArchiveReader<SIZE>::Get(size_t index)
+{
+    if (Any<SIZE> *decoded = mDecoded[index].load(std::memory_order_acquire))
+        return decoded;
+
+    const detail::ArchiveEntry &entry = mEntries[index];
+
+    std::unique_ptr<Any<SIZE>> any(new Any<SIZE>());
+
+    if (mSerializer.Read(entry.id, mData + entry.offset, static_cast<size_t>(entry.size), *any) != AnyError::None)
+        return nullptr;
+
+    Any<SIZE> *expected = nullptr;
+
+    if (mDecoded[index].compare_exchange_strong(expected, any.get(), std::memory_order_acq_rel))
+        return any.release();
+
+    return expected;  // another thread decoded it first
+}
+
+template <size_t SIZE>
+bool AnyArchiveReader<SIZE>::Map(const char *path)
+{
+#ifdef ANY_ARCHIVE_MMAP
+    int descriptor = ::open(path, O_RDONLY);
+
+    if (descriptor < 0)
+        return false;
+
+    struct stat status;
+
+    if (::fstat(descriptor, &status) == 0 && status.st_size > 0)
+    {
+        void *mapping = ::mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, descriptor, 0);
+
+        if (mapping != MAP_FAILED)
+        {
+            mMapping = mapping;
+            mMappingSize = static_cast<size_t>(status.st_size);
+        }
+    }
+
+    ::close(descriptor);
+
+    if (mMapping)
+        return true;
+#endif
+
+    std::FILE *file = std::fopen(path, "rb");
+
+    if (!file)
+        return false;
+
+    unsigned char chunk[4096];
+
+    for (size_t read; (read = std::fread(chunk, 1, sizeof(chunk), file)) > 0; )
+        mBuffer.insert(mBuffer.end(), chunk, chunk + read);
+
+    std::fclose(file);
+
+    return true;
+}
+
+#endif  // ANY_ARCHIVE_H
@@ -0,0 +1,221 @@
+#ifndef ANY_ARENA_H
+#define ANY_ARENA_H
+
+#include "any.hpp"
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#define ANY_ARENA_MMAP
+#endif
+
+/*
+ * Arena for the heap payloads of large populations of Any (see Any::EmplaceIn and Any::Construct
+ * with a resource). Memory is reserved in big chunks, backed by transparent huge pages on Linux
+ * to cut TLB misses when scanning the payloads, and handed out bump style. Destroyed payloads
+ * go to a free list per type and are reused by the next payload of the same type.
+ *
+ * Release() frees all the chunks at once: the Any holding payloads of the arena must be
+ * destroyed before (destroying them only pushes their slots on the free lists).
+ * Allocation and deallocation are serialized by a mutex.
+ */
+class AnyArena : public AnyHeapResource
+{
+public:
+    static constexpr size_t HUGE_PAGE_SIZE = size_t(2) << 20;
+
+    explicit AnyArena(size_t chunkSize = size_t(64) << 20, bool hugePages = true) :
+        mChunkSize(RoundUp(chunkSize ? chunkSize : HUGE_PAGE_SIZE, HUGE_PAGE_SIZE)), mHugePages(hugePages),
+        mCursor(nullptr), mEnd(nullptr), mReserved(0)
+    {
+    }
+
+    ~AnyArena() { Release(); }
+
+    AnyArena(const AnyArena&) = delete;
+    AnyArena &operator=(const AnyArena&) = delete;
+
+    void *Allocate(const detail::VTable *type) override;
+    void Deallocate(void *object, const detail::VTable *type) override;
+
+    void Release();
+
+    size_t Reserved() const { return mReserved; }  // bytes of the chunks
+
+private:
+    struct Chunk
+    {
+        void *memory;
+        size_t size;
+        bool mapped;
+    };
+
+    static size_t RoundUp(size_t size, size_t alignment) { return (size + alignment - 1) / alignment * alignment; }
+
+    static size_t Alignment(const detail::VTable *type)
+    {
+        return type->alignment > alignof(void*) ? type->alignment : alignof(void*);
+    }
+
+    // free slots keep the next free slot at the start of the payload
+    static size_t PayloadSize(const detail::VTable *type)
+    {
+        return type->size > sizeof(void*) ? type->size : sizeof(void*);
+    }
+
+    bool AddChunk(size_t minimum);
+
+    size_t mChunkSize;
+    bool mHugePages;
+
+    std::mutex mMutex;
+
+    std::vector<Chunk> mChunks;
+    unsigned char *mCursor;
+    unsigned char *mEnd;
+    size_t mReserved;
+
+    std::unordered_map<AnyType, void*> mFree;
+};
+
+inline void *AnyArena::Allocate(const detail::VTable *type)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    auto free = mFree.find(type);
+
+    if (free != mFree.end() && free->second)
+    {
+        void *object = free->second;
+
+        free->second = *static_cast<void**>(object);
+
+        return object;
+    }
+
+    const size_t alignment = Alignment(type);
+    const size_t header = detail::ResourceHeaderSize(alignment);
+    const size_t slot = header + PayloadSize(type);
+
+    const uintptr_t end = reinterpret_cast<uintptr_t>(mEnd);
+    uintptr_t aligned = mCursor ? RoundUp(reinterpret_cast<uintptr_t>(mCursor), alignment) : 0;
+
+    // aligning can move the start past the end of the chunk
+    if (!aligned || aligned > end || slot > end - aligned)
+    {
+        if (!AddChunk(slot + alignment))
+            return nullptr;
+
+        aligned = RoundUp(reinterpret_cast<uintptr_t>(mCursor), alignment);
+    }
+
+    unsigned char *start = reinterpret_cast<unsigned char*>(aligned);
+
+    mCursor = start + slot;
+
+    void *object = start + header;
+
+    detail::ResourceOf(object) = this;
+
+    return object;
+}
+
+inline void AnyArena::Deallocate(void *object, const detail::VTable *type)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    void *&head = mFree[type];
+
+    *static_cast<void**>(object) = head;
+    head = object;
+}
+
+inline bool AnyArena::AddChunk(size_t minimum)
+{
+    const size_t size = minimum > mChunkSize ? RoundUp(minimum, HUGE_PAGE_SIZE) : mChunkSize;
+
+    void *memory = nullptr;
+    bool mapped = false;
+
+#ifdef ANY_ARENA_MMAP
+    // over-reserve to align the chunk on a huge page boundary, then unmap the excess
+    void *reserved = ::mmap(nullptr, size + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (reserved != MAP_FAILED)
+    {
+        unsigned char *begin = static_cast<unsigned char*>(reserved);
+        unsigned char *aligned = reinterpret_cast<unsigned char*>(RoundUp(reinterpret_cast<uintptr_t>(begin), HUGE_PAGE_SIZE));
+
+        if (aligned != begin)
+            ::munmap(begin, static_cast<size_t>(aligned - begin));
+
+        if (aligned + size != begin + size + HUGE_PAGE_SIZE)
+            ::munmap(aligned + size, static_cast<size_t>(begin + HUGE_PAGE_SIZE - aligned));
+
+    #ifdef MADV_HUGEPAGE
+        if (mHugePages)
+            ::madvise(aligned, size, MADV_HUGEPAGE);  // advisory, ignored if THP is disabled
+    #endif
+
+        memory = aligned;
+        mapped = true;
+    }
+#endif
+
+    if (!memory)
+    {
+    #ifdef ANY_NO_EXCEPTIONS
+        memory = detail::Allocate(size, ANY_CACHE_LINE_SIZE);
+    #else
+        try
+        {
+            memory = detail::Allocate(size, ANY_CACHE_LINE_SIZE);
+        }
+        catch (const std::bad_alloc&)
+        {
+            return false;
+        }
+    #endif
+
+        if (!memory)
+            return false;
+    }
+
+    mChunks.push_back(Chunk{ memory, size, mapped });
+    mReserved += size;
+
+    mCursor = static_cast<unsigned char*>(memory);
+    mEnd = mCursor + size;
+
+    return true;
+}
+
+inline void AnyArena::Release()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    for (const Chunk &chunk : mChunks)
+    {
+    #ifdef ANY_ARENA_MMAP
+        if (chunk.mapped)
+        {
+            ::munmap(chunk.memory, chunk.size);
+            continue;
+        }
+    #endif
+
+        detail::Deallocate(chunk.memory, ANY_CACHE_LINE_SIZE);
+    }
+
+    mChunks.clear();
+    mFree.clear();
+
+    mCursor = nullptr;
+    mEnd = nullptr;
+    mReserved = 0;
+}
+
+#endif  // ANY_ARENA_H
@@ -0,0 +1,176 @@
+#ifndef ANY_BOX_H
+#define ANY_BOX_H
+
+#include "any.hpp"
+#include <atomic>
+#include <iterator>
+#include <vector>
+
+namespace detail
+{
+    /*
+     * Contiguous block holding the heap payloads of a boxed range, released when the 
+     * last payload is destroyed. Slots are [padding | resource pointer | payload].
+     */
+    class BoxBlock : public AnyHeapResource
+    {
+    public:
+        static BoxBlock *Create(const VTable *type, size_t count)
+        {
+            const size_t alignment = type->alignment > alignof(BoxBlock) ? type->alignment : alignof(BoxBlock);
+            const size_t header = ResourceHeaderSize(alignment);
+            const size_t stride = (header + type->size + alignment - 1) / alignment * alignment;
+            const size_t offset = (sizeof(BoxBlock) + alignment - 1) / alignment * alignment;
+
+            void *memory = detail::Allocate(offset + count * stride, alignment);
+
+            if (!memory)  // allocation can only fail in exception-free mode
+                return nullptr;
+
+            return ::new(memory) BoxBlock(alignment, offset + header, stride);
+        }
+
+        void *Slot(size_t index)
+        {
+            void *object = reinterpret_cast<unsigned char*>(this) + mFirst + index * mStride;
+
+            ResourceOf(object) = this;
+
+            return object;
+        }
+
+        void Acquire() { mReferences.fetch_add(1, std::memory_order_relaxed); }
+
+        void Deallocate(void *, const VTable *) override
+        {
+            if (mReferences.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            {
+                size_t alignment = mAlignment;
+
+                this->~BoxBlock();
+                detail::Deallocate(this, alignment);
+            }
+        }
+
+    private:
+        BoxBlock(size_t alignment, size_t first, size_t stride) : mReferences(1), mAlignment(alignment), mFirst(first), mStride(stride) {}
+
+        std::atomic<size_t> mReferences;   // one per payload, plus one held while boxing
+        size_t mAlignment;
+        size_t mFirst;
+        size_t mStride;
+    };
+}
+
+/*
+ * Bulk boxing of a homogeneous array: the descriptor and placement are resolved once for the range, 
+ * trivially copyable objects are copied as bytes and heap payloads are allocated in one contiguous block.
+ * The previous contents of out are destroyed. If a copy throws, out is left empty.
+ */
+template <size_t SIZE, typename T>
+void BoxRange(const T *objects, size_t count, Any<SIZE> *out)
+{
+    using T_ = typename std::remove_cv<T>::type;
+    using Placement = typename Any<SIZE>::Placement;
+
+    const detail::VTable *vTable = Any<SIZE>::template VTableOf<T_>();
+
+    for (size_t i = 0; i < count; i++)
+        if (out[i].mVTable)
+        {
+            out[i].Destroy();
+            out[i].mVTable = nullptr;
+        }
+
+    // empties the objects boxed so far if a copy throws
+    struct Rollback
+    {
+        Any<SIZE> *out;
+        size_t count;
+        size_t boxed;
+
+        ~Rollback()
+        {
+            if (boxed != count)
+                for (size_t i = 0; i < boxed; i++)
+                    if (out[i].mVTable)  // destroyed in place, moving could throw as well
+                    {
+                        out[i].Destroy();
+                        out[i].mVTable = nullptr;
+                    }
+        }
+    } rollback{ out, count, 0 };
+
+    if constexpr (Any<SIZE>::template IsInline<T_>())
+    {
+        ANY_PROFILE_EVENT(Store, sizeof(T_), count);
+
+        for (; rollback.boxed < count; rollback.boxed++)
+        {
+            const size_t i = rollback.boxed;
+
+            if constexpr (std::is_trivially_copyable<T_>::value)
+                std::memcpy(&out[i].mStorage, &objects[i], sizeof(T_));
+            else
+                ::new(&out[i].mStorage) T_(objects[i]);
+
+            out[i].mPlacement = Placement::Inline;
+            out[i].mVTable = vTable;
+        }
+    }
+    else if constexpr (AnyStoragePolicy<T_>::value == AnyStorage::Shared)
+    {
+        for (; rollback.boxed < count; rollback.boxed++)  // each payload has its own reference count
+            out[rollback.boxed].template EmplaceEmpty<T_, false>(objects[rollback.boxed]);
+    }
+    else if (count)
+    {
+        detail::BoxBlock *block = detail::BoxBlock::Create(vTable, count);
+
+        if (!block)  // allocation can only fail in exception-free mode
+            return;
+
+        struct Release  // drops the reference held while boxing, even if a copy throws
+        {
+            detail::BoxBlock *block;
+            ~Release() { block->Deallocate(nullptr, nullptr); }
+        } release{ block };
+
+        ANY_PROFILE_EVENT(Store, sizeof(T_), count);
+
+        for (; rollback.boxed < count; rollback.boxed++)
+        {
+            const size_t i = rollback.boxed;
+            void *object = block->Slot(i);
+
+            if constexpr (std::is_trivially_copyable<T_>::value)
+                std::memcpy(object, &objects[i], sizeof(T_));
+            else
+                ::new(object) T_(objects[i]);
+
+            block->Acquire();
+
+            out[i].mObject = object;
+            out[i].mPlacement = Placement::Resource;
+            out[i].mVTable = vTable;
+        }
+    }
+}
+
+template <size_t SIZE, typename T>
+std::vector<Any<SIZE>> BoxRange(const T *objects, size_t count)
+{
+    std::vector<Any<SIZE>> result(count);
+
+    BoxRange(objects, count, result.data());
+
+    return result;
+}
+
+template <size_t SIZE, typename Container>
+std::vector<Any<SIZE>> BoxRange(const Container &objects)
+{
+    return BoxRange<SIZE>(std::data(objects), std::size(objects));
+}
+
+#endif  // ANY_BOX_H
@@ -0,0 +1,347 @@
+#ifndef ANY_COLD_H
+#define ANY_COLD_H
+
+#include "any_serialization.hpp"
+#include <chrono>
+#include <cstring>
+#include <vector>
+
+namespace detail
+{
+    /*
+     * Byte-oriented LZ77 codec (LZ4 block layout): sequences of
+     *   token { literal length:4 | match length - 4:4 }, [length bytes], literals, offset:16 (LE), [length bytes]
+     * where a nibble of 15 is continued by bytes summed until one is below 255. The last sequence
+     * has literals only. Single pass with a 4K entry hash table, no entropy coding.
+     */
+    constexpr size_t LZ_MIN_MATCH = 4;
+    constexpr size_t LZ_MAX_OFFSET = 65535;
+    constexpr unsigned LZ_HASH_BITS = 12;
+
+    inline uint32_t LzLoad32(const unsigned char *bytes)
+    {
+        uint32_t value;
+
+        std::memcpy(&value, bytes, sizeof(value));
+
+        return value;
+    }
+
+    inline void LzWriteLength(std::vector<unsigned char> &out, size_t length)
+    {
+        for (; length >= 255; length -= 255)
+            out.push_back(255);
+
+        out.push_back(static_cast<unsigned char>(length));
+    }
+
+    inline bool LzReadLength(const unsigned char *in, size_t size, size_t &position, size_t &length)
+    {
+        unsigned char byte;
+
+        do
+        {
+            if (position == size)
+                return false;
+
+            byte = in[position++];
+            length += byte;
+        }
+        while (byte == 255);
+
+        return true;
+    }
+
+    // match length 0 for the last sequence
+    inline void LzWriteSequence(std::vector<unsigned char> &out, const unsigned char *literals, size_t literalLength, size_t offset, size_t matchLength)
+    {
+        const size_t matchCode = matchLength ? matchLength - LZ_MIN_MATCH : 0;
+
+        out.push_back(static_cast<unsigned char>((literalLength < 15 ? literalLength : 15) << 4 | (matchCode < 15 ? matchCode : 15)));
+
+        if (literalLength >= 15)
+            LzWriteLength(out, literalLength - 15);
+
+        out.insert(out.end(), literals, literals + literalLength);
+
+        if (!matchLength)
+            return;
+
+        out.push_back(static_cast<unsigned char>(offset));
+        out.push_back(static_cast<unsigned char>(offset >> 8));
+
+        if (matchCode >= 15)
+            LzWriteLength(out, matchCode - 15);
+    }
+
+    // appends the compressed bytes to out
+    inline void LzCompress(const unsigned char *in, size_t size, std::vector<unsigned char> &out)
+    {
+        std::vector<uint32_t> table(size_t(1) << LZ_HASH_BITS, 0);
+
+        size_t anchor = 0;
+        size_t position = 0;
+
+        while (position + LZ_MIN_MATCH <= size)
+        {
+            const uint32_t sequence = LzLoad32(in + position);
+            const size_t hash = (sequence * 2654435761u) >> (32 - LZ_HASH_BITS);
+            const size_t candidate = table[hash];
+
+            table[hash] = static_cast<uint32_t>(position);
+
+            if (candidate < position && position - candidate <= LZ_MAX_OFFSET && LzLoad32(in + candidate) == sequence)
+            {
+                size_t length = LZ_MIN_MATCH;
+
+                while (position + length < size && in[candidate + length] == in[position + length])
+                    length++;
+
+                LzWriteSequence(out, in + anchor, position - anchor, position - candidate, length);
+
+                position += length;
+                anchor = position;
+            }
+            else
+                position++;
+        }
+
+        LzWriteSequence(out, in + anchor, size - anchor, 0, 0);
+    }
+
+    // false if the input is corrupt or doesn't decompress to exactly size bytes
+    inline bool LzDecompress(const unsigned char *in, size_t inSize, unsigned char *out, size_t size)
+    {
+        size_t input = 0;
+        size_t output = 0;
+
+        while (input < inSize)
+        {
+            const unsigned char token = in[input++];
+
+            size_t literals = token >> 4;
+
+            if (literals == 15 && !LzReadLength(in, inSize, input, literals))
+                return false;
+
+            if (literals > inSize - input || literals > size - output)
+                return false;
+
+            std::memcpy(out + output, in + input, literals);
+            input += literals;
+            output += literals;
+
+            if (input == inSize)  // last sequence
+                break;
+
+            if (inSize - input < 2)
+                return false;
+
+            const size_t offset = in[input] | static_cast<size_t>(in[input + 1]) << 8;
+            input += 2;
+
+            size_t length = token & 15;
+
+            if (length == 15 && !LzReadLength(in, inSize, input, length))
+                return false;
+
+            length += LZ_MIN_MATCH;
+
+            if (!offset || offset > output || length > size - output)
+                return false;
+
+            // the match can overlap the bytes it produces
+            for (const unsigned char *from = out + output - offset, *end = out + output + length; out + output < end; output++)
+                out[output] = *from++;
+        }
+
+        return output == size;
+    }
+}
+
+/*
+ * Store of long-lived Any values whose cold payloads are compressed in memory. Sweep serializes
+ * (with AnySerializer) the heap payloads not accessed for coldAfter, compresses them with a
+ * bundled LZ codec and drops the object; the next access (Value, TryValue, Get, TryGet) decompresses
+ * and deserializes it in place, entries that can't be decoded stay compressed. Payloads whose type isn't registered, serialized to less than
+ * minimumSize bytes or that don't compress are left alone (until they're accessed again), as
+ * are shared payloads (compressing them wouldn't free the object, only un-share it).
+ *
+ * Accesses only flag the entry, so that they stay cheap: the next Sweep clears the flag and
+ * restarts the idle time of the entry from its own time, the age of an entry is measured at the
+ * granularity of the sweeps. The store isn't thread-safe, and references returned by an access
+ * are valid until the next Sweep.
+ */
+template <size_t SIZE>
+class AnyColdStore
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit AnyColdStore(Clock::duration coldAfter, size_t minimumSize = 256, const AnySerializer &serializer = AnySerializer::Default()) :
+        mSerializer(serializer), mColdAfter(coldAfter), mMinimumSize(minimumSize), mCompressedBytes(0)
+    {
+    }
+
+    size_t Size() const { return mEntries.size(); }
+
+    // index of the new entry
+    size_t Add(Any<SIZE> value)
+    {
+        mEntries.emplace_back(std::move(value));
+
+        return mEntries.size() - 1;
+    }
+
+    void Set(size_t index, Any<SIZE> value)
+    {
+        Entry &entry = mEntries[index];
+
+        Drop(entry);
+
+        entry.value = std::move(value);
+        entry.accessed = true;
+        entry.rejected = false;
+    }
+
+    // decompresses the entry if needed; if it can't be decoded (corrupt bytes, type no longer registered) 
+    // the entry stays compressed and the error is returned
+    AnyExpected<Any<SIZE>> TryValue(size_t index);
+
+    // decompresses the entry if needed, an empty Any (not stored in the entry) if it can't be decoded
+    Any<SIZE> &Value(size_t index);
+
+    template <typename T>
+    T &Get(size_t index) { return Value(index).template Get<T>(); }
+
+    template <typename T>
+    T *TryGet(size_t index) { return Value(index).template TryGet<T>(); }
+
+    bool IsCompressed(size_t index) const { return !mEntries[index].packed.empty(); }
+
+    // compresses the entries not accessed for coldAfter, returns their number
+    size_t Sweep(Clock::time_point now = Clock::now());
+
+    size_t CompressedBytes() const { return mCompressedBytes; }
+
+private:
+    struct Entry
+    {
+        explicit Entry(Any<SIZE> &&value) : value(std::move(value)), accessed(true), id(0), size(0), rejected(false) {}
+
+        Any<SIZE> value;
+        Clock::time_point idle;   // sweep that found the entry not accessed since the previous one
+        bool accessed;            // since the last sweep
+
+        AnySerializer::Id id;               // of the compressed payload
+        size_t size;                        // serialized size
+        std::vector<unsigned char> packed;  // empty if the payload isn't compressed
+        bool rejected;                      // not worth compressing, until the next access
+    };
+
+    void Drop(Entry &entry)
+    {
+        mCompressedBytes -= entry.packed.size();
+
+        std::vector<unsigned char>().swap(entry.packed);
+    }
+
+    const AnySerializer &mSerializer;
+    Clock::duration mColdAfter;
+    size_t mMinimumSize;
+
+    std::vector<Entry> mEntries;
+    size_t mCompressedBytes;
+
+    std::vector<unsigned char> mBuffer;   // serialized bytes, reused
+    Any<SIZE> mUndecodable;               // returned by Value for the entries that can't be decoded
+};
+
+template <size_t SIZE>
+AnyExpected<Any<SIZE>> AnyColdStore<SIZE>::TryValue(size_t index)
+{
+    Entry &entry = mEntries[index];
+
+    entry.accessed = true;
+    entry.rejected = false;
+
+    if (entry.packed.empty())
+        return &entry.value;
+
+    mBuffer.resize(entry.size);
+
+    if (!detail::LzDecompress(entry.packed.data(), entry.packed.size(), mBuffer.data(), entry.size))
+        return AnyError::Construction;
+
+    const AnyError error = mSerializer.Read(entry.id, mBuffer.data(), entry.size, entry.value);
+
+    if (error != AnyError::None)
+        return error;
+
+    Drop(entry);
+
+    return &entry.value;
+}
+
+template <size_t SIZE>
+Any<SIZE> &AnyColdStore<SIZE>::Value(size_t index)
+{
+    if (AnyExpected<Any<SIZE>> value = TryValue(index))
+        return *value;
+
+    mUndecodable = Any<SIZE>();
+
+    return mUndecodable;
+}
+
+template <size_t SIZE>
+size_t AnyColdStore<SIZE>::Sweep(Clock::time_point now)
+{
+    std::vector<unsigned char> packed;
+    size_t compressed = 0;
+
+    for (Entry &entry : mEntries)
+    {
+        if (entry.accessed)
+        {
+            entry.accessed = false;
+            entry.idle = now;
+            continue;
+        }
+
+        // only heap payloads owned by the entry alone free memory when dropped
+        if (entry.rejected || !entry.packed.empty() || entry.value.Footprint() == sizeof(Any<SIZE>) || !entry.value.OwnsObject() || now - entry.idle < mColdAfter)
+            continue;
+
+        mBuffer.clear();
+
+        AnySerializer::Id id;
+
+        if (!mSerializer.Write(entry.value, mBuffer, &id) || mBuffer.size() < mMinimumSize)
+        {
+            entry.rejected = true;
+            continue;
+        }
+
+        packed.clear();
+        detail::LzCompress(mBuffer.data(), mBuffer.size(), packed);
+
+        if (packed.size() >= mBuffer.size())
+        {
+            entry.rejected = true;
+            continue;
+        }
+
+        entry.id = id;
+        entry.size = mBuffer.size();
+        entry.packed.assign(packed.begin(), packed.end());   // exact capacity
+        entry.value = Any<SIZE>();
+
+        mCompressedBytes += entry.packed.size();
+        compressed++;
+    }
+
+    return compressed;
+}
+
+#endif  // ANY_COLD_H
@@ -0,0 +1,315 @@
+#ifndef ANY_COLUMNS_H
+#define ANY_COLUMNS_H
+
+#include "any.hpp"
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <vector>
+
+/*
+ * Arrow C data interface (https://arrow.apache.org/docs/format/CDataInterface.html),
+ * declared locally with the same guard as Arrow's abi.h so both can be included.
+ */
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+#define ARROW_FLAG_DICTIONARY_ORDERED 1
+#define ARROW_FLAG_NULLABLE 2
+#define ARROW_FLAG_MAP_KEYS_SORTED 4
+
+struct ArrowSchema
+{
+    const char *format;
+    const char *name;
+    const char *metadata;
+    int64_t flags;
+    int64_t n_children;
+    struct ArrowSchema **children;
+    struct ArrowSchema *dictionary;
+
+    void (*release)(struct ArrowSchema*);
+    void *private_data;
+};
+
+struct ArrowArray
+{
+    int64_t length;
+    int64_t null_count;
+    int64_t offset;
+    int64_t n_buffers;
+    int64_t n_children;
+    const void **buffers;
+    struct ArrowArray **children;
+    struct ArrowArray *dictionary;
+
+    void (*release)(struct ArrowArray*);
+    void *private_data;
+};
+
+#endif  // ARROW_C_DATA_INTERFACE
+
+namespace detail
+{
+    // zero-initialized buffer, aligned and padded to 64 bytes as recommended by the Arrow format
+    class ColumnBuffer
+    {
+    public:
+        static constexpr size_t ALIGNMENT = 64;
+
+        ColumnBuffer() : mData(nullptr), mSize(0) {}
+
+        explicit ColumnBuffer(size_t size) : mData(nullptr), mSize((size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT)
+        {
+            if (mSize)
+            {
+                mData = static_cast<unsigned char*>(::operator new(mSize, std::align_val_t(ALIGNMENT)));
+                std::memset(mData, 0, mSize);
+            }
+        }
+
+        ColumnBuffer(ColumnBuffer &&other) noexcept : mData(other.mData), mSize(other.mSize)
+        {
+            other.mData = nullptr;
+            other.mSize = 0;
+        }
+
+        ColumnBuffer &operator=(ColumnBuffer &&other) noexcept
+        {
+            ColumnBuffer temp(std::move(other));
+
+            std::swap(mData, temp.mData);
+            std::swap(mSize, temp.mSize);
+
+            return *this;
+        }
+
+        ~ColumnBuffer()
+        {
+            if (mData)
+                ::operator delete(mData, std::align_val_t(ALIGNMENT));
+        }
+
+        unsigned char *Data() const { return mData; }
+        size_t Size() const { return mSize; }
+    private:
+        unsigned char *mData;
+        size_t mSize;
+    };
+}
+
+/*
+ * Contiguous column of one trivially copyable type with an Arrow validity bitmap
+ * (bit i, LSB first, is set if row i contains a value of the column type).
+ */
+class AnyColumn
+{
+public:
+    AnyColumn(AnyType type, size_t length) :
+        mType(type), mLength(length), mNullCount(length), mValidity((length + 7) / 8), mValues(length * type->size)
+    {
+    }
+
+    AnyType Type() const { return mType; }
+    size_t Length() const { return mLength; }
+    size_t NullCount() const { return mNullCount; }
+
+    bool IsValid(size_t row) const { return mValidity.Data()[row / 8] & (1u << (row % 8)); }
+
+    const uint8_t *Validity() const { return mValidity.Data(); }
+    const void *Values() const { return mValues.Data(); }
+
+    template <typename T>
+    const T *Values() const
+    {
+        return mType == AnyTypeOf<T>() ? reinterpret_cast<const T*>(mValues.Data()) : nullptr;
+    }
+
+    const void *Value(size_t row) const { return mValues.Data() + row * mType->size; }
+
+    void Set(size_t row, const void *object)
+    {
+        std::memcpy(mValues.Data() + row * mType->size, object, mType->size);
+
+        mValidity.Data()[row / 8] |= static_cast<uint8_t>(1u << (row % 8));
+        mNullCount--;
+    }
+
+private:
+    friend void ExportArrow(AnyColumn &&column, ArrowArray *array, ArrowSchema *schema);
+
+    AnyType mType;
+    size_t mLength;
+    size_t mNullCount;
+
+    detail::ColumnBuffer mValidity;
+    detail::ColumnBuffer mValues;
+};
+
+/*
+ * Result of unboxing a range of Any: one column per stored type (same length as the range,
+ * like the children of an Arrow sparse union) and the column index of each row.
+ */
+class AnyColumns
+{
+public:
+    static constexpr int8_t NOT_UNBOXED = -1;  // row is empty or its type isn't trivially copyable
+
+    const std::vector<AnyColumn> &Columns() const { return mColumns; }
+    std::vector<AnyColumn> &Columns() { return mColumns; }  // columns can be moved out to ExportArrow
+    const std::vector<int8_t> &TypeIds() const { return mTypeIds; }
+
+    const AnyColumn *Find(AnyType type) const
+    {
+        for (const AnyColumn &column : mColumns)
+            if (column.Type() == type)
+                return &column;
+
+        return nullptr;
+    }
+
+    template <typename T>
+    const AnyColumn *Find() const { return Find(AnyTypeOf<T>()); }
+
+private:
+    template <typename Iterator>
+    friend AnyColumns Unbox(Iterator first, Iterator last);
+
+    std::vector<AnyColumn> mColumns;
+    std::vector<int8_t> mTypeIds;
+};
+
+// single pass over the range, rows of types that aren't trivially copyable (and empty rows) are left out
+template <typename Iterator>
+AnyColumns Unbox(Iterator first, Iterator last)
+{
+    AnyColumns result;
+
+    const size_t length = static_cast<size_t>(std::distance(first, last));
+
+    result.mTypeIds.assign(length, AnyColumns::NOT_UNBOXED);
+
+    AnyType lastType = nullptr;
+    int8_t lastColumn = AnyColumns::NOT_UNBOXED;
+
+    for (size_t row = 0; first != last; ++first, ++row)
+    {
+        AnyType type = first->Type();
+
+        if (!type || type->copy)  // empty or not trivially copyable
+            continue;
+
+        if (type != lastType)  // runs of the same type are common, skip the column lookup
+        {
+            lastType = type;
+            lastColumn = AnyColumns::NOT_UNBOXED;
+
+            for (size_t i = 0; i < result.mColumns.size(); i++)
+                if (result.mColumns[i].Type() == type)
+                    lastColumn = static_cast<int8_t>(i);
+
+            if (lastColumn == AnyColumns::NOT_UNBOXED)
+            {
+                if (result.mColumns.size() == INT8_MAX)  // Arrow union type ids are 8 bit
+                {
+                    lastType = nullptr;
+                    continue;
+                }
+
+                lastColumn = static_cast<int8_t>(result.mColumns.size());
+                result.mColumns.emplace_back(type, length);
+            }
+        }
+
+        result.mColumns[lastColumn].Set(row, first->Data());
+        result.mTypeIds[row] = lastColumn;
+    }
+
+    return result;
+}
+
+// reverse path: boxes row i of the columns into the i-th element of the output range (rows not unboxed are left untouched)
+template <typename Iterator>
+void Box(const AnyColumns &columns, Iterator first)
+{
+    const std::vector<int8_t> &typeIds = columns.TypeIds();
+
+    for (size_t row = 0; row < typeIds.size(); ++row, ++first)
+        if (typeIds[row] != AnyColumns::NOT_UNBOXED)
+        {
+            const AnyColumn &column = columns.Columns()[typeIds[row]];
+
+            first->Assign(column.Type(), column.Value(row));
+        }
+}
+
+namespace detail
+{
+    inline std::string ArrowFormat(AnyType type)
+    {
+        struct Format { AnyType type; const char *format; };
+
+        static const Format formats[] =
+        {
+            { AnyTypeOf<int8_t>(), "c" }, { AnyTypeOf<uint8_t>(), "C" },
+            { AnyTypeOf<int16_t>(), "s" }, { AnyTypeOf<uint16_t>(), "S" },
+            { AnyTypeOf<int32_t>(), "i" }, { AnyTypeOf<uint32_t>(), "I" },
+            { AnyTypeOf<int64_t>(), "l" }, { AnyTypeOf<uint64_t>(), "L" },
+            { AnyTypeOf<float>(), "f" }, { AnyTypeOf<double>(), "g" }
+        };
+
+        for (const Format &format : formats)
+            if (format.type == type)
+                return format.format;
+
+        // char and long long are distinct types from the fixed width aliases on some platforms
+        if (type == AnyTypeOf<char>())
+            return std::is_signed<char>::value ? "c" : "C";
+        if (type == AnyTypeOf<long long>() || (type == AnyTypeOf<long>() && sizeof(long) == 8))
+            return "l";
+        if (type == AnyTypeOf<unsigned long long>() || (type == AnyTypeOf<unsigned long>() && sizeof(long) == 8))
+            return "L";
+
+        return "w:" + std::to_string(type->size);  // any other trivially copyable type as fixed size binary
+    }
+
+    struct ArrowExport
+    {
+        AnyColumn column;
+        const void *buffers[2];
+    };
+
+    inline void ReleaseArrowSchema(ArrowSchema *schema)
+    {
+        delete static_cast<std::string*>(schema->private_data);
+        schema->release = nullptr;
+    }
+
+    inline void ReleaseArrowArray(ArrowArray *array)
+    {
+        delete static_cast<ArrowExport*>(array->private_data);
+        array->release = nullptr;
+    }
+}
+
+// zero-copy export of a column as an Arrow fixed-width array, the column buffers are owned by the ArrowArray
+inline void ExportArrow(AnyColumn &&column, ArrowArray *array, ArrowSchema *schema)
+{
+    std::string *format = new std::string(detail::ArrowFormat(column.Type()));
+
+    *schema = ArrowSchema{ format->c_str(), "", nullptr, ARROW_FLAG_NULLABLE, 0, nullptr, nullptr, &detail::ReleaseArrowSchema, format };
+
+    detail::ArrowExport *exported = new detail::ArrowExport{ std::move(column), { nullptr, nullptr } };
+    exported->buffers[0] = exported->column.mValidity.Data();
+    exported->buffers[1] = exported->column.mValues.Data();
+
+    *array = ArrowArray
+    {
+        static_cast<int64_t>(exported->column.mLength),
+        static_cast<int64_t>(exported->column.mNullCount),
+        0, 2, 0, exported->buffers, nullptr, nullptr, &detail::ReleaseArrowArray, exported
+    };
+}
+
+#endif  // ANY_COLUMNS_H
@@ -0,0 +1,107 @@
+#ifndef ANY_FORMAT_H
+#define ANY_FORMAT_H
+
+#include "any.hpp"
+#include <charconv>
+
+/*
+ * Text formatting of Any values (logging, AnyJsonWriter). The arithmetic, bool, char and C string types
+ * are formatted here, which keeps <charconv> out of any.hpp; other types with the format operation of
+ * their descriptor (AnyFormatter specializations, char strings).
+ * Formatting doesn't allocate.
+ */
+
+// the contained type is formattable
+template <size_t SIZE>
+bool AnyFormattable(const Any<SIZE> &any);
+
+// writes at most size chars of the object's text (not terminated), returns its full length (0 if empty or not formattable)
+template <size_t SIZE>
+size_t AnyFormat(const Any<SIZE> &any, char *buffer, size_t size);
+
+namespace detail
+{
+    template <typename T>
+    size_t FormatNumber(const void *object, char *buffer, size_t size)
+    {
+        T value;
+
+        std::memcpy(&value, object, sizeof(T));  // integers are read by size, e.g. long as long long
+
+        std::to_chars_result result = std::to_chars(buffer, buffer + size, value);
+
+        if (result.ec == std::errc())
+            return static_cast<size_t>(result.ptr - buffer);
+
+        char text[128];  // buffer too small: format aside to return the full length
+
+        result = std::to_chars(text, text + sizeof(text), value);
+
+        return FormatText(text, static_cast<size_t>(result.ptr - text), buffer, size);
+    }
+
+    template <typename Int8, typename Int16, typename Int32, typename Int64>
+    size_t FormatInteger(AnyType type, const void *object, char *buffer, size_t size)
+    {
+        switch (type->size)
+        {
+        case 1:  return FormatNumber<Int8>(object, buffer, size);
+        case 2:  return FormatNumber<Int16>(object, buffer, size);
+        case 4:  return FormatNumber<Int32>(object, buffer, size);
+        default: return FormatNumber<Int64>(object, buffer, size);
+        }
+    }
+
+    inline bool Formattable(AnyType type)
+    {
+        return type && (type->format || type->builtin != Builtin::None);
+    }
+
+    inline size_t Format(AnyType type, const void *object, char *buffer, size_t size)
+    {
+        if (type->format)
+            return type->format(object, buffer, size);
+
+        switch (type->builtin)
+        {
+        case Builtin::Bool:
+            return *static_cast<const bool*>(object) ? FormatText("true", 4, buffer, size) : FormatText("false", 5, buffer, size);
+        case Builtin::Char:
+            return FormatText(static_cast<const char*>(object), 1, buffer, size);
+        case Builtin::CString:
+        {
+            const char *text = *static_cast<const char *const*>(object);
+
+            return FormatText(text, std::strlen(text), buffer, size);
+        }
+        case Builtin::Signed:
+            return FormatInteger<std::int8_t, std::int16_t, std::int32_t, std::int64_t>(type, object, buffer, size);
+        case Builtin::Unsigned:
+            return FormatInteger<std::uint8_t, std::uint16_t, std::uint32_t, std::uint64_t>(type, object, buffer, size);
+        case Builtin::Float:
+            return FormatNumber<float>(object, buffer, size);
+        case Builtin::Double:
+            return FormatNumber<double>(object, buffer, size);
+        case Builtin::LongDouble:
+            return FormatNumber<long double>(object, buffer, size);
+        case Builtin::None:
+            break;
+        }
+
+        return 0;
+    }
+}
+
+template <size_t SIZE>
+bool AnyFormattable(const Any<SIZE> &any)
+{
+    return detail::Formattable(any.Type());
+}
+
+template <size_t SIZE>
+size_t AnyFormat(const Any<SIZE> &any, char *buffer, size_t size)
+{
+    return AnyFormattable(any) ? detail::Format(any.Type(), any.Data(), buffer, size) : 0;
+}
+
+#endif  // ANY_FORMAT_H
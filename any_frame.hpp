@@ -0,0 +1,129 @@
+#ifndef ANY_FRAME_H
+#define ANY_FRAME_H
+
+#include "any.hpp"
+#include <cassert>
+#include <cstdint>
+
+/*
+ * Scoped bump allocator for temporary Any values. While a FrameScope is alive it replaces the
+ * global operator new on the heap path of the current thread (construction, assignment and
+ * copies of allocated payloads, types with the Shared policy excepted). Destructors still run
+ * when the Any are destroyed, but the memory is only reclaimed, all at once, when the scope exits.
+ *
+ * Every Any with a payload from the frame must be destroyed before the scope exits: debug builds
+ * (without NDEBUG) count the live payloads and assert that none escaped. Scopes nest and must be
+ * destroyed in the thread that created them.
+ */
+class FrameScope : public AnyHeapResource
+{
+public:
+    explicit FrameScope(size_t initialSize = size_t(16) << 10) :
+        mPrevious(detail::ThreadHeapResource()), mChunk(nullptr), mCursor(nullptr), mEnd(nullptr), mNextSize(initialSize ? initialSize : 1024)
+    {
+    #ifndef NDEBUG
+        mLive = 0;
+    #endif
+
+        detail::ThreadHeapResource() = this;
+    }
+
+    ~FrameScope()
+    {
+        assert(detail::ThreadHeapResource() == this && "FrameScope destroyed out of order or in another thread");
+    #ifndef NDEBUG
+        assert(mLive.load(std::memory_order_relaxed) == 0 && "Any with a payload from a FrameScope escaped the scope");
+    #endif
+
+        detail::ThreadHeapResource() = mPrevious;
+
+        while (mChunk)
+        {
+            Chunk *previous = mChunk->previous;
+
+            detail::Deallocate(mChunk, alignof(Chunk));
+            mChunk = previous;
+        }
+    }
+
+    FrameScope(const FrameScope&) = delete;
+    FrameScope &operator=(const FrameScope&) = delete;
+
+    void *Allocate(const detail::VTable *type) override;
+
+    // only the destructor runs, the memory is reclaimed at scope exit
+    void Deallocate(void *, const detail::VTable *) override
+    {
+    #ifndef NDEBUG
+        mLive.fetch_sub(1, std::memory_order_relaxed);
+    #endif
+    }
+
+private:
+    struct alignas(std::max_align_t) Chunk
+    {
+        Chunk *previous;
+        size_t size;
+    };
+
+    static uintptr_t RoundUp(uintptr_t value, size_t alignment) { return (value + alignment - 1) / alignment * alignment; }
+
+    AnyHeapResource *mPrevious;
+
+    Chunk *mChunk;
+    unsigned char *mCursor;
+    unsigned char *mEnd;
+    size_t mNextSize;
+
+#ifndef NDEBUG
+    std::atomic<size_t> mLive;   // payloads allocated and not destroyed
+#endif
+};
+
+inline void *FrameScope::Allocate(const detail::VTable *type)
+{
+    const size_t alignment = type->alignment > alignof(AnyHeapResource*) ? type->alignment : alignof(AnyHeapResource*);
+    const size_t header = detail::ResourceHeaderSize(alignment);
+
+    uintptr_t start = RoundUp(reinterpret_cast<uintptr_t>(mCursor), alignment);
+    const uintptr_t end = reinterpret_cast<uintptr_t>(mEnd);
+
+    // aligning can move start past the end of the chunk
+    if (!mCursor || start > end || header + type->size > end - start)
+    {
+        // chunks grow geometrically, a single large payload gets a chunk of its own size
+        size_t size = sizeof(Chunk) + alignment + header + type->size;
+
+        if (size < mNextSize)
+            size = mNextSize;
+
+        Chunk *chunk = static_cast<Chunk*>(detail::Allocate(size, alignof(Chunk)));
+
+        if (!chunk)  // allocation can only fail in exception-free mode
+            return nullptr;
+
+        chunk->previous = mChunk;
+        chunk->size = size;
+
+        mChunk = chunk;
+        mCursor = reinterpret_cast<unsigned char*>(chunk + 1);
+        mEnd = reinterpret_cast<unsigned char*>(chunk) + size;
+        mNextSize = size * 2;
+
+        start = RoundUp(reinterpret_cast<uintptr_t>(mCursor), alignment);
+    }
+
+    void *object = reinterpret_cast<unsigned char*>(start) + header;
+
+    mCursor = static_cast<unsigned char*>(object) + type->size;
+
+    detail::ResourceOf(object) = this;
+
+#ifndef NDEBUG
+    mLive.fetch_add(1, std::memory_order_relaxed);
+#endif
+
+    return object;
+}
+
+#endif  // ANY_FRAME_H
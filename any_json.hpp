@@ -0,0 +1,160 @@
+#ifndef ANY_JSON_H
+#define ANY_JSON_H
+
+#include "any_format.hpp"
+#include <string>
+#include <string_view>
+
+/*
+ * JSON lines encoder of Any values for structured logs. Values are written with AnyFormat
+ * (any_format.hpp): text values as escaped strings, the others as literals. Empty and non formattable values are written as null.
+ * The output buffer is reused, so encoding doesn't allocate once it has grown.
+ */
+class AnyJsonWriter
+{
+public:
+    template <size_t SIZE>
+    void Value(const Any<SIZE> &any);
+
+    // {"name": value, ...} followed by a newline
+    template <size_t SIZE>
+    void Record(const char *const *names, const Any<SIZE> *values, size_t count);
+
+    // one value per line
+    template <typename Iterator>
+    void Lines(Iterator first, Iterator last);
+
+    const std::string &Text() const { return mText; }
+
+    void Clear() { mText.clear(); }
+
+private:
+    static constexpr size_t INITIAL_FORMAT_SIZE = 64;
+
+    // formats into out at offset, returns the length of the text
+    template <size_t SIZE>
+    static size_t Format(const Any<SIZE> &any, std::string &out, size_t offset);
+
+    void String(const char *text, size_t length);
+
+    std::string mText;
+    std::string mScratch;   // text values before escaping
+};
+
+template <size_t SIZE>
+size_t AnyJsonWriter::Format(const Any<SIZE> &any, std::string &out, size_t offset)
+{
+    out.resize(offset + INITIAL_FORMAT_SIZE);
+
+    size_t length = AnyFormat(any, &out[offset], INITIAL_FORMAT_SIZE);
+
+    if (length > INITIAL_FORMAT_SIZE)
+    {
+        out.resize(offset + length);
+        AnyFormat(any, &out[offset], length);
+    }
+
+    out.resize(offset + length);
+
+    return length;
+}
+
+template <size_t SIZE>
+void AnyJsonWriter::Value(const Any<SIZE> &any)
+{
+    if (!AnyFormattable(any))
+    {
+        mText += "null";
+        return;
+    }
+
+    if (any.Type()->text)
+    {
+        size_t length = Format(any, mScratch, 0);
+
+        String(mScratch.data(), length);
+        return;
+    }
+
+    const size_t offset = mText.size();
+    const size_t length = Format(any, mText, offset);
+
+    // non-finite numbers aren't valid JSON
+    const char *literal = mText.data() + offset;
+
+    if (length && (literal[0] == 'n' || literal[0] == 'i' || (literal[0] == '-' && length > 1 && (literal[1] == 'n' || literal[1] == 'i'))) &&
+        std::string_view(literal, length) != "null")
+    {
+        mText.resize(offset);
+        mText += "null";
+    }
+}
+
+template <size_t SIZE>
+void AnyJsonWriter::Record(const char *const *names, const Any<SIZE> *values, size_t count)
+{
+    mText += '{';
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if (i)
+            mText += ',';
+
+        String(names[i], std::strlen(names[i]));
+        mText += ':';
+        Value(values[i]);
+    }
+
+    mText += "}\n";
+}
+
+template <typename Iterator>
+void AnyJsonWriter::Lines(Iterator first, Iterator last)
+{
+    for (; first != last; ++first)
+    {
+        Value(*first);
+        mText += '\n';
+    }
+}
+
+inline void AnyJsonWriter::String(const char *text, size_t length)
+{
+    static const char HEX[] = "0123456789abcdef";
+
+    mText += '"';
+
+    size_t plain = 0;  // start of the run of characters copied as is
+
+    for (size_t i = 0; i < length; i++)
+    {
+        const unsigned char c = static_cast<unsigned char>(text[i]);
+
+        if (c >= 0x20 && c != '"' && c != '\\')
+            continue;
+
+        mText.append(text + plain, i - plain);
+        plain = i + 1;
+
+        switch (c)
+        {
+        case '"':  mText += "\\\""; break;
+        case '\\': mText += "\\\\"; break;
+        case '\n': mText += "\\n"; break;
+        case '\r': mText += "\\r"; break;
+        case '\t': mText += "\\t"; break;
+        case '\b': mText += "\\b"; break;
+        case '\f': mText += "\\f"; break;
+        default:
+            mText += "\\u00";
+            mText += HEX[c >> 4];
+            mText += HEX[c & 0xf];
+            break;
+        }
+    }
+
+    mText.append(text + plain, length - plain);
+    mText += '"';
+}
+
+#endif  // ANY_JSON_H
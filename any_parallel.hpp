@@ -0,0 +1,354 @@
+#ifndef ANY_PARALLEL_H
+#define ANY_PARALLEL_H
+
+#include "any.hpp"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <iterator>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/*
+ * Fixed size pool running one parallel loop at a time: Run(tasks, task) calls task(i, thread) for
+ * every i in [0, tasks) on the workers and on the calling thread (thread is in [0, Threads()),
+ * 0 for the calling thread) and returns when all tasks are done. Tasks must not call Run on the same pool.
+ * If a task throws, the tasks not started yet are skipped and Run rethrows the first exception once
+ * every thread has left the loop.
+ */
+class AnyThreadPool
+{
+public:
+    explicit AnyThreadPool(size_t threads = std::thread::hardware_concurrency());
+    ~AnyThreadPool();
+
+    AnyThreadPool(const AnyThreadPool&) = delete;
+    AnyThreadPool &operator=(const AnyThreadPool&) = delete;
+
+    size_t Threads() const { return mWorkers.size() + 1; }  // including the calling thread
+
+    template <typename F>
+    void Run(size_t tasks, F &&task);
+
+    static AnyThreadPool &Default()
+    {
+        static AnyThreadPool pool;
+
+        return pool;
+    }
+
+private:
+    void Work(size_t thread);
+    void Drain(size_t thread);
+
+    std::vector<std::thread> mWorkers;
+
+    std::mutex mRunMutex;  // serializes Run calls
+
+    std::mutex mMutex;
+    std::condition_variable mWake;
+    std::condition_variable mDone;
+
+    // current loop
+    void (*mInvoke)(void *task, size_t index, size_t thread);
+    void *mTask;
+    size_t mTasks;
+    std::atomic<size_t> mNext;
+
+#ifndef ANY_NO_EXCEPTIONS
+    std::exception_ptr mError;   // first exception thrown by a task of the current loop
+#endif
+
+    size_t mGeneration;
+    size_t mActive;   // workers that haven't finished the current loop
+    bool mStop;
+};
+
+inline AnyThreadPool::AnyThreadPool(size_t threads) :
+    mInvoke(nullptr), mTask(nullptr), mTasks(0), mNext(0), mGeneration(0), mActive(0), mStop(false)
+{
+    for (size_t i = 1; i < threads; i++)
+        mWorkers.emplace_back(&AnyThreadPool::Work, this, i);
+}
+
+inline AnyThreadPool::~AnyThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        mStop = true;
+    }
+
+    mWake.notify_all();
+
+    for (std::thread &worker : mWorkers)
+        worker.join();
+}
+
+template <typename F>
+void AnyThreadPool::Run(size_t tasks, F &&task)
+{
+    using Task = typename std::remove_reference<F>::type;
+
+    std::lock_guard<std::mutex> runLock(mRunMutex);
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        mInvoke = [](void *task, size_t index, size_t thread) { (*static_cast<Task*>(task))(index, thread); };
+        mTask = const_cast<void*>(static_cast<const void*>(&task));
+        mTasks = tasks;
+        mNext.store(0, std::memory_order_relaxed);
+
+        mActive = mWorkers.size();
+        mGeneration++;
+    }
+
+    mWake.notify_all();
+
+    Drain(0);
+
+    std::unique_lock<std::mutex> lock(mMutex);
+
+    // the workers use the task until they're done
+    mDone.wait(lock, [this]() { return mActive == 0; });
+
+#ifndef ANY_NO_EXCEPTIONS
+    if (mError)
+        std::rethrow_exception(std::exchange(mError, nullptr));
+#endif
+}
+
+inline void AnyThreadPool::Work(size_t thread)
+{
+    size_t generation = 0;
+
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+
+            mWake.wait(lock, [&]() { return mStop || mGeneration != generation; });
+
+            if (mStop)
+                return;
+
+            generation = mGeneration;
+        }
+
+        Drain(thread);
+
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        if (--mActive == 0)
+            mDone.notify_one();
+    }
+}
+
+inline void AnyThreadPool::Drain(size_t thread)
+{
+    for (size_t index; (index = mNext.fetch_add(1, std::memory_order_relaxed)) < mTasks; )
+    {
+    #ifdef ANY_NO_EXCEPTIONS
+        mInvoke(mTask, index, thread);
+    #else
+        try
+        {
+            mInvoke(mTask, index, thread);
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+
+            if (!mError)
+                mError = std::current_exception();
+
+            mNext.store(mTasks, std::memory_order_relaxed);  // skip the tasks not started yet
+        }
+    #endif
+    }
+}
+
+template <typename... Ts>
+struct AnyTypeList {};
+
+struct AnyParallelOptions
+{
+    size_t chunkSize = 0;            // elements per chunk, 0 to fit a chunk of Any objects in the L1 cache
+    bool deterministic = true;       // combine partial reductions in chunk order (independent of the number of threads)
+    AnyThreadPool *pool = nullptr;   // nullptr for AnyThreadPool::Default()
+};
+
+namespace detail
+{
+    constexpr size_t PARALLEL_CHUNK_BYTES = 32 * 1024;
+
+    template <typename Iterator>
+    size_t ChunkSize(const AnyParallelOptions &options)
+    {
+        if (options.chunkSize)
+            return options.chunkSize;
+
+        size_t elementSize = sizeof(typename std::iterator_traits<Iterator>::value_type);
+
+        return std::max<size_t>(PARALLEL_CHUNK_BYTES / elementSize, 1);
+    }
+
+    /*
+     * Groups the elements of a chunk by type, so each listed type is processed
+     * in a tight loop with a statically typed Get instead of a type test per element.
+     */
+    template <typename... Ts>
+    class TypeBuckets
+    {
+        static_assert(sizeof...(Ts) > 0, "at least one type is needed");
+
+    public:
+        template <typename Iterator>
+        void Fill(Iterator first, size_t begin, size_t end)
+        {
+            static constexpr AnyType types[] = { AnyTypeOf<Ts>()... };
+
+            for (std::vector<size_t> &bucket : mBuckets)
+                bucket.clear();
+
+            for (size_t i = begin; i < end; i++)
+            {
+                AnyType type = first[i].Type();
+
+                for (size_t t = 0; t < sizeof...(Ts); t++)
+                    if (types[t] == type)
+                    {
+                        mBuckets[t].push_back(i);
+                        break;
+                    }
+            }
+        }
+
+        // f(index, object) for every bucketed element, one type after the other
+        template <typename Iterator, typename F>
+        void Visit(Iterator first, F &&f) const
+        {
+            Visit(first, f, std::index_sequence_for<Ts...>());
+        }
+
+    private:
+        template <typename Iterator, typename F, size_t... I>
+        void Visit(Iterator first, F &f, std::index_sequence<I...>) const
+        {
+            (VisitBucket<Ts>(first, f, mBuckets[I]), ...);
+        }
+
+        template <typename T, typename Iterator, typename F>
+        static void VisitBucket(Iterator first, F &f, const std::vector<size_t> &bucket)
+        {
+            for (size_t index : bucket)
+                f(index, first[index].template Get<T>());
+        }
+
+        std::vector<size_t> mBuckets[sizeof...(Ts)];
+    };
+
+    // runs chunk(index, thread, buckets) over the range in cache sized chunks
+    template <typename... Ts, typename Iterator, typename F>
+    void ForEachChunk(Iterator first, Iterator last, const AnyParallelOptions &options, F &&chunk)
+    {
+        const size_t size = static_cast<size_t>(last - first);
+        const size_t chunkSize = ChunkSize<Iterator>(options);
+        const size_t chunks = (size + chunkSize - 1) / chunkSize;
+
+        AnyThreadPool &pool = options.pool ? *options.pool : AnyThreadPool::Default();
+
+        pool.Run(chunks, [&](size_t index, size_t thread)
+        {
+            thread_local TypeBuckets<Ts...> buckets;
+
+            size_t begin = index * chunkSize;
+            size_t end = std::min(begin + chunkSize, size);
+
+            buckets.Fill(first, begin, end);
+            chunk(index, thread, buckets);
+        });
+    }
+}
+
+// out[i] = f(first[i].Get<T>()) for the elements whose type is listed, other outputs are left untouched
+template <typename... Ts, typename Iterator, typename OutIterator, typename F>
+void ParallelTransform(AnyTypeList<Ts...>, Iterator first, Iterator last, OutIterator out, F f, const AnyParallelOptions &options = {})
+{
+    detail::ForEachChunk<Ts...>(first, last, options, [&](size_t, size_t, const detail::TypeBuckets<Ts...> &buckets)
+    {
+        buckets.Visit(first, [&](size_t index, const auto &object) { out[index] = f(object); });
+    });
+}
+
+// indices (ascending) of the elements whose type is listed and that satisfy pred
+template <typename... Ts, typename Iterator, typename Predicate>
+std::vector<size_t> ParallelFilter(AnyTypeList<Ts...>, Iterator first, Iterator last, Predicate pred, const AnyParallelOptions &options = {})
+{
+    const size_t chunkSize = detail::ChunkSize<Iterator>(options);
+    std::vector<std::vector<size_t>> selected((static_cast<size_t>(last - first) + chunkSize - 1) / chunkSize);
+
+    detail::ForEachChunk<Ts...>(first, last, options, [&](size_t chunk, size_t, const detail::TypeBuckets<Ts...> &buckets)
+    {
+        std::vector<size_t> &indices = selected[chunk];
+
+        buckets.Visit(first, [&](size_t index, const auto &object)
+        {
+            if (pred(object))
+                indices.push_back(index);
+        });
+
+        std::sort(indices.begin(), indices.end());  // buckets visit the chunk type by type
+    });
+
+    std::vector<size_t> result;
+
+    for (const std::vector<size_t> &indices : selected)
+        result.insert(result.end(), indices.begin(), indices.end());
+
+    return result;
+}
+
+/*
+ * reduce(R, const T&) -> R folds the elements whose type is listed, combine(R, R) -> R merges partial results.
+ * init must be an identity of combine. In deterministic mode partials are kept per chunk and combined in
+ * chunk order, otherwise per thread.
+ */
+template <typename... Ts, typename Iterator, typename R, typename Reduce, typename Combine>
+R ParallelReduce(AnyTypeList<Ts...>, Iterator first, Iterator last, R init, Reduce reduce, Combine combine, const AnyParallelOptions &options = {})
+{
+    const size_t chunkSize = detail::ChunkSize<Iterator>(options);
+    const size_t chunks = (static_cast<size_t>(last - first) + chunkSize - 1) / chunkSize;
+
+    struct alignas(ANY_CACHE_LINE_SIZE) Partial
+    {
+        R value;
+        bool used = false;
+    };
+
+    AnyThreadPool &pool = options.pool ? *options.pool : AnyThreadPool::Default();
+
+    std::vector<Partial> partials(options.deterministic ? chunks : pool.Threads(), Partial{ init });
+
+    detail::ForEachChunk<Ts...>(first, last, options, [&](size_t chunk, size_t thread, const detail::TypeBuckets<Ts...> &buckets)
+    {
+        Partial &partial = partials[options.deterministic ? chunk : thread];
+
+        buckets.Visit(first, [&](size_t, const auto &object) { partial.value = reduce(std::move(partial.value), object); });
+        partial.used = true;
+    });
+
+    R result = std::move(init);
+
+    for (Partial &partial : partials)
+        if (partial.used)
+            result = combine(std::move(result), std::move(partial.value));
+
+    return result;
+}
+
+#endif  // ANY_PARALLEL_H
@@ -0,0 +1,278 @@
+#ifndef ANY_POOL_H
+#define ANY_POOL_H
+
+#include "any.hpp"
+#include <atomic>
+#include <cassert>
+#include <mutex>
+#include <vector>
+
+/*
+ * Thread-owned pools for the heap payloads of Any handed from producer to consumer threads.
+ * Each thread has its own pool (AnyPool::Thread()) of size classes carved from 64KB slabs; the
+ * payloads remember their pool in the resource header. A payload destroyed in the owning thread
+ * goes straight back on the class free list, one destroyed in another thread is pushed on a
+ * lock-free list of the pool (one per class) that the owner takes as a whole, in a single exchange,
+ * when its own free list runs dry. Neither side ever takes a lock or touches the global allocator.
+ *
+ * Allocate from the owning thread only: through AnyPoolScope, which makes the pool of the thread
+ * replace operator new on the heap path (like FrameScope), or with Any::EmplaceIn(AnyPool::Thread()).
+ * The pool of a finished thread is kept, with its slabs, and adopted by the next thread starting.
+ * Payloads over 32KB or over-aligned aren't pooled. Allocate returns nullptr when out of memory,
+ * which Any reports as std::bad_alloc (AnyError::OutOfMemory from TryEmplace).
+ */
+class AnyPool : public AnyHeapResource
+{
+public:
+    static constexpr size_t MAX_POOLED_SIZE = size_t(32) << 10;   // header included
+    static constexpr size_t SLAB_SIZE = size_t(64) << 10;
+
+    // pool of the current thread
+    static AnyPool &Thread();
+
+    AnyPool(const AnyPool&) = delete;
+    AnyPool &operator=(const AnyPool&) = delete;
+
+    void *Allocate(const detail::VTable *type) override;
+    void Deallocate(void *object, const detail::VTable *type) override;
+
+private:
+    static constexpr size_t BLOCK_ALIGNMENT = 16;
+    static constexpr size_t SMALL_CLASSES = 64;           // 16 to 1024 bytes by steps of 16
+    static constexpr size_t CLASSES = SMALL_CLASSES + 5;  // then 2KB to 32KB by powers of two
+
+    struct alignas(ANY_CACHE_LINE_SIZE) RemoteList
+    {
+        std::atomic<void*> head{ nullptr };
+    };
+
+    // pools are recycled, never destroyed: payloads freed after their thread exited still find them
+    struct Registry
+    {
+        std::mutex mutex;
+        std::vector<AnyPool*> abandoned;
+
+        static Registry &Get()
+        {
+            static Registry *registry = new Registry();
+
+            return *registry;
+        }
+    };
+
+    struct ThreadOwner
+    {
+        ThreadOwner();
+        ~ThreadOwner();
+
+        AnyPool *pool;
+    };
+
+    AnyPool() : mCursor(nullptr), mEnd(nullptr)
+    {
+        for (void *&free : mFree)
+            free = nullptr;
+    }
+
+    ~AnyPool() = default;
+
+    // pool owned by the current thread, nullptr before Thread() and after the thread's exit
+    static AnyPool *&Current()
+    {
+        thread_local AnyPool *current = nullptr;
+
+        return current;
+    }
+
+    static size_t Alignment(const detail::VTable *type)
+    {
+        return type->alignment > alignof(AnyHeapResource*) ? type->alignment : alignof(AnyHeapResource*);
+    }
+
+    static bool Pooled(size_t alignment, size_t block) { return alignment <= BLOCK_ALIGNMENT && block <= MAX_POOLED_SIZE; }
+
+    static size_t ClassOf(size_t block)
+    {
+        if (block <= SMALL_CLASSES * BLOCK_ALIGNMENT)
+            return (block + BLOCK_ALIGNMENT - 1) / BLOCK_ALIGNMENT - 1;
+
+        size_t index = SMALL_CLASSES;
+
+        for (size_t size = 2 * SMALL_CLASSES * BLOCK_ALIGNMENT; size < block; size <<= 1)
+            index++;
+
+        return index;
+    }
+
+    static size_t ClassSize(size_t index)
+    {
+        return index < SMALL_CLASSES ? (index + 1) * BLOCK_ALIGNMENT : (2 * SMALL_CLASSES * BLOCK_ALIGNMENT) << (index - SMALL_CLASSES);
+    }
+
+    void *Carve(size_t size);
+
+    // owner only
+    void *mFree[CLASSES];
+    unsigned char *mCursor;
+    unsigned char *mEnd;
+    std::vector<void*> mSlabs;
+
+    RemoteList mRemote[CLASSES];
+};
+
+/*
+ * Makes the pool of the current thread replace operator new on the heap path of the thread
+ * for the lifetime of the scope. Scopes nest with FrameScope.
+ */
+class AnyPoolScope
+{
+public:
+    AnyPoolScope() : mPrevious(detail::ThreadHeapResource()) { detail::ThreadHeapResource() = &AnyPool::Thread(); }
+    ~AnyPoolScope() { detail::ThreadHeapResource() = mPrevious; }
+
+    AnyPoolScope(const AnyPoolScope&) = delete;
+    AnyPoolScope &operator=(const AnyPoolScope&) = delete;
+
+private:
+    AnyHeapResource *mPrevious;
+};
+
+inline AnyPool::ThreadOwner::ThreadOwner() : pool(nullptr)
+{
+    Registry &registry = Registry::Get();
+
+    {
+        std::lock_guard<std::mutex> lock(registry.mutex);
+
+        if (!registry.abandoned.empty())
+        {
+            pool = registry.abandoned.back();
+            registry.abandoned.pop_back();
+        }
+    }
+
+    if (!pool)
+        pool = new AnyPool();
+
+    Current() = pool;
+}
+
+inline AnyPool::ThreadOwner::~ThreadOwner()
+{
+    // payloads destroyed from now on in this thread (other thread_local objects) go to the remote lists
+    Current() = nullptr;
+
+    Registry &registry = Registry::Get();
+
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.abandoned.push_back(pool);
+}
+
+inline AnyPool &AnyPool::Thread()
+{
+    thread_local ThreadOwner owner;
+
+    return *owner.pool;
+}
+
+inline void *AnyPool::Allocate(const detail::VTable *type)
+{
+    const size_t alignment = Alignment(type);
+    const size_t header = detail::ResourceHeaderSize(alignment);
+
+    void *block;
+
+    if (!Pooled(alignment, header + type->size))
+        block = detail::Allocate(header + type->size, alignment, std::nothrow);
+    else
+    {
+        assert(Current() == this && "AnyPool used to allocate from a thread that doesn't own it");
+
+        const size_t index = ClassOf(header + type->size);
+
+        if (!mFree[index])  // take the payloads freed by other threads
+            mFree[index] = mRemote[index].head.exchange(nullptr, std::memory_order_acquire);
+
+        if ((block = mFree[index]))
+            mFree[index] = *static_cast<void**>(block);
+        else
+            block = Carve(ClassSize(index));
+    }
+
+    if (!block)
+        return nullptr;
+
+    void *object = static_cast<unsigned char*>(block) + header;
+
+    detail::ResourceOf(object) = this;
+
+    return object;
+}
+
+inline void AnyPool::Deallocate(void *object, const detail::VTable *type)
+{
+    const size_t alignment = Alignment(type);
+    const size_t header = detail::ResourceHeaderSize(alignment);
+
+    void *block = static_cast<unsigned char*>(object) - header;
+
+    if (!Pooled(alignment, header + type->size))
+    {
+        detail::Deallocate(block, alignment);
+        return;
+    }
+
+    const size_t index = ClassOf(header + type->size);
+
+    if (Current() == this)
+    {
+        *static_cast<void**>(block) = mFree[index];
+        mFree[index] = block;
+        return;
+    }
+
+    // only the owner pops, and it takes the whole list, so there's no ABA
+    std::atomic<void*> &head = mRemote[index].head;
+    void *next = head.load(std::memory_order_relaxed);
+
+    do
+        *static_cast<void**>(block) = next;
+    while (!head.compare_exchange_weak(next, block, std::memory_order_release, std::memory_order_relaxed));
+}
+
+inline void *AnyPool::Carve(size_t size)
+{
+    if (size > static_cast<size_t>(mEnd - mCursor))
+    {
+        // the end of the previous slab is left unused
+        void *slab = detail::Allocate(SLAB_SIZE, BLOCK_ALIGNMENT, std::nothrow);
+
+        if (!slab)
+            return nullptr;
+
+    #ifdef ANY_NO_EXCEPTIONS
+        mSlabs.push_back(slab);
+    #else
+        try
+        {
+            mSlabs.push_back(slab);
+        }
+        catch (const std::bad_alloc&)
+        {
+            detail::Deallocate(slab, BLOCK_ALIGNMENT);
+            return nullptr;
+        }
+    #endif
+
+        mCursor = static_cast<unsigned char*>(slab);
+        mEnd = mCursor + SLAB_SIZE;
+    }
+
+    void *block = mCursor;
+
+    mCursor += size;
+
+    return block;
+}
+
+#endif  // ANY_POOL_H
@@ -0,0 +1,360 @@
+#ifndef ANY_PROFILE_H
+#define ANY_PROFILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * Profiling of Any SIZE choices. Compiling with ANY_PROFILE makes every Any record, per
+ * instantiation (SIZE), call-site tag and stored type size, how many objects are stored
+ * (constructed or assigned) and how many are copied or moved. AnyProfile::Dump writes the
+ * counters to a file and AnySizeAdvisor reads them back and recommends a SIZE per instantiation
+ * and tag. Without ANY_PROFILE the tags compile to nothing and no counters are recorded.
+ */
+
+// tags the Any operations of the current thread during its lifetime (tag must outlive the profile)
+class AnyProfileTag
+{
+public:
+#ifdef ANY_PROFILE
+    explicit AnyProfileTag(const char *tag);
+    ~AnyProfileTag();
+#else
+    explicit AnyProfileTag(const char *) {}
+#endif
+
+    AnyProfileTag(const AnyProfileTag&) = delete;
+    AnyProfileTag &operator=(const AnyProfileTag&) = delete;
+
+#ifdef ANY_PROFILE
+private:
+    const char *mPrevious;
+#endif
+};
+
+struct AnyProfileRecord
+{
+    size_t anySize;     // SIZE of the Any instantiation
+    std::string tag;    // empty if untagged
+    size_t typeSize;    // sizeof the stored type
+    uint64_t stores;
+    uint64_t copies;
+    uint64_t moves;
+};
+
+class AnyProfile
+{
+public:
+    // counters of all threads, merged by instantiation, tag and type size
+    static std::vector<AnyProfileRecord> Snapshot();
+
+    static void Reset();
+
+    // one record per line: anySize typeSize stores copies moves tag (tab separated)
+    static bool Dump(const char *path);
+    static bool Load(const char *path, std::vector<AnyProfileRecord> &records);
+};
+
+struct AnySizeAdvice
+{
+    size_t anySize;
+    std::string tag;
+    size_t recommended;
+    uint64_t instances;                // Any objects created (stores, copies and moves)
+    uint64_t allocations;              // heap allocations with the current SIZE
+    uint64_t recommendedAllocations;   // heap allocations with the recommended SIZE
+};
+
+/*
+ * Recommends the SIZE (a multiple of 8) minimizing, for each instantiation and tag,
+ *   instances * SIZE + allocations * (allocationCost + type size)
+ * i.e. the small buffers of all the Any created against the heap payloads and the cost of each
+ * allocation expressed in bytes. Alignment and storage policies aren't taken into account.
+ */
+std::vector<AnySizeAdvice> AnySizeAdvisor(const std::vector<AnyProfileRecord> &records, double allocationCost = 64);
+
+namespace detail
+{
+    enum class ProfileEvent
+    {
+        Store,
+        Copy,
+        Move
+    };
+
+    struct ProfileKey
+    {
+        size_t anySize;
+        const char *tag;
+        size_t typeSize;
+
+        bool operator==(const ProfileKey &other) const { return anySize == other.anySize && tag == other.tag && typeSize == other.typeSize; }
+    };
+
+    struct ProfileKeyHash
+    {
+        size_t operator()(const ProfileKey &key) const
+        {
+            return std::hash<const void*>()(key.tag) ^ (key.anySize * 0x9e3779b97f4a7c15ull) ^ (key.typeSize << 20);
+        }
+    };
+
+    struct ProfileCounters
+    {
+        uint64_t stores = 0;
+        uint64_t copies = 0;
+        uint64_t moves = 0;
+    };
+
+    // counters of a thread, the lock is only contended while a snapshot is taken
+    struct ProfileTable
+    {
+        std::mutex mutex;
+        std::unordered_map<ProfileKey, ProfileCounters, ProfileKeyHash> counters;
+    };
+
+    // tables outlive their threads so that the counters of finished threads are kept
+    struct ProfileRegistry
+    {
+        std::mutex mutex;
+        std::vector<std::shared_ptr<ProfileTable>> tables;
+
+        static ProfileRegistry &Get()
+        {
+            static ProfileRegistry registry;
+
+            return registry;
+        }
+    };
+
+    inline ProfileTable &ThreadProfile()
+    {
+        thread_local std::shared_ptr<ProfileTable> table = []()
+        {
+            auto created = std::make_shared<ProfileTable>();
+            ProfileRegistry &registry = ProfileRegistry::Get();
+
+            std::lock_guard<std::mutex> lock(registry.mutex);
+            registry.tables.push_back(created);
+
+            return created;
+        }();
+
+        return *table;
+    }
+
+    inline const char *&ProfileTag()
+    {
+        thread_local const char *tag = "";
+
+        return tag;
+    }
+
+    inline void Profile(ProfileEvent event, size_t anySize, size_t typeSize, size_t count = 1)
+    {
+        ProfileTable &table = ThreadProfile();
+
+        std::lock_guard<std::mutex> lock(table.mutex);
+
+        ProfileCounters &counters = table.counters[ProfileKey{ anySize, ProfileTag(), typeSize }];
+
+        switch (event)
+        {
+        case ProfileEvent::Store:
+            counters.stores += count;
+            break;
+        case ProfileEvent::Copy:
+            counters.copies += count;
+            break;
+        case ProfileEvent::Move:
+            counters.moves += count;
+            break;
+        }
+    }
+}
+
+#ifdef ANY_PROFILE
+inline AnyProfileTag::AnyProfileTag(const char *tag) : mPrevious(detail::ProfileTag())
+{
+    detail::ProfileTag() = tag ? tag : "";
+}
+
+inline AnyProfileTag::~AnyProfileTag()
+{
+    detail::ProfileTag() = mPrevious;
+}
+#endif
+
+inline std::vector<AnyProfileRecord> AnyProfile::Snapshot()
+{
+    detail::ProfileRegistry &registry = detail::ProfileRegistry::Get();
+
+    // tags are merged by content, the same tag may be a different pointer in each translation unit
+    std::map<std::tuple<size_t, std::string, size_t>, detail::ProfileCounters> merged;
+
+    std::lock_guard<std::mutex> registryLock(registry.mutex);
+
+    for (const auto &table : registry.tables)
+    {
+        std::lock_guard<std::mutex> lock(table->mutex);
+
+        for (const auto &entry : table->counters)
+        {
+            detail::ProfileCounters &counters = merged[std::make_tuple(entry.first.anySize, std::string(entry.first.tag), entry.first.typeSize)];
+
+            counters.stores += entry.second.stores;
+            counters.copies += entry.second.copies;
+            counters.moves += entry.second.moves;
+        }
+    }
+
+    std::vector<AnyProfileRecord> records;
+
+    for (const auto &entry : merged)
+        records.push_back(AnyProfileRecord{ std::get<0>(entry.first), std::get<1>(entry.first), std::get<2>(entry.first),
+                                            entry.second.stores, entry.second.copies, entry.second.moves });
+
+    return records;
+}
+
+inline void AnyProfile::Reset()
+{
+    detail::ProfileRegistry &registry = detail::ProfileRegistry::Get();
+
+    std::lock_guard<std::mutex> registryLock(registry.mutex);
+
+    for (const auto &table : registry.tables)
+    {
+        std::lock_guard<std::mutex> lock(table->mutex);
+
+        table->counters.clear();
+    }
+}
+
+inline bool AnyProfile::Dump(const char *path)
+{
+    std::FILE *file = std::fopen(path, "w");
+
+    if (!file)
+        return false;
+
+    bool written = true;
+
+    for (const AnyProfileRecord &record : Snapshot())
+        written = std::fprintf(file, "%zu\t%zu\t%llu\t%llu\t%llu\t%s\n", record.anySize, record.typeSize,
+                               static_cast<unsigned long long>(record.stores), static_cast<unsigned long long>(record.copies),
+                               static_cast<unsigned long long>(record.moves), record.tag.c_str()) > 0 && written;
+
+    return std::fclose(file) == 0 && written;
+}
+
+inline bool AnyProfile::Load(const char *path, std::vector<AnyProfileRecord> &records)
+{
+    std::FILE *file = std::fopen(path, "r");
+
+    if (!file)
+        return false;
+
+    char line[1024];
+    bool valid = true;
+
+    while (valid && std::fgets(line, sizeof(line), file))
+    {
+        AnyProfileRecord record;
+        unsigned long long stores, copies, moves;
+        int tagOffset = 0;
+
+        valid = std::sscanf(line, "%zu\t%zu\t%llu\t%llu\t%llu\t%n", &record.anySize, &record.typeSize, &stores, &copies, &moves, &tagOffset) == 5 && tagOffset > 0;
+
+        if (!valid)
+            break;
+
+        record.tag = line + tagOffset;
+
+        while (!record.tag.empty() && (record.tag.back() == '\n' || record.tag.back() == '\r'))
+            record.tag.pop_back();
+
+        record.stores = stores;
+        record.copies = copies;
+        record.moves = moves;
+
+        records.push_back(std::move(record));
+    }
+
+    std::fclose(file);
+
+    return valid;
+}
+
+inline std::vector<AnySizeAdvice> AnySizeAdvisor(const std::vector<AnyProfileRecord> &records, double allocationCost)
+{
+    std::map<std::pair<size_t, std::string>, std::vector<const AnyProfileRecord*>> groups;
+
+    for (const AnyProfileRecord &record : records)
+        groups[std::make_pair(record.anySize, record.tag)].push_back(&record);
+
+    std::vector<AnySizeAdvice> advice;
+
+    for (const auto &group : groups)
+    {
+        uint64_t instances = 0;
+        size_t largest = 0;
+
+        for (const AnyProfileRecord *record : group.second)
+        {
+            instances += record->stores + record->copies + record->moves;
+            largest = record->typeSize > largest ? record->typeSize : largest;
+        }
+
+        auto allocations = [&](size_t size)
+        {
+            uint64_t count = 0;
+
+            for (const AnyProfileRecord *record : group.second)
+                if (record->typeSize > size)
+                    count += record->stores + record->copies;  // moves steal the payload
+
+            return count;
+        };
+
+        auto cost = [&](size_t size)
+        {
+            double total = static_cast<double>(instances) * static_cast<double>(size);
+
+            for (const AnyProfileRecord *record : group.second)
+                if (record->typeSize > size)
+                    total += static_cast<double>(record->stores + record->copies) * (allocationCost + static_cast<double>(record->typeSize));
+
+            return total;
+        };
+
+        size_t best = 8;
+        double bestCost = cost(best);
+
+        for (size_t size = 16; size < largest + 8; size += 8)
+        {
+            double candidate = cost(size);
+
+            if (candidate < bestCost)
+            {
+                best = size;
+                bestCost = candidate;
+            }
+        }
+
+        advice.push_back(AnySizeAdvice{ group.first.first, group.first.second, best, instances, allocations(group.first.first), allocations(best) });
+    }
+
+    return advice;
+}
+
+#endif  // ANY_PROFILE_H
@@ -0,0 +1,187 @@
+#ifndef ANY_RECLAIMER_H
+#define ANY_RECLAIMER_H
+
+#include "any.hpp"
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * Background thread destroying the large heap payloads of Any on behalf of latency-sensitive
+ * threads. Within an AnyReclaimerScope, ~Any (and assignments) hand the payloads of at least
+ * minimumSize bytes, or of types with AnyDeferredDestruction, to a bounded queue instead of
+ * destroying them; the reclaimer thread takes them in batches and destroys them out of the lock.
+ *
+ * When the queue is full the payload is destroyed in place (Overflow::Inline), or the thread waits
+ * for room (Overflow::Wait). The types must be safe to destroy from another thread. Payloads
+ * from resources (arenas, frames, pools) and shared payloads aren't deferred.
+ */
+class AnyReclaimer : public AnyDeferredDestroyer
+{
+public:
+    enum class Overflow : unsigned char
+    {
+        Inline,   // destroy in the calling thread
+        Wait      // block until the reclaimer makes room
+    };
+
+    explicit AnyReclaimer(size_t minimumSize = 4096, size_t capacity = 4096, size_t batch = 64, Overflow overflow = Overflow::Inline) :
+        AnyDeferredDestroyer(minimumSize), mQueue(capacity ? capacity : 1), mHead(0), mCount(0),
+        mBatch(batch ? batch : 1), mOverflow(overflow), mBusy(false), mStop(false), mDeferred(0), mOverflowed(0)
+    {
+        mThread = std::thread([this]() { Run(); });
+    }
+
+    // destroys the pending payloads, the scopes using the reclaimer must have exited
+    ~AnyReclaimer()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mStop = true;
+        }
+
+        mNotEmpty.notify_one();
+        mThread.join();
+    }
+
+    AnyReclaimer(const AnyReclaimer&) = delete;
+    AnyReclaimer &operator=(const AnyReclaimer&) = delete;
+
+    bool Defer(const detail::VTable *type, void *object) override;
+
+    // waits until the payloads deferred so far are destroyed
+    void Flush()
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mNotFull.wait(lock, [this]() { return !mCount && !mBusy; });
+    }
+
+    size_t Deferred() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        return mDeferred;
+    }
+
+    // payloads destroyed in place because the queue was full
+    size_t Overflowed() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        return mOverflowed;
+    }
+
+private:
+    struct Payload
+    {
+        const detail::VTable *type;
+        void *object;
+    };
+
+    void Run();
+
+    std::vector<Payload> mQueue;   // ring buffer
+    size_t mHead;
+    size_t mCount;
+    size_t mBatch;
+    Overflow mOverflow;
+    bool mBusy;                    // the reclaimer is destroying a batch
+    bool mStop;
+
+    size_t mDeferred;
+    size_t mOverflowed;
+
+    mutable std::mutex mMutex;
+    std::condition_variable mNotEmpty;
+    std::condition_variable mNotFull;
+
+    std::thread mThread;
+};
+
+/*
+ * Installs a reclaimer in the current thread for the lifetime of the scope.
+ */
+class AnyReclaimerScope
+{
+public:
+    explicit AnyReclaimerScope(AnyReclaimer &reclaimer) : mPrevious(detail::ThreadDestroyer()) { detail::ThreadDestroyer() = &reclaimer; }
+    ~AnyReclaimerScope() { detail::ThreadDestroyer() = mPrevious; }
+
+    AnyReclaimerScope(const AnyReclaimerScope&) = delete;
+    AnyReclaimerScope &operator=(const AnyReclaimerScope&) = delete;
+
+private:
+    AnyDeferredDestroyer *mPrevious;
+};
+
+inline bool AnyReclaimer::Defer(const detail::VTable *type, void *object)
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+
+    if (mCount == mQueue.size())
+    {
+        if (mOverflow == Overflow::Inline || mStop)
+        {
+            mOverflowed++;
+            return false;
+        }
+
+        mNotFull.wait(lock, [this]() { return mCount < mQueue.size(); });
+    }
+
+    mQueue[(mHead + mCount) % mQueue.size()] = Payload{ type, object };
+    mDeferred++;
+
+    // the reclaimer only sleeps on an empty queue
+    if (mCount++ == 0)
+    {
+        lock.unlock();
+        mNotEmpty.notify_one();
+    }
+
+    return true;
+}
+
+inline void AnyReclaimer::Run()
+{
+    std::vector<Payload> batch;
+
+    batch.reserve(mBatch);
+
+    std::unique_lock<std::mutex> lock(mMutex);
+
+    for (;;)
+    {
+        mNotEmpty.wait(lock, [this]() { return mCount || mStop; });
+
+        if (!mCount)  // stopped and drained
+            return;
+
+        while (mCount && batch.size() < mBatch)
+        {
+            batch.push_back(mQueue[mHead]);
+
+            mHead = (mHead + 1) % mQueue.size();
+            mCount--;
+        }
+
+        mBusy = true;
+        lock.unlock();
+
+        mNotFull.notify_all();
+
+        for (const Payload &payload : batch)
+            detail::HeapDestroy(payload.type, payload.object);
+
+        batch.clear();
+
+        lock.lock();
+        mBusy = false;
+
+        if (!mCount)  // wake Flush
+            mNotFull.notify_all();
+    }
+}
+
+#endif  // ANY_RECLAIMER_H
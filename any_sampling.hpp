@@ -0,0 +1,341 @@
+#ifndef ANY_SAMPLING_H
+#define ANY_SAMPLING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+/*
+ * Sampling of the cost of Any copies, moves and destructions. Compiling with ANY_SAMPLE makes
+ * one operation in about ANY_SAMPLE_RATE per thread measure the cycles (rdtsc, or the virtual
+ * counter on ARM, or nanoseconds elsewhere) spent copying, relocating or destroying the object.
+ * Samples are aggregated into log-linear histograms per thread, keyed by type descriptor, SIZE
+ * and operation, and merged by AnySampler::Snapshot. The operations that aren't sampled only
+ * decrement a thread-local counter. Without ANY_SAMPLE nothing is compiled in.
+ */
+#ifndef ANY_SAMPLE_RATE
+#define ANY_SAMPLE_RATE 1024
+#endif
+
+// same as any.hpp, which this header doesn't include (any.hpp includes it in sampling mode)
+#ifndef ANY_COLD
+#if defined(__GNUC__) || defined(__clang__)
+#define ANY_COLD __attribute__((cold, noinline))
+#elif defined(_MSC_VER)
+#define ANY_COLD __declspec(noinline)
+#else
+#define ANY_COLD
+#endif
+#endif
+
+namespace detail
+{
+    struct VTable;
+}
+
+enum class AnySampleOp : unsigned char
+{
+    Copy,
+    Move,      // relocation of an inline object (allocated objects are moved by pointer)
+    Destroy
+};
+
+/*
+ * Log-linear histogram: values below 4 have their own bucket, then each power of two is split
+ * in 4 linear buckets (relative error under 25%).
+ */
+struct AnySampleHistogram
+{
+    static constexpr unsigned SUB_BITS = 2;
+    static constexpr size_t BUCKETS = 64 << SUB_BITS;
+
+    const detail::VTable *type;   // AnyType
+    size_t anySize;
+    AnySampleOp op;
+
+    uint64_t samples = 0;
+    uint64_t total = 0;           // sum of the sampled cycles
+    uint64_t max = 0;
+    uint64_t buckets[BUCKETS] = {};
+
+    static size_t Bucket(uint64_t value)
+    {
+        if (value < (uint64_t(1) << SUB_BITS))
+            return static_cast<size_t>(value);
+
+        unsigned exponent = 63;
+
+    #if defined(__GNUC__) || defined(__clang__)
+        exponent -= static_cast<unsigned>(__builtin_clzll(value));
+    #else
+        while (!(value >> exponent))
+            exponent--;
+    #endif
+
+        return ((exponent - SUB_BITS + 1) << SUB_BITS) + static_cast<size_t>((value >> (exponent - SUB_BITS)) & ((1 << SUB_BITS) - 1));
+    }
+
+    // smallest value of a bucket
+    static uint64_t BucketValue(size_t bucket)
+    {
+        if (bucket < (size_t(1) << SUB_BITS))
+            return bucket;
+
+        unsigned exponent = static_cast<unsigned>(bucket >> SUB_BITS) + SUB_BITS - 1;
+
+        return (uint64_t(1) << exponent) + (uint64_t(bucket & ((1 << SUB_BITS) - 1)) << (exponent - SUB_BITS));
+    }
+
+    void Add(uint64_t cycles)
+    {
+        samples++;
+        total += cycles;
+        max = cycles > max ? cycles : max;
+        buckets[Bucket(cycles)]++;
+    }
+
+    void Merge(const AnySampleHistogram &other)
+    {
+        samples += other.samples;
+        total += other.total;
+        max = other.max > max ? other.max : max;
+
+        for (size_t i = 0; i < BUCKETS; i++)
+            buckets[i] += other.buckets[i];
+    }
+
+    double Mean() const { return samples ? static_cast<double>(total) / static_cast<double>(samples) : 0; }
+
+    // lower bound of the bucket of the given quantile (0 to 1)
+    uint64_t Percentile(double quantile) const
+    {
+        uint64_t rank = static_cast<uint64_t>(quantile * static_cast<double>(samples));
+        uint64_t seen = 0;
+
+        for (size_t i = 0; i < BUCKETS; i++)
+            if ((seen += buckets[i]) > rank)
+                return BucketValue(i);
+
+        return max;
+    }
+
+    // cycles spent in all the operations (sampled or not), estimated from the sampling rate
+    double EstimatedTotal() const { return static_cast<double>(total) * ANY_SAMPLE_RATE; }
+};
+
+class AnySampler
+{
+public:
+    // histograms of all threads merged by type, SIZE and operation
+    static std::vector<AnySampleHistogram> Snapshot();
+
+    static void Reset();
+};
+
+namespace detail
+{
+    inline uint64_t Cycles()
+    {
+    #if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+    #elif defined(__aarch64__)
+        uint64_t ticks;
+        asm volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+        return ticks;
+    #else
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+    #endif
+    }
+
+    struct SampleKey
+    {
+        const VTable *type;
+        size_t anySize;
+        AnySampleOp op;
+
+        bool operator==(const SampleKey &other) const { return type == other.type && anySize == other.anySize && op == other.op; }
+    };
+
+    struct SampleKeyHash
+    {
+        size_t operator()(const SampleKey &key) const
+        {
+            return (reinterpret_cast<uintptr_t>(key.type) >> 3) * 0x9e3779b97f4a7c15ull ^ (key.anySize << 2) ^ static_cast<size_t>(key.op);
+        }
+    };
+
+    // histograms of a thread, the lock is only taken by sampled operations and snapshots
+    struct SampleTable
+    {
+        std::mutex mutex;
+        std::unordered_map<SampleKey, AnySampleHistogram, SampleKeyHash> histograms;
+    };
+
+    // tables outlive their threads so that the samples of finished threads are kept
+    struct SampleRegistry
+    {
+        std::mutex mutex;
+        std::vector<std::shared_ptr<SampleTable>> tables;
+
+        static SampleRegistry &Get()
+        {
+            static SampleRegistry registry;
+
+            return registry;
+        }
+    };
+
+    inline SampleTable &ThreadSamples()
+    {
+        thread_local std::shared_ptr<SampleTable> table = []()
+        {
+            auto created = std::make_shared<SampleTable>();
+            SampleRegistry &registry = SampleRegistry::Get();
+
+            std::lock_guard<std::mutex> lock(registry.mutex);
+            registry.tables.push_back(created);
+
+            return created;
+        }();
+
+        return *table;
+    }
+
+    struct SampleCountdown
+    {
+        uint32_t remaining = ANY_SAMPLE_RATE;
+        uint32_t random = 0x9e3779b9;
+
+        // the interval is jittered (rate / 2 to 3 * rate / 2) so that periodic patterns aren't aliased
+        bool Tick()
+        {
+            if (--remaining)
+                return false;
+
+            random ^= random << 13;
+            random ^= random >> 17;
+            random ^= random << 5;
+
+            remaining = ANY_SAMPLE_RATE / 2 + random % ANY_SAMPLE_RATE + 1;
+
+            return true;
+        }
+    };
+
+    inline SampleCountdown &ThreadCountdown()
+    {
+        thread_local SampleCountdown countdown;
+
+        return countdown;
+    }
+
+    ANY_COLD inline void RecordSample(const VTable *type, size_t anySize, AnySampleOp op, uint64_t cycles)
+    {
+        SampleTable &table = ThreadSamples();
+
+        std::lock_guard<std::mutex> lock(table.mutex);
+
+        auto it = table.histograms.find(SampleKey{ type, anySize, op });
+
+        if (it == table.histograms.end())
+        {
+            AnySampleHistogram histogram;
+            histogram.type = type;
+            histogram.anySize = anySize;
+            histogram.op = op;
+
+            it = table.histograms.emplace(SampleKey{ type, anySize, op }, histogram).first;
+        }
+
+        it->second.Add(cycles);
+    }
+
+    // measures the enclosing scope if the operation is sampled
+    class SampleScope
+    {
+    public:
+        SampleScope(AnySampleOp op, const VTable *type, size_t anySize) : mType(nullptr)
+        {
+            if (ThreadCountdown().Tick())
+            {
+                mType = type;
+                mAnySize = anySize;
+                mOp = op;
+                mStart = Cycles();
+            }
+        }
+
+        ~SampleScope()
+        {
+            if (mType)
+                RecordSample(mType, mAnySize, mOp, Cycles() - mStart);
+        }
+
+        SampleScope(const SampleScope&) = delete;
+        SampleScope &operator=(const SampleScope&) = delete;
+
+    private:
+        const VTable *mType;
+        size_t mAnySize;
+        AnySampleOp mOp;
+        uint64_t mStart;
+    };
+}
+
+inline std::vector<AnySampleHistogram> AnySampler::Snapshot()
+{
+    detail::SampleRegistry &registry = detail::SampleRegistry::Get();
+
+    std::unordered_map<detail::SampleKey, AnySampleHistogram, detail::SampleKeyHash> merged;
+
+    std::lock_guard<std::mutex> registryLock(registry.mutex);
+
+    for (const auto &table : registry.tables)
+    {
+        std::lock_guard<std::mutex> lock(table->mutex);
+
+        for (const auto &entry : table->histograms)
+        {
+            auto it = merged.find(entry.first);
+
+            if (it == merged.end())
+                merged.emplace(entry.first, entry.second);
+            else
+                it->second.Merge(entry.second);
+        }
+    }
+
+    std::vector<AnySampleHistogram> histograms;
+
+    for (const auto &entry : merged)
+        histograms.push_back(entry.second);
+
+    return histograms;
+}
+
+inline void AnySampler::Reset()
+{
+    detail::SampleRegistry &registry = detail::SampleRegistry::Get();
+
+    std::lock_guard<std::mutex> registryLock(registry.mutex);
+
+    for (const auto &table : registry.tables)
+    {
+        std::lock_guard<std::mutex> lock(table->mutex);
+
+        table->histograms.clear();
+    }
+}
+
+#endif  // ANY_SAMPLING_H
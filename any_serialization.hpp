@@ -0,0 +1,185 @@
+#ifndef ANY_SERIALIZATION_H
+#define ANY_SERIALIZATION_H
+
+#include "any.hpp"
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * Registry of serializable types. Each type is registered under a name whose hash is its
+ * stable type id, so separately built programs (or processes) agree on it as long as they
+ * register the same names. Register types before serializing concurrently.
+ */
+class AnySerializer
+{
+public:
+    using Id = uint64_t;
+
+    using Serialize = std::function<void(const void *object, std::vector<unsigned char> &out)>;   // appends to out
+    using Deserialize = std::function<bool(const unsigned char *data, size_t size, void *storage)>;  // constructs into storage
+
+    struct Entry
+    {
+        Id id;
+        AnyType type;
+        Serialize serialize;
+        Deserialize deserialize;
+        bool bytes;   // serialized as the bytes of the object (trivially copyable types registered without functions)
+    };
+
+    // FNV-1a
+    static constexpr Id NameId(const char *name)
+    {
+        Id hash = 14695981039346656037ull;
+
+        for (; *name; name++)
+            hash = (hash ^ static_cast<unsigned char>(*name)) * 1099511628211ull;
+
+        return hash;
+    }
+
+    // trivially copyable types are serialized as their bytes
+    template <typename T>
+    void Register(const char *name);
+
+    // serialize(const T&, std::vector<unsigned char> &out) appends to out, deserialize(const unsigned char*, size_t) -> std::optional<T>
+    template <typename T, typename S, typename D>
+    void Register(const char *name, S serialize, D deserialize);
+
+    const Entry *Find(AnyType type) const
+    {
+        auto it = mByType.find(type);
+
+        return it == mByType.end() ? nullptr : &mEntries[it->second];
+    }
+
+    const Entry *Find(Id id) const
+    {
+        auto it = mById.find(id);
+
+        return it == mById.end() ? nullptr : &mEntries[it->second];
+    }
+
+    // appends the serialized object to out, false if the Any is empty or its type isn't registered
+    template <size_t SIZE>
+    bool Write(const Any<SIZE> &any, std::vector<unsigned char> &out, Id *id = nullptr) const;
+
+    template <size_t SIZE>
+    AnyError Read(Id id, const unsigned char *data, size_t size, Any<SIZE> &any) const;
+
+    static AnySerializer &Default()
+    {
+        static AnySerializer serializer;
+
+        return serializer;
+    }
+
+private:
+    void Add(Entry entry);
+
+    std::vector<Entry> mEntries;
+    std::unordered_map<AnyType, size_t> mByType;
+    std::unordered_map<Id, size_t> mById;
+};
+
+template <typename T>
+void AnySerializer::Register(const char *name)
+{
+    static_assert(std::is_trivially_copyable<T>::value, "serialization functions are needed for types that aren't trivially copyable");
+
+    Add(Entry
+    {
+        NameId(name),
+        AnyTypeOf<T>(),
+        [](const void *object, std::vector<unsigned char> &out)
+        {
+            const unsigned char *bytes = static_cast<const unsigned char*>(object);
+
+            out.insert(out.end(), bytes, bytes + sizeof(T));
+        },
+        [](const unsigned char *data, size_t size, void *storage)
+        {
+            if (size != sizeof(T))
+                return false;
+
+            std::memcpy(storage, data, sizeof(T));
+
+            return true;
+        },
+        true
+    });
+}
+
+template <typename T, typename S, typename D>
+void AnySerializer::Register(const char *name, S serialize, D deserialize)
+{
+    Add(Entry
+    {
+        NameId(name),
+        AnyTypeOf<T>(),
+        [serialize](const void *object, std::vector<unsigned char> &out) { serialize(*static_cast<const T*>(object), out); },
+        [deserialize](const unsigned char *data, size_t size, void *storage)
+        {
+            std::optional<T> object = deserialize(data, size);
+
+            if (!object)
+                return false;
+
+            ::new(storage) T(std::move(*object));
+
+            return true;
+        },
+        false
+    });
+}
+
+inline void AnySerializer::Add(Entry entry)
+{
+    auto it = mByType.find(entry.type);
+
+    if (it != mByType.end())  // re-registration replaces the previous entry
+    {
+        mById.erase(mEntries[it->second].id);
+        mById[entry.id] = it->second;
+        mEntries[it->second] = std::move(entry);
+
+        return;
+    }
+
+    mByType[entry.type] = mEntries.size();
+    mById[entry.id] = mEntries.size();
+    mEntries.push_back(std::move(entry));
+}
+
+template <size_t SIZE>
+bool AnySerializer::Write(const Any<SIZE> &any, std::vector<unsigned char> &out, Id *id) const
+{
+    const Entry *entry = Find(any.Type());
+
+    if (!entry)
+        return false;
+
+    entry->serialize(any.Data(), out);
+
+    if (id)
+        *id = entry->id;
+
+    return true;
+}
+
+template <size_t SIZE>
+AnyError AnySerializer::Read(Id id, const unsigned char *data, size_t size, Any<SIZE> &any) const
+{
+    const Entry *entry = Find(id);
+
+    if (!entry)
+        return AnyError::BadCast;
+
+    return any.Construct(entry->type, [&](void *storage) { return entry->deserialize(data, size, storage); });
+}
+
+#endif  // ANY_SERIALIZATION_H
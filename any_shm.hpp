@@ -0,0 +1,392 @@
+#ifndef ANY_SHM_H
+#define ANY_SHM_H
+
+#include "any_serialization.hpp"
+#include <atomic>
+#include <cstring>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define ANY_SHM
+#endif
+
+/*
+ * Shared memory layout (native byte order, both processes must be the same build of the types):
+ *   header  { magic, version, capacity, head (bytes reserved), tail (bytes consumed) }
+ *   data    capacity bytes of records { length, id, size, payload }, 8-byte aligned
+ *
+ * A record that doesn't fit before the end of the data is preceded by a padding record
+ * (PADDING bit in its length) up to the end, and starts again at the beginning. A record is
+ * published by storing its length last, and the consumer zeroes the records it consumed before
+ * releasing them, so a zero length means "not yet written" at every offset.
+ */
+namespace detail
+{
+    constexpr uint32_t SHM_RING_MAGIC = 0x52594e41;   // "ANYR"
+    constexpr uint32_t SHM_RING_VERSION = 1;
+    constexpr uint32_t SHM_RING_PADDING = 0x80000000u;
+
+    struct ShmRingHeader
+    {
+        std::atomic<uint32_t> magic;   // set last by the creator
+        uint32_t version;
+        uint64_t capacity;
+
+        alignas(ANY_CACHE_LINE_SIZE) std::atomic<uint64_t> head;
+        alignas(ANY_CACHE_LINE_SIZE) std::atomic<uint64_t> tail;
+    };
+
+    struct ShmRecord
+    {
+        std::atomic<uint32_t> length;   // of the whole record, 0 until published
+        uint32_t reserved;
+        uint64_t id;                    // AnySerializer::Id
+        uint64_t size;                  // of the payload
+    };
+
+    // the same atomics are accessed from several processes
+    static_assert(std::atomic<uint32_t>::is_always_lock_free && std::atomic<uint64_t>::is_always_lock_free, "shared memory ring needs address-free atomics");
+}
+
+/*
+ * Ring buffer in POSIX shared memory (shm_open, link with -lrt on older glibc) passing Any
+ * values between processes on the same host: any number of producers, one consumer. Values
+ * travel as their serialized bytes with the stable type id of the serializer, so both processes
+ * must register the types under the same names. Types registered without functions (trivially
+ * copyable) are copied straight into the ring, the others are serialized first.
+ *
+ * Push and Pop never block nor call the kernel: a producer reserves space with a CAS on the head,
+ * the consumer polls the length of the next record. Retry (or back off) on a full or empty ring.
+ */
+class AnyShmRing
+{
+public:
+    explicit AnyShmRing(const AnySerializer &serializer = AnySerializer::Default()) :
+        mSerializer(serializer), mHeader(nullptr), mData(nullptr), mMask(0), mMappingSize(0)
+    {
+    }
+
+    ~AnyShmRing() { Close(); }
+
+    AnyShmRing(const AnyShmRing&) = delete;
+    AnyShmRing &operator=(const AnyShmRing&) = delete;
+
+    // creates or resets the named segment (no process may be attached), capacity is rounded up to a power of two
+    bool Create(const char *name, size_t capacity);
+
+    // attaches to a segment made by Create, false if it doesn't exist or isn't initialized yet
+    bool Open(const char *name);
+
+    void Close();
+
+    // removes the name, attached processes keep their mapping
+    static bool Unlink(const char *name)
+    {
+    #ifdef ANY_SHM
+        return ::shm_unlink(name) == 0;
+    #else
+        (void)name;
+        return false;
+    #endif
+    }
+
+    bool IsOpen() const { return mHeader != nullptr; }
+
+    size_t Capacity() const { return mMask + 1; }
+
+    /*
+     * Copies the value into the ring:
+     *   Empty        the Any is empty
+     *   BadCast      its type isn't registered in the serializer
+     *   OutOfMemory  the ring is full, or the record is larger than the ring
+     */
+    template <size_t SIZE>
+    AnyError Push(const Any<SIZE> &any);
+
+    /*
+     * Takes the oldest value (single consumer):
+     *   Empty             no value is ready
+     *   BadCast           the type id isn't registered (the record is dropped)
+     *   Construction      deserialization failed or the record is corrupt (the record is dropped; with
+     *                     a corrupt length, the bytes up to the end of the data)
+     */
+    template <size_t SIZE>
+    AnyError Pop(Any<SIZE> &any);
+
+private:
+    static constexpr size_t RECORD_ALIGNMENT = 8;
+    static constexpr size_t MIN_CAPACITY = 4096;
+    static constexpr size_t MAX_RECORD = detail::SHM_RING_PADDING - 1;
+
+    static size_t DataOffset()
+    {
+        return (sizeof(detail::ShmRingHeader) + ANY_CACHE_LINE_SIZE - 1) / ANY_CACHE_LINE_SIZE * ANY_CACHE_LINE_SIZE;
+    }
+
+    detail::ShmRecord *RecordAt(uint64_t position) const { return reinterpret_cast<detail::ShmRecord*>(mData + (position & mMask)); }
+
+    // position of a reserved record of the given length, false if the ring is full
+    bool Reserve(uint64_t length, uint64_t &position);
+
+    // zeroes a consumed record and hands its bytes back to the producers
+    void Release(uint64_t tail, uint64_t length);
+
+    static std::vector<unsigned char> &SerializeBuffer()
+    {
+        thread_local std::vector<unsigned char> buffer;
+
+        return buffer;
+    }
+
+    const AnySerializer &mSerializer;
+
+    detail::ShmRingHeader *mHeader;
+    unsigned char *mData;
+    uint64_t mMask;
+    size_t mMappingSize;
+};
+
+inline bool AnyShmRing::Create(const char *name, size_t capacity)
+{
+    Close();
+
+#ifdef ANY_SHM
+    size_t size = MIN_CAPACITY;
+
+    while (size < capacity)
+        size <<= 1;
+
+    const int descriptor = ::shm_open(name, O_CREAT | O_RDWR, 0600);
+
+    if (descriptor < 0)
+        return false;
+
+    // truncating first zeroes a segment left over by a previous run
+    const size_t mappingSize = DataOffset() + size;
+    bool sized = ::ftruncate(descriptor, 0) == 0 && ::ftruncate(descriptor, static_cast<off_t>(mappingSize)) == 0;
+
+    void *mapping = sized ? ::mmap(nullptr, mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0) : MAP_FAILED;
+
+    ::close(descriptor);
+
+    if (mapping == MAP_FAILED)
+        return false;
+
+    mHeader = static_cast<detail::ShmRingHeader*>(mapping);
+    mData = static_cast<unsigned char*>(mapping) + DataOffset();
+    mMask = size - 1;
+    mMappingSize = mappingSize;
+
+    mHeader->version = detail::SHM_RING_VERSION;
+    mHeader->capacity = size;
+    mHeader->head.store(0, std::memory_order_relaxed);
+    mHeader->tail.store(0, std::memory_order_relaxed);
+    mHeader->magic.store(detail::SHM_RING_MAGIC, std::memory_order_release);
+
+    return true;
+#else
+    (void)name;
+    (void)capacity;
+    return false;
+#endif
+}
+
+inline bool AnyShmRing::Open(const char *name)
+{
+    Close();
+
+#ifdef ANY_SHM
+    const int descriptor = ::shm_open(name, O_RDWR, 0600);
+
+    if (descriptor < 0)
+        return false;
+
+    struct stat status;
+    void *mapping = MAP_FAILED;
+
+    if (::fstat(descriptor, &status) == 0 && static_cast<size_t>(status.st_size) > DataOffset())
+        mapping = ::mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+
+    ::close(descriptor);
+
+    if (mapping == MAP_FAILED)
+        return false;
+
+    detail::ShmRingHeader *header = static_cast<detail::ShmRingHeader*>(mapping);
+    const size_t size = static_cast<size_t>(status.st_size);
+
+    if (header->magic.load(std::memory_order_acquire) != detail::SHM_RING_MAGIC || header->version != detail::SHM_RING_VERSION ||
+        header->capacity != size - DataOffset() || (header->capacity & (header->capacity - 1)))
+    {
+        ::munmap(mapping, size);
+        return false;
+    }
+
+    mHeader = header;
+    mData = static_cast<unsigned char*>(mapping) + DataOffset();
+    mMask = header->capacity - 1;
+    mMappingSize = size;
+
+    return true;
+#else
+    (void)name;
+    return false;
+#endif
+}
+
+inline void AnyShmRing::Close()
+{
+#ifdef ANY_SHM
+    if (mHeader)
+        ::munmap(mHeader, mMappingSize);
+#endif
+
+    mHeader = nullptr;
+    mData = nullptr;
+    mMask = 0;
+    mMappingSize = 0;
+}
+
+inline bool AnyShmRing::Reserve(uint64_t length, uint64_t &position)
+{
+    const uint64_t capacity = mMask + 1;
+
+    uint64_t head = mHeader->head.load(std::memory_order_relaxed);
+    uint64_t padding;
+
+    do
+    {
+        const uint64_t offset = head & mMask;
+
+        padding = capacity - offset < length ? capacity - offset : 0;
+
+        // the acquire pairs with the consumer's release: the bytes it freed are zeroed
+        if (head + padding + length - mHeader->tail.load(std::memory_order_acquire) > capacity)
+            return false;
+    }
+    while (!mHeader->head.compare_exchange_weak(head, head + padding + length, std::memory_order_relaxed, std::memory_order_relaxed));
+
+    if (padding)
+        RecordAt(head)->length.store(static_cast<uint32_t>(padding) | detail::SHM_RING_PADDING, std::memory_order_release);
+
+    position = head + padding;
+
+    return true;
+}
+
+template <size_t SIZE>
+AnyError AnyShmRing::Push(const Any<SIZE> &any)
+{
+    if (!any)
+        return AnyError::Empty;
+
+    const AnySerializer::Entry *entry = mSerializer.Find(any.Type());
+
+    if (!entry)
+        return AnyError::BadCast;
+
+    const unsigned char *payload;
+    size_t size;
+
+    if (entry->bytes)
+    {
+        payload = static_cast<const unsigned char*>(any.Data());
+        size = any.Type()->size;
+    }
+    else
+    {
+        std::vector<unsigned char> &buffer = SerializeBuffer();
+
+        buffer.clear();
+        entry->serialize(any.Data(), buffer);
+
+        payload = buffer.data();
+        size = buffer.size();
+    }
+
+    const uint64_t length = (sizeof(detail::ShmRecord) + size + RECORD_ALIGNMENT - 1) / RECORD_ALIGNMENT * RECORD_ALIGNMENT;
+    uint64_t position;
+
+    if (length > MAX_RECORD || length > mMask + 1 || !Reserve(length, position))
+        return AnyError::OutOfMemory;
+
+    detail::ShmRecord *record = RecordAt(position);
+
+    record->id = entry->id;
+    record->size = size;
+
+    if (size)  // payload is nullptr for an empty serialization
+        std::memcpy(reinterpret_cast<unsigned char*>(record + 1), payload, size);
+
+    record->length.store(static_cast<uint32_t>(length), std::memory_order_release);
+
+    return AnyError::None;
+}
+
+template <size_t SIZE>
+AnyError AnyShmRing::Pop(Any<SIZE> &any)
+{
+    uint64_t tail = mHeader->tail.load(std::memory_order_relaxed);
+
+    for (;;)
+    {
+        detail::ShmRecord *record = RecordAt(tail);
+        const uint32_t length = record->length.load(std::memory_order_acquire);
+
+        if (!length)
+            return AnyError::Empty;
+
+        const uint64_t offset = tail & mMask;
+        const uint64_t size = length & ~detail::SHM_RING_PADDING;
+
+        // the segment is writable by other processes: a record must stay within the data, a padding record
+        // end at the end of the data, and a value record hold its header and payload
+        if (size > mMask + 1 - offset || size % RECORD_ALIGNMENT ||
+            ((length & detail::SHM_RING_PADDING) ? offset + size != mMask + 1 : size < sizeof(detail::ShmRecord)))
+        {
+            const uint64_t reserved = mHeader->head.load(std::memory_order_acquire) - tail;
+            const uint64_t end = mMask + 1 - offset;
+
+            if (reserved >= RECORD_ALIGNMENT && reserved <= mMask + 1)
+                Release(tail, end < reserved ? end : reserved);
+
+            return AnyError::Construction;
+        }
+
+        if (length & detail::SHM_RING_PADDING)
+        {
+            Release(tail, size);
+            tail += size;
+            continue;
+        }
+
+        if (record->size > size - sizeof(detail::ShmRecord))
+        {
+            Release(tail, size);
+
+            return AnyError::Construction;
+        }
+
+        AnyError error = mSerializer.Read(record->id, reinterpret_cast<const unsigned char*>(record + 1), static_cast<size_t>(record->size), any);
+
+        Release(tail, length);
+
+        return error;
+    }
+}
+
+inline void AnyShmRing::Release(uint64_t tail, uint64_t length)
+{
+    detail::ShmRecord *record = RecordAt(tail);
+
+    // a padding record can be shorter than a record header
+    std::memset(reinterpret_cast<unsigned char*>(record) + sizeof(record->length), 0, static_cast<size_t>(length) - sizeof(record->length));
+    record->length.store(0, std::memory_order_relaxed);
+
+    mHeader->tail.store(tail + length, std::memory_order_release);
+}
+
+#endif  // ANY_SHM_H
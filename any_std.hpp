@@ -0,0 +1,177 @@
+#ifndef ANY_STD_H
+#define ANY_STD_H
+
+#include "any.hpp"
+#include <any>
+#include <typeindex>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * Conversions between std::any and Any. The layout of std::any is private to each standard
+ * library, so payloads can't be adopted: a conversion is a single move construction of the
+ * object from one container into the other (no intermediate copy), and the source is emptied.
+ * An object the Any doesn't own alone (Shared policy, Handle) is copied instead, the other owners
+ * and the referenced object are left untouched.
+ *
+ * The typed functions need no registration. The type-erased ones go through AnyStdInterop, which
+ * maps the std::type_info of a std::any to a descriptor. Register types before converting concurrently.
+ */
+template <typename T, size_t SIZE>
+AnyError FromStdAny(std::any &&from, Any<SIZE> &to)
+{
+    T *object = std::any_cast<T>(&from);
+
+    if (!object)
+        return from.has_value() ? AnyError::BadCast : AnyError::Empty;
+
+    to = std::move(*object);
+    from.reset();
+
+    return to.template Is<T>() ? AnyError::None : AnyError::OutOfMemory;
+}
+
+template <typename T, size_t SIZE>
+AnyError ToStdAny(Any<SIZE> &&from, std::any &to)
+{
+    if (!from)
+        return AnyError::Empty;
+
+    if (!from.template Is<T>())
+        return AnyError::BadCast;
+
+    if (from.OwnsObject())
+        to = std::move(from.template Get<T>());
+    else
+        to = from.template Get<T>();
+
+    from = Any<SIZE>();
+
+    return AnyError::None;
+}
+
+class AnyStdInterop
+{
+public:
+    struct Entry
+    {
+        AnyType type;
+        const std::type_info *info;
+
+        void *(*address)(std::any &any);                  // the object in a std::any of the type
+        bool (*moveFrom)(std::any &from, void *storage);  // move constructs into storage
+        void (*moveTo)(void *object, std::any &to);       // move constructs into to
+        void (*copyTo)(const void *object, std::any &to); // copy constructs into to
+    };
+
+    template <typename T>
+    void Register();
+
+    const Entry *Find(const std::type_info &info) const
+    {
+        auto it = mByInfo.find(std::type_index(info));
+
+        return it == mByInfo.end() ? nullptr : &mEntries[it->second];
+    }
+
+    const Entry *Find(AnyType type) const
+    {
+        auto it = mByType.find(type);
+
+        return it == mByType.end() ? nullptr : &mEntries[it->second];
+    }
+
+    // from is emptied on success, BadCast if its type isn't registered
+    template <size_t SIZE>
+    AnyError FromStd(std::any &&from, Any<SIZE> &to) const;
+
+    template <size_t SIZE>
+    AnyError ToStd(Any<SIZE> &&from, std::any &to) const;
+
+    // view of the object in a std::any, empty if the std::any is empty or its type isn't registered
+    AnyRef Ref(std::any &any) const
+    {
+        const Entry *entry = any.has_value() ? Find(any.type()) : nullptr;
+
+        return entry ? AnyRef(entry->type, entry->address(any)) : AnyRef();
+    }
+
+    static AnyStdInterop &Default()
+    {
+        static AnyStdInterop interop;
+
+        return interop;
+    }
+
+private:
+    std::vector<Entry> mEntries;
+    std::unordered_map<std::type_index, size_t> mByInfo;
+    std::unordered_map<AnyType, size_t> mByType;
+};
+
+template <typename T>
+void AnyStdInterop::Register()
+{
+    if (Find(AnyTypeOf<T>()))
+        return;
+
+    mByInfo[std::type_index(typeid(T))] = mEntries.size();
+    mByType[AnyTypeOf<T>()] = mEntries.size();
+
+    mEntries.push_back(Entry
+    {
+        AnyTypeOf<T>(),
+        &typeid(T),
+        [](std::any &any) -> void* { return std::any_cast<T>(&any); },
+        [](std::any &from, void *storage)
+        {
+            ::new(storage) T(std::move(*std::any_cast<T>(&from)));
+
+            return true;
+        },
+        [](void *object, std::any &to) { to = std::move(*static_cast<T*>(object)); },
+        [](const void *object, std::any &to) { to = *static_cast<const T*>(object); }
+    });
+}
+
+template <size_t SIZE>
+AnyError AnyStdInterop::FromStd(std::any &&from, Any<SIZE> &to) const
+{
+    if (!from.has_value())
+        return AnyError::Empty;
+
+    const Entry *entry = Find(from.type());
+
+    if (!entry)
+        return AnyError::BadCast;
+
+    AnyError error = to.Construct(entry->type, [&](void *storage) { return entry->moveFrom(from, storage); });
+
+    if (error == AnyError::None)
+        from.reset();
+
+    return error;
+}
+
+template <size_t SIZE>
+AnyError AnyStdInterop::ToStd(Any<SIZE> &&from, std::any &to) const
+{
+    if (!from)
+        return AnyError::Empty;
+
+    const Entry *entry = Find(from.Type());
+
+    if (!entry)
+        return AnyError::BadCast;
+
+    if (from.OwnsObject())
+        entry->moveTo(from.Data(), to);
+    else
+        entry->copyTo(static_cast<const Any<SIZE>&>(from).Data(), to);
+
+    from = Any<SIZE>();
+
+    return AnyError::None;
+}
+
+#endif  // ANY_STD_H
@@ -0,0 +1,88 @@
+#include "any_arena.hpp"
+#include "bench.hpp"
+#include <algorithm>
+#include <fstream>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+/*
+ * Scan throughput of 1M heap payloads of 64 bytes held by Any<8>, allocated by the global operator
+ * new, by an AnyArena without huge pages and by an AnyArena with transparent huge pages. The
+ * payloads are scanned in order and in a random order (TLB bound). Huge pages only apply if
+ * /sys/kernel/mm/transparent_hugepage/enabled is "always" or "madvise".
+ */
+namespace
+{
+    struct Payload
+    {
+        long values[8];
+    };
+
+    constexpr size_t COUNT = size_t(1) << 20;
+    constexpr int ROUNDS = 10;
+
+    void Scan(const char *name, const std::vector<Any<8>> &values, const std::vector<uint32_t> &order)
+    {
+        long sum = 0;
+
+        const double seconds = BenchSeconds([&]()
+        {
+            for (int round = 0; round < ROUNDS; round++)
+                for (uint32_t index : order)
+                    sum += values[index].Get<Payload>().values[round & 7];
+        });
+
+        BenchKeep(sum);
+        BenchReport(name, double(ROUNDS) * COUNT, seconds);
+    }
+
+    void Run(const char *name, AnyArena *arena)
+    {
+        std::vector<Any<8>> values(COUNT);
+
+        for (size_t i = 0; i < COUNT; i++)
+        {
+            const Payload payload{ { long(i), long(i), long(i), long(i), long(i), long(i), long(i), long(i) } };
+
+            if (arena)
+                values[i].EmplaceIn<Payload>(*arena, payload);
+            else
+                values[i] = payload;
+        }
+
+        std::vector<uint32_t> order(COUNT);
+        std::iota(order.begin(), order.end(), 0u);
+
+        std::string label = std::string(name) + ", sequential";
+        Scan(label.c_str(), values, order);
+
+        std::shuffle(order.begin(), order.end(), std::mt19937(7));
+
+        label = std::string(name) + ", random";
+        Scan(label.c_str(), values, order);
+    }
+}
+
+int main()
+{
+    std::string hugePages;
+    std::getline(std::ifstream("/sys/kernel/mm/transparent_hugepage/enabled"), hugePages);
+
+    std::printf("transparent huge pages: %s\n", hugePages.empty() ? "unknown" : hugePages.c_str());
+
+    Run("operator new", nullptr);
+
+    {
+        AnyArena arena(size_t(64) << 20, false);
+        Run("AnyArena, 4K pages", &arena);
+    }
+
+    {
+        AnyArena arena(size_t(64) << 20, true);
+        Run("AnyArena, huge pages", &arena);
+    }
+
+    return 0;
+}
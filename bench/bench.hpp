@@ -0,0 +1,42 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <chrono>
+#include <cstdio>
+
+/*
+ * Timing helpers for the standalone benchmarks. Each benchmark is a single source file built
+ * against the repository root with optimizations, e.g.
+ *   c++ -std=c++17 -O2 -DNDEBUG -pthread -I. bench/triple_buffer_bench.cpp -o triple_buffer_bench && ./triple_buffer_bench
+ */
+using BenchClock = std::chrono::steady_clock;
+
+// seconds taken by f()
+template <typename F>
+double BenchSeconds(F &&f)
+{
+    const BenchClock::time_point start = BenchClock::now();
+
+    f();
+
+    return std::chrono::duration<double>(BenchClock::now() - start).count();
+}
+
+inline void BenchReport(const char *name, double operations, double seconds)
+{
+    std::printf("%-40s %10.2f ns/op %10.2f Mop/s\n", name, seconds * 1e9 / operations, operations / seconds / 1e6);
+}
+
+// keeps the compiler from optimizing the computation of value away
+template <typename T>
+inline void BenchKeep(const T &value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r"(&value) : "memory");
+#else
+    static volatile const void *sink;
+    sink = &value;
+#endif
+}
+
+#endif  // BENCH_H
@@ -0,0 +1,130 @@
+#include "binary_dispatch.hpp"
+#include "bench.hpp"
+#include <random>
+#include <vector>
+
+/*
+ * Sums of 1M random pairs of ints, doubles and fixed-point decimals (9 type combinations) through
+ * BinaryDispatch, against a hand-written chain of type tests over the same combinations.
+ */
+namespace
+{
+    // 4 decimal places
+    struct Decimal
+    {
+        Decimal() : units(0) {}
+        explicit Decimal(int value) : units(static_cast<long long>(value) * 10000) {}
+
+        explicit operator double() const { return static_cast<double>(units) / 10000; }
+
+        long long units;
+    };
+
+    Decimal operator+(Decimal a, Decimal b)
+    {
+        Decimal sum;
+
+        sum.units = a.units + b.units;
+
+        return sum;
+    }
+
+    struct Plus
+    {
+        template <typename L, typename R>
+        auto operator()(const L &lhs, const R &rhs) const { return lhs + rhs; }
+    };
+
+    constexpr size_t COUNT = size_t(1) << 20;
+    constexpr int ROUNDS = 20;
+
+    std::vector<Any<16>> Operands(std::mt19937 &random)
+    {
+        std::vector<Any<16>> operands;
+        operands.reserve(COUNT);
+
+        for (size_t i = 0; i < COUNT; i++)
+        {
+            const int value = static_cast<int>(random() % 1000);
+
+            switch (random() % 3)
+            {
+            case 0: operands.emplace_back(value); break;
+            case 1: operands.emplace_back(value * 0.5); break;
+            default: operands.emplace_back(Decimal(value)); break;
+            }
+        }
+
+        return operands;
+    }
+
+    double ToDouble(const Any<16> &any)
+    {
+        if (any.Is<int>())
+            return any.Get<int>();
+        if (any.Is<double>())
+            return any.Get<double>();
+
+        return static_cast<double>(any.Get<Decimal>());
+    }
+
+    // same results as the dispatch table: int + int and decimal + (int or decimal) stay exact
+    Any<16> Chain(const Any<16> &lhs, const Any<16> &rhs)
+    {
+        if (lhs.Is<int>() && rhs.Is<int>())
+            return lhs.Get<int>() + rhs.Get<int>();
+
+        if (lhs.Is<Decimal>() && rhs.Is<Decimal>())
+            return lhs.Get<Decimal>() + rhs.Get<Decimal>();
+
+        if (lhs.Is<Decimal>() && rhs.Is<int>())
+            return lhs.Get<Decimal>() + Decimal(rhs.Get<int>());
+
+        if (lhs.Is<int>() && rhs.Is<Decimal>())
+            return Decimal(lhs.Get<int>()) + rhs.Get<Decimal>();
+
+        return ToDouble(lhs) + ToDouble(rhs);
+    }
+
+    template <typename F>
+    void Run(const char *name, const std::vector<Any<16>> &lhs, const std::vector<Any<16>> &rhs, F add)
+    {
+        double checksum = 0;
+
+        const double seconds = BenchSeconds([&]()
+        {
+            for (int round = 0; round < ROUNDS; round++)
+                for (size_t i = 0; i < COUNT; i++)
+                {
+                    const Any<16> sum = add(lhs[i], rhs[i]);
+
+                    checksum += sum.Is<double>() ? 1 : 0;
+                }
+        });
+
+        BenchKeep(checksum);
+        BenchReport(name, double(ROUNDS) * COUNT, seconds);
+    }
+}
+
+int main()
+{
+    BinaryDispatch<Plus, 16> dispatch;
+
+    dispatch.Register<int, int>();
+    dispatch.Register<double, double>();
+    dispatch.Register<Decimal, Decimal>();
+    dispatch.RegisterPromotion<int, double>();
+    dispatch.RegisterPromotion<int, Decimal>();
+    dispatch.RegisterPromotion<Decimal, double>();
+
+    std::mt19937 random(42);
+
+    const std::vector<Any<16>> lhs = Operands(random);
+    const std::vector<Any<16>> rhs = Operands(random);
+
+    Run("BinaryDispatch", lhs, rhs, [&](const Any<16> &l, const Any<16> &r) { return dispatch(l, r); });
+    Run("chain of type tests", lhs, rhs, &Chain);
+
+    return 0;
+}
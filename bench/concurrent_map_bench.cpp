@@ -0,0 +1,155 @@
+#include "concurrent_any_map.hpp"
+#include "bench.hpp"
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * Read-mostly scaling of ConcurrentAnyMap against an unordered_map of Any behind a mutex and behind
+ * a shared_mutex, with 1 to 16 threads each doing lookups of 4096 keys and one write in 100.
+ * The locked maps read by reference under the lock, like Visit. Threads beyond the number of
+ * cores only measure the overhead of oversubscription.
+ */
+namespace
+{
+    constexpr size_t KEYS = 4096;
+    constexpr size_t OPERATIONS = 1 << 20;   // per thread
+    constexpr size_t WRITE_EVERY = 100;
+
+    using Value = Any<32>;
+
+    class MutexMap
+    {
+    public:
+        template <typename F>
+        bool Visit(const std::string &key, F f) const
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+
+            auto it = mMap.find(key);
+
+            if (it == mMap.end())
+                return false;
+
+            f(static_cast<const Value&>(it->second));
+
+            return true;
+        }
+
+        void Insert(const std::string &key, Value value)
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+
+            mMap[key] = std::move(value);
+        }
+
+    private:
+        mutable std::mutex mMutex;
+        std::unordered_map<std::string, Value> mMap;
+    };
+
+    class SharedMutexMap
+    {
+    public:
+        template <typename F>
+        bool Visit(const std::string &key, F f) const
+        {
+            std::shared_lock<std::shared_mutex> lock(mMutex);
+
+            auto it = mMap.find(key);
+
+            if (it == mMap.end())
+                return false;
+
+            f(static_cast<const Value&>(it->second));
+
+            return true;
+        }
+
+        void Insert(const std::string &key, Value value)
+        {
+            std::unique_lock<std::shared_mutex> lock(mMutex);
+
+            mMap[key] = std::move(value);
+        }
+
+    private:
+        mutable std::shared_mutex mMutex;
+        std::unordered_map<std::string, Value> mMap;
+    };
+
+    std::vector<std::string> Keys()
+    {
+        std::vector<std::string> keys;
+
+        for (size_t i = 0; i < KEYS; i++)
+            keys.push_back("context.key." + std::to_string(i));
+
+        return keys;
+    }
+
+    template <typename Map>
+    double Run(Map &map, const std::vector<std::string> &keys, size_t threads)
+    {
+        for (size_t i = 0; i < KEYS; i++)
+            map.Insert(keys[i], Value(static_cast<long>(i)));
+
+        return BenchSeconds([&]()
+        {
+            std::vector<std::thread> workers;
+
+            for (size_t t = 0; t < threads; t++)
+            {
+                workers.emplace_back([&map, &keys, t]()
+                {
+                    long sum = 0;
+                    size_t index = t * 7919;
+
+                    for (size_t i = 1; i <= OPERATIONS; i++)
+                    {
+                        index = (index + 2654435761u) % KEYS;
+
+                        if (i % WRITE_EVERY == 0)
+                            map.Insert(keys[index], Value(static_cast<long>(i)));
+                        else
+                            map.Visit(keys[index], [&sum](const Value &value) { sum += value.template Get<long>(); });
+                    }
+
+                    BenchKeep(sum);
+                });
+            }
+
+            for (std::thread &worker : workers)
+                worker.join();
+        });
+    }
+}
+
+int main()
+{
+    const std::vector<std::string> keys = Keys();
+
+    std::printf("%u hardware threads\n", std::thread::hardware_concurrency());
+
+    for (size_t threads = 1; threads <= 16; threads *= 2)
+    {
+        const double operations = static_cast<double>(OPERATIONS * threads);
+        char name[64];
+
+        ConcurrentAnyMap<32> concurrent;
+        std::snprintf(name, sizeof(name), "ConcurrentAnyMap %zu threads", threads);
+        BenchReport(name, operations, Run(concurrent, keys, threads));
+
+        MutexMap mutex;
+        std::snprintf(name, sizeof(name), "mutex unordered_map %zu threads", threads);
+        BenchReport(name, operations, Run(mutex, keys, threads));
+
+        SharedMutexMap shared;
+        std::snprintf(name, sizeof(name), "shared_mutex unordered_map %zu threads", threads);
+        BenchReport(name, operations, Run(shared, keys, threads));
+    }
+
+    return 0;
+}
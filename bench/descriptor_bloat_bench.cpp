@@ -0,0 +1,88 @@
+#include "any.hpp"
+#include "bench.hpp"
+#include <string>
+#include <utility>
+
+/*
+ * Code size and build time of storing many distinct types: BENCH_TYPES types are stored, copied and
+ * read back through Any<8>, Any<16> and Any<32>, which share one descriptor per type. Compare the
+ * text size and the build time of the trivially copyable types (no function instantiated per type)
+ * with the types that have a std::string member:
+ *   time c++ -std=c++17 -O2 -I. bench/descriptor_bloat_bench.cpp -o trivial && size trivial
+ *   time c++ -std=c++17 -O2 -I. -DBENCH_NON_TRIVIAL bench/descriptor_bloat_bench.cpp -o non_trivial && size non_trivial
+ */
+#ifndef BENCH_TYPES
+#define BENCH_TYPES 1000
+#endif
+
+namespace
+{
+    template <size_t I>
+    struct Stored
+    {
+        long values[I % 3 + 1];
+    #ifdef BENCH_NON_TRIVIAL
+        std::string text;
+    #endif
+    };
+
+    template <size_t I>
+    Stored<I> Make()
+    {
+        Stored<I> stored{};
+
+        stored.values[0] = long(I);
+
+        return stored;
+    }
+
+    // one store, copy and read of a type, kept out of line so that the code of each type is separate
+    template <size_t SIZE, size_t I>
+    long StoreOne()
+    {
+        Any<SIZE> value = Make<I>();
+        Any<SIZE> copy = value;
+
+        return copy.template Get<Stored<I>>().values[0];
+    }
+
+    template <size_t SIZE, size_t... I>
+    long StoreAll(std::index_sequence<I...>)
+    {
+        static long (*const stores[])() = { &StoreOne<SIZE, I>... };
+
+        long sum = 0;
+
+        for (long (*store)() : stores)
+            sum += store();
+
+        return sum;
+    }
+
+    template <size_t SIZE>
+    void Run(const char *name)
+    {
+        constexpr size_t ROUNDS = 1000;
+
+        long sum = 0;
+        const double seconds = BenchSeconds([&]()
+        {
+            for (size_t round = 0; round < ROUNDS; round++)
+                sum += StoreAll<SIZE>(std::make_index_sequence<BENCH_TYPES>());
+        });
+
+        BenchKeep(sum);
+        BenchReport(name, double(ROUNDS) * BENCH_TYPES, seconds);
+    }
+}
+
+int main()
+{
+    std::printf("%d stored types%s\n", BENCH_TYPES, std::is_trivially_copyable<Stored<0>>::value ? " (trivially copyable)" : " (not trivially copyable)");
+
+    Run<8>("store, copy and read, Any<8>");
+    Run<16>("store, copy and read, Any<16>");
+    Run<32>("store, copy and read, Any<32>");
+
+    return 0;
+}
@@ -0,0 +1,76 @@
+#include "any_parallel.hpp"
+#include "bench.hpp"
+#include <string>
+#include <vector>
+
+/*
+ * Scaling of ParallelTransform and ParallelReduce over 4M Any<16> (ints and doubles, a few strings
+ * skipped) with pools of 1 to 64 threads. Threads beyond the number of cores only measure the
+ * overhead of oversubscription.
+ */
+namespace
+{
+    constexpr size_t COUNT = size_t(4) << 20;
+    constexpr int ROUNDS = 5;
+
+    std::vector<Any<16>> Values()
+    {
+        std::vector<Any<16>> values;
+        values.reserve(COUNT);
+
+        for (size_t i = 0; i < COUNT; i++)
+        {
+            if (i % 64 == 63)
+                values.emplace_back(std::string("skipped"));
+            else if (i % 2)
+                values.emplace_back(static_cast<double>(i));
+            else
+                values.emplace_back(static_cast<int>(i));
+        }
+
+        return values;
+    }
+}
+
+int main()
+{
+    const std::vector<Any<16>> values = Values();
+    std::vector<double> out(COUNT);
+
+    std::printf("%u hardware threads\n", std::thread::hardware_concurrency());
+
+    for (size_t threads = 1; threads <= 64; threads *= 2)
+    {
+        AnyThreadPool pool(threads);
+        AnyParallelOptions options;
+        options.pool = &pool;
+
+        double sum = 0;
+
+        const double reduce = BenchSeconds([&]()
+        {
+            for (int round = 0; round < ROUNDS; round++)
+                sum += ParallelReduce(AnyTypeList<int, double>(), values.begin(), values.end(), 0.0,
+                    [](double total, auto value) { return total + value; }, [](double a, double b) { return a + b; }, options);
+        });
+
+        const double transform = BenchSeconds([&]()
+        {
+            for (int round = 0; round < ROUNDS; round++)
+                ParallelTransform(AnyTypeList<int, double>(), values.begin(), values.end(), out.begin(), [](auto value) { return value * 0.5; }, options);
+        });
+
+        BenchKeep(sum);
+        BenchKeep(out);
+
+        char label[64];
+
+        std::snprintf(label, sizeof(label), "ParallelReduce, %zu threads", threads);
+        BenchReport(label, double(ROUNDS) * COUNT, reduce);
+
+        std::snprintf(label, sizeof(label), "ParallelTransform, %zu threads", threads);
+        BenchReport(label, double(ROUNDS) * COUNT, transform);
+    }
+
+    return 0;
+}
@@ -0,0 +1,112 @@
+#include "any_pool.hpp"
+#include "bench.hpp"
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+ * Producer/consumer allocation: one thread creates Any<16> with heap payloads of 48 to 1000 bytes
+ * and hands them over a lock-free single producer ring to another thread which destroys them,
+ * with the payloads from operator new and from the producer's AnyPool (AnyPoolScope).
+ * Only the allocation path differs between the two runs.
+ */
+namespace
+{
+    constexpr size_t COUNT = size_t(4) << 20;
+    constexpr size_t RING = 1024;
+
+    template <size_t N>
+    struct Payload
+    {
+        unsigned char bytes[N];
+    };
+
+    using Value = Any<16>;
+
+    class Ring
+    {
+    public:
+        Ring() : mSlots(new Value[RING]), mHead(0), mTail(0) {}
+
+        void Push(Value &&value)
+        {
+            const size_t tail = mTail.load(std::memory_order_relaxed);
+
+            while (tail - mHead.load(std::memory_order_acquire) == RING)
+                std::this_thread::yield();
+
+            mSlots[tail % RING] = std::move(value);
+            mTail.store(tail + 1, std::memory_order_release);
+        }
+
+        // destroys the next value
+        void Drop()
+        {
+            const size_t head = mHead.load(std::memory_order_relaxed);
+
+            while (mTail.load(std::memory_order_acquire) == head)
+                std::this_thread::yield();
+
+            mSlots[head % RING] = Value();
+            mHead.store(head + 1, std::memory_order_release);
+        }
+
+    private:
+        std::unique_ptr<Value[]> mSlots;
+        alignas(ANY_CACHE_LINE_SIZE) std::atomic<size_t> mHead;
+        alignas(ANY_CACHE_LINE_SIZE) std::atomic<size_t> mTail;
+    };
+
+    void Produce(Ring &ring)
+    {
+        for (size_t i = 0; i < COUNT; i++)
+        {
+            switch (i % 4)
+            {
+            case 0: ring.Push(Value(Payload<48>{})); break;
+            case 1: ring.Push(Value(Payload<120>{})); break;
+            case 2: ring.Push(Value(Payload<400>{})); break;
+            default: ring.Push(Value(Payload<1000>{})); break;
+            }
+        }
+    }
+
+    double Run(bool pooled)
+    {
+        Ring ring;
+
+        return BenchSeconds([&]()
+        {
+            std::thread consumer([&ring]()
+            {
+                for (size_t i = 0; i < COUNT; i++)
+                    ring.Drop();
+            });
+
+            if (pooled)
+            {
+                AnyPoolScope scope;
+                Produce(ring);
+            }
+            else
+                Produce(ring);
+
+            consumer.join();
+        });
+    }
+}
+
+int main()
+{
+    std::printf("%u hardware threads\n", std::thread::hardware_concurrency());
+
+    // warms up the pool, its slabs are kept across runs
+    Run(true);
+
+    BenchReport("operator new", COUNT, Run(false));
+    BenchReport("AnyPool", COUNT, Run(true));
+
+    return 0;
+}
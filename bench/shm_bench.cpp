@@ -0,0 +1,172 @@
+#include "any_shm.hpp"
+#include "bench.hpp"
+#include <csignal>
+#include <string>
+#include <thread>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+
+/*
+ * Cross-process hand-off through AnyShmRing (Linux): a forked child echoes every value it pops
+ * from a ping ring into a pong ring, the parent measures the round trips (one hand-off is half
+ * of one), then the throughput of a stream from the child to the parent. Values are an int, a
+ * 64-byte trivially copyable struct (both copied with memcpy) and a 100-character string
+ * (serialized). Both sides poll, so with a single core the numbers include the scheduler's slices.
+ */
+namespace
+{
+    constexpr int ROUND_TRIPS = 200000;
+    constexpr int STREAM = 2000000;
+
+    struct Quote
+    {
+        double prices[8];
+    };
+
+    const AnySerializer &Serializer()
+    {
+        static AnySerializer serializer;
+        static bool registered = false;
+
+        if (!registered)
+        {
+            serializer.Register<int>("int");
+            serializer.Register<Quote>("Quote");
+            serializer.Register<std::string>("string",
+                [](const std::string &text, std::vector<unsigned char> &out) { out.insert(out.end(), text.begin(), text.end()); },
+                [](const unsigned char *data, size_t size) { return std::optional<std::string>(std::string(reinterpret_cast<const char*>(data), size)); });
+            registered = true;
+        }
+
+        return serializer;
+    }
+
+    // spins, yielding now and then so that a single core makes progress
+    template <typename F>
+    void Poll(F attempt)
+    {
+        for (unsigned misses = 0; !attempt(); misses++)
+            if (misses % 1024 == 1023)
+                std::this_thread::yield();
+    }
+
+    void Push(AnyShmRing &ring, const Any<16> &value)
+    {
+        Poll([&]() { return ring.Push(value) != AnyError::OutOfMemory; });
+    }
+
+    void Pop(AnyShmRing &ring, Any<16> &value)
+    {
+        Poll([&]() { return ring.Pop(value) != AnyError::Empty; });
+    }
+
+    // runs child() in a forked process attached to the rings, returns false if it failed
+    template <typename F>
+    bool Fork(const std::string &ping, const std::string &pong, F child)
+    {
+        const pid_t pid = ::fork();
+
+        if (pid == 0)
+        {
+            ::prctl(PR_SET_PDEATHSIG, SIGKILL);
+
+            AnyShmRing in(Serializer());
+            AnyShmRing out(Serializer());
+
+            if (!in.Open(ping.c_str()) || !out.Open(pong.c_str()))
+                ::_exit(EXIT_FAILURE);
+
+            child(in, out);
+
+            ::_exit(EXIT_SUCCESS);
+        }
+
+        return pid > 0;
+    }
+
+    void RoundTrips(const char *name, const Any<16> &value, AnyShmRing &ping, AnyShmRing &pong, const std::string &pingName, const std::string &pongName)
+    {
+        if (!Fork(pingName, pongName, [](AnyShmRing &in, AnyShmRing &out)
+        {
+            Any<16> echo;
+
+            for (int i = 0; i < ROUND_TRIPS; i++)
+            {
+                Pop(in, echo);
+                Push(out, echo);
+            }
+        }))
+            return;
+
+        Any<16> echo;
+
+        const double seconds = BenchSeconds([&]()
+        {
+            for (int i = 0; i < ROUND_TRIPS; i++)
+            {
+                Push(ping, value);
+                Pop(pong, echo);
+            }
+        });
+
+        ::wait(nullptr);
+
+        BenchReport(name, 2.0 * ROUND_TRIPS, seconds);
+    }
+
+    void Stream(const char *name, const Any<16> &value, AnyShmRing &pong, const std::string &pingName, const std::string &pongName)
+    {
+        if (!Fork(pingName, pongName, [&value](AnyShmRing &, AnyShmRing &out)
+        {
+            for (int i = 0; i < STREAM; i++)
+                Push(out, value);
+        }))
+            return;
+
+        Any<16> received;
+
+        const double seconds = BenchSeconds([&]()
+        {
+            for (int i = 0; i < STREAM; i++)
+                Pop(pong, received);
+        });
+
+        ::wait(nullptr);
+
+        BenchReport(name, STREAM, seconds);
+    }
+}
+
+int main()
+{
+    const std::string pingName = "/any_shm_bench_ping_" + std::to_string(::getpid());
+    const std::string pongName = "/any_shm_bench_pong_" + std::to_string(::getpid());
+
+    AnyShmRing ping(Serializer());
+    AnyShmRing pong(Serializer());
+
+    if (!ping.Create(pingName.c_str(), size_t(1) << 20) || !pong.Create(pongName.c_str(), size_t(1) << 20))
+    {
+        std::fprintf(stderr, "shm_open failed\n");
+        return 1;
+    }
+
+    std::printf("%u hardware threads\n", std::thread::hardware_concurrency());
+
+    const Any<16> integer = 42;
+    const Any<16> quote = Quote{ { 1, 2, 3, 4, 5, 6, 7, 8 } };
+    const Any<16> text = std::string(100, 'q');
+
+    RoundTrips("hand-off int", integer, ping, pong, pingName, pongName);
+    RoundTrips("hand-off 64-byte struct", quote, ping, pong, pingName, pongName);
+    RoundTrips("hand-off string", text, ping, pong, pingName, pongName);
+
+    Stream("stream int", integer, pong, pingName, pongName);
+    Stream("stream 64-byte struct", quote, pong, pingName, pongName);
+    Stream("stream string", text, pong, pingName, pongName);
+
+    AnyShmRing::Unlink(pingName.c_str());
+    AnyShmRing::Unlink(pongName.c_str());
+
+    return 0;
+}
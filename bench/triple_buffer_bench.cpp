@@ -0,0 +1,113 @@
+#include "triple_buffer_any.hpp"
+#include "bench.hpp"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+/*
+ * High-rate latest-value publishing from one writer to one reader, for 1 second each:
+ *   TripleBufferAny     lock-free slot exchange, no allocation
+ *   mutex               an Any<32> guarded by a std::mutex
+ *   atomic shared_ptr   AtomicAny-style: a new immutable Any per update, swapped with std::atomic_store
+ * The writer publishes as fast as it can while the reader polls the latest value.
+ */
+namespace
+{
+    struct Quote
+    {
+        double bid;
+        double ask;
+        long sequence;
+    };
+
+    constexpr double DURATION = 1.0;
+
+    // runs publish(sequence) and read() -> sequence concurrently, reports both rates
+    template <typename Publish, typename Read>
+    void Run(const char *name, Publish publish, Read read)
+    {
+        std::atomic<bool> stop{ false };
+        long reads = 0;
+        long stale = 0;   // reads that returned an already seen value
+
+        std::thread reader([&]()
+        {
+            long last = -1;
+
+            while (!stop.load(std::memory_order_relaxed))
+            {
+                const long sequence = read();
+
+                stale += sequence == last;
+                last = sequence;
+                reads++;
+            }
+        });
+
+        long writes = 0;
+        const BenchClock::time_point start = BenchClock::now();
+        double seconds = 0;
+
+        while (seconds < DURATION)
+        {
+            for (int i = 0; i < 1024; i++)
+                publish(writes++);
+
+            seconds = std::chrono::duration<double>(BenchClock::now() - start).count();
+        }
+
+        stop = true;
+        reader.join();
+
+        char label[128];
+
+        std::snprintf(label, sizeof(label), "%s, writer", name);
+        BenchReport(label, double(writes), seconds);
+
+        std::snprintf(label, sizeof(label), "%s, reader (%.1f%% stale)", name, reads ? 100.0 * double(stale) / double(reads) : 0.0);
+        BenchReport(label, double(reads), seconds);
+    }
+}
+
+int main()
+{
+    {
+        TripleBufferAny<32> buffer;
+
+        Run("TripleBufferAny",
+            [&](long sequence) { buffer.Publish(Quote{ 1.0, 2.0, sequence }); },
+            [&]() { const Any<32> &value = buffer.Read(); return value ? value.Get<Quote>().sequence : -1L; });
+    }
+
+    {
+        std::mutex mutex;
+        Any<32> latest;
+
+        Run("mutex",
+            [&](long sequence)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                latest = Quote{ 1.0, 2.0, sequence };
+            },
+            [&]()
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                return latest ? latest.Get<Quote>().sequence : -1L;
+            });
+    }
+
+    {
+        std::shared_ptr<const Any<32>> latest = std::make_shared<const Any<32>>();
+
+        Run("atomic shared_ptr",
+            [&](long sequence) { std::atomic_store(&latest, std::make_shared<const Any<32>>(Quote{ 1.0, 2.0, sequence })); },
+            [&]()
+            {
+                std::shared_ptr<const Any<32>> value = std::atomic_load(&latest);
+                return *value ? value->Get<Quote>().sequence : -1L;
+            });
+    }
+
+    return 0;
+}
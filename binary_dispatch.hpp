@@ -0,0 +1,257 @@
+#ifndef BINARY_DISPATCH_H
+#define BINARY_DISPATCH_H
+
+#include "any.hpp"
+#include <cstdint>
+#include <vector>
+
+/*
+ * Double dispatch of a binary operation on two Any values. Registered types get a dense index
+ * (found with an open addressing table keyed by the type descriptor) and handlers live in a dense
+ * 2-D table, so an operation costs two index probes and one table lookup.
+ *
+ * Register<L, R>() uses Op()(l, r), Register<L, R>(handler) a custom function. Pairs without
+ * a handler are resolved at registration time through the registered promotions (at most one per
+ * operand), e.g. (int, double) -> (double, double).
+ */
+template <typename Op, size_t SIZE = 8>
+class BinaryDispatch
+{
+public:
+    using Handler = Any<SIZE> (*)(const void *lhs, const void *rhs);
+
+    BinaryDispatch() : mIndexMask(0) {}
+
+    template <typename L, typename R>
+    void Register()
+    {
+        Register<L, R>(&Apply<L, R>);
+    }
+
+    template <typename L, typename R>
+    void Register(Handler handler);
+
+    // From is implicitly converted to To (static_cast) when no handler exists for the original pair
+    template <typename From, typename To>
+    void RegisterPromotion();
+
+    // empty if no handler is registered for the pair of types
+    Any<SIZE> operator()(const Any<SIZE> &lhs, const Any<SIZE> &rhs) const;
+
+    bool Supports(AnyType lhs, AnyType rhs) const;
+
+private:
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    using Convert = Any<SIZE> (*)(const void *from);
+
+    struct Cell
+    {
+        Handler handler = nullptr;
+        Convert lhs = nullptr;   // promotions applied before calling handler
+        Convert rhs = nullptr;
+        bool direct = false;     // registered for this pair (not resolved through a promotion)
+    };
+
+    struct Promotion
+    {
+        uint32_t from;
+        uint32_t to;
+        Convert convert;
+    };
+
+    template <typename L, typename R>
+    static Any<SIZE> Apply(const void *lhs, const void *rhs)
+    {
+        return Any<SIZE>(Op()(*static_cast<const L*>(lhs), *static_cast<const R*>(rhs)));
+    }
+
+    template <typename From, typename To>
+    static Any<SIZE> Promote(const void *from)
+    {
+        return Any<SIZE>(static_cast<To>(*static_cast<const From*>(from)));
+    }
+
+    uint32_t IndexOf(AnyType type) const;
+    uint32_t AddType(AnyType type);
+    void Resolve();
+
+    static size_t Slot(AnyType type) { return static_cast<size_t>((reinterpret_cast<uintptr_t>(type) >> 3) * 0x9e3779b97f4a7c15ull >> 16); }
+
+    std::vector<AnyType> mTypes;
+    std::vector<std::pair<AnyType, uint32_t>> mIndex;   // open addressing, power of two capacity
+    size_t mIndexMask;
+
+    std::vector<Cell> mTable;   // mTypes.size() x mTypes.size()
+    std::vector<Promotion> mPromotions;
+};
+
+template <typename Op, size_t SIZE>
+template <typename L, typename R>
+void BinaryDispatch<Op, SIZE>::Register(Handler handler)
+{
+    uint32_t lhs = AddType(AnyTypeOf<L>());
+    uint32_t rhs = AddType(AnyTypeOf<R>());
+
+    Cell &cell = mTable[lhs * mTypes.size() + rhs];
+    cell.handler = handler;
+    cell.lhs = nullptr;
+    cell.rhs = nullptr;
+    cell.direct = true;
+
+    Resolve();
+}
+
+template <typename Op, size_t SIZE>
+template <typename From, typename To>
+void BinaryDispatch<Op, SIZE>::RegisterPromotion()
+{
+    uint32_t from = AddType(AnyTypeOf<From>());
+    uint32_t to = AddType(AnyTypeOf<To>());
+
+    mPromotions.push_back(Promotion{ from, to, &Promote<From, To> });
+
+    Resolve();
+}
+
+template <typename Op, size_t SIZE>
+Any<SIZE> BinaryDispatch<Op, SIZE>::operator()(const Any<SIZE> &lhs, const Any<SIZE> &rhs) const
+{
+    uint32_t l = IndexOf(lhs.Type());
+    uint32_t r = IndexOf(rhs.Type());
+
+    if (l == NONE || r == NONE)
+        return Any<SIZE>();
+
+    const Cell &cell = mTable[l * mTypes.size() + r];
+
+    if (!cell.handler)
+        return Any<SIZE>();
+
+    if (!cell.lhs && !cell.rhs)
+        return cell.handler(lhs.Data(), rhs.Data());
+
+    Any<SIZE> promotedLhs = cell.lhs ? cell.lhs(lhs.Data()) : Any<SIZE>();
+    Any<SIZE> promotedRhs = cell.rhs ? cell.rhs(rhs.Data()) : Any<SIZE>();
+
+    return cell.handler(cell.lhs ? promotedLhs.Data() : lhs.Data(), cell.rhs ? promotedRhs.Data() : rhs.Data());
+}
+
+template <typename Op, size_t SIZE>
+bool BinaryDispatch<Op, SIZE>::Supports(AnyType lhs, AnyType rhs) const
+{
+    uint32_t l = IndexOf(lhs);
+    uint32_t r = IndexOf(rhs);
+
+    return l != NONE && r != NONE && mTable[l * mTypes.size() + r].handler;
+}
+
+template <typename Op, size_t SIZE>
+uint32_t BinaryDispatch<Op, SIZE>::IndexOf(AnyType type) const
+{
+    if (!type || mIndex.empty())
+        return NONE;
+
+    for (size_t slot = Slot(type) & mIndexMask; ; slot = (slot + 1) & mIndexMask)
+    {
+        if (mIndex[slot].first == type)
+            return mIndex[slot].second;
+
+        if (!mIndex[slot].first)
+            return NONE;
+    }
+}
+
+template <typename Op, size_t SIZE>
+uint32_t BinaryDispatch<Op, SIZE>::AddType(AnyType type)
+{
+    uint32_t index = IndexOf(type);
+
+    if (index != NONE)
+        return index;
+
+    index = static_cast<uint32_t>(mTypes.size());
+    mTypes.push_back(type);
+
+    // grow the dense table, keeping the registered cells
+    const size_t count = mTypes.size();
+    std::vector<Cell> table(count * count);
+
+    for (size_t l = 0; l + 1 < count; l++)
+        for (size_t r = 0; r + 1 < count; r++)
+            table[l * count + r] = mTable[l * (count - 1) + r];
+
+    mTable.swap(table);
+
+    // rebuild the index at load factor <= 1/2
+    if (count * 2 > mIndex.size())
+    {
+        mIndex.assign(mIndex.empty() ? 16 : mIndex.size() * 2, std::pair<AnyType, uint32_t>(nullptr, NONE));
+        mIndexMask = mIndex.size() - 1;
+
+        for (uint32_t i = 0; i + 1 < count; i++)
+        {
+            size_t slot = Slot(mTypes[i]) & mIndexMask;
+
+            while (mIndex[slot].first)
+                slot = (slot + 1) & mIndexMask;
+
+            mIndex[slot] = std::make_pair(mTypes[i], i);
+        }
+    }
+
+    size_t slot = Slot(type) & mIndexMask;
+
+    while (mIndex[slot].first)
+        slot = (slot + 1) & mIndexMask;
+
+    mIndex[slot] = std::make_pair(type, index);
+
+    return index;
+}
+
+template <typename Op, size_t SIZE>
+void BinaryDispatch<Op, SIZE>::Resolve()
+{
+    const size_t count = mTypes.size();
+
+    for (size_t l = 0; l < count; l++)
+        for (size_t r = 0; r < count; r++)
+        {
+            Cell &cell = mTable[l * count + r];
+
+            if (cell.direct)
+                continue;
+
+            cell = Cell();
+
+            // promote one operand first, then both
+            for (const Promotion &p : mPromotions)
+                if (p.from == l && mTable[p.to * count + r].direct)
+                {
+                    cell.handler = mTable[p.to * count + r].handler;
+                    cell.lhs = p.convert;
+                    break;
+                }
+                else if (p.from == r && mTable[l * count + p.to].direct)
+                {
+                    cell.handler = mTable[l * count + p.to].handler;
+                    cell.rhs = p.convert;
+                    break;
+                }
+
+            if (cell.handler)
+                continue;
+
+            for (const Promotion &pl : mPromotions)
+                for (const Promotion &pr : mPromotions)
+                    if (!cell.handler && pl.from == l && pr.from == r && mTable[pl.to * count + pr.to].direct)
+                    {
+                        cell.handler = mTable[pl.to * count + pr.to].handler;
+                        cell.lhs = pl.convert;
+                        cell.rhs = pr.convert;
+                    }
+        }
+}
+
+#endif  // BINARY_DISPATCH_H
@@ -0,0 +1,434 @@
+#ifndef CONCURRENT_ANY_MAP_H
+#define CONCURRENT_ANY_MAP_H
+
+#include "any.hpp"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+/*
+ * Concurrent hash map from strings to Any for read-mostly shared state. Writers lock one of
+ * a fixed number of stripes (a bucket always belongs to the same stripe) and never modify a
+ * published node: a new value is emplaced in place in a new node which replaces the previous one
+ * in its chain. Readers take no lock, they only register in a reader counter so that replaced
+ * nodes are reclaimed once no reader can see them (grace period over two reader counters, like SRCU).
+ *
+ * Visit gives a view of the value without copying it out. The view is read-only and must not
+ * escape the visitor. The table doubles when the load factor exceeds 1, copying the nodes.
+ */
+template <size_t SIZE>
+class ConcurrentAnyMap
+{
+public:
+    explicit ConcurrentAnyMap(size_t buckets = 1024, size_t stripes = 64);
+    ~ConcurrentAnyMap();
+
+    ConcurrentAnyMap(const ConcurrentAnyMap&) = delete;
+    ConcurrentAnyMap &operator=(const ConcurrentAnyMap&) = delete;
+
+    // f(const Any<SIZE> &) with the value in the map, false if the key isn't in the map
+    template <typename F>
+    bool Visit(std::string_view key, F f) const;
+
+    bool Contains(std::string_view key) const { return Visit(key, [](const Any<SIZE>&) {}); }
+
+    // copy of the value
+    bool Find(std::string_view key, Any<SIZE> &value) const;
+
+    // inserts or replaces, the value is constructed in place in the node; true if the key was inserted
+    template <typename T, typename... Args>
+    bool Emplace(std::string_view key, Args &&...args);
+
+    bool Insert(std::string_view key, Any<SIZE> value);
+
+    bool Erase(std::string_view key);
+
+    size_t Size() const { return mSize.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr size_t READER_SLOTS = 64;
+    static constexpr size_t RECLAIM_THRESHOLD = 256;   // retired nodes triggering a grace period
+
+    struct Node
+    {
+        Node(size_t hash, std::string_view key) : next(nullptr), hash(hash), key(key) {}
+
+        std::atomic<Node*> next;
+        size_t hash;
+        std::string key;
+        Any<SIZE> value;
+    };
+
+    struct Table
+    {
+        explicit Table(size_t size) : mask(size - 1), buckets(new std::atomic<Node*>[size])
+        {
+            for (size_t i = 0; i < size; i++)
+                buckets[i].store(nullptr, std::memory_order_relaxed);
+        }
+
+        size_t mask;
+        std::unique_ptr<std::atomic<Node*>[]> buckets;
+    };
+
+    struct alignas(ANY_CACHE_LINE_SIZE) Stripe
+    {
+        std::mutex mutex;
+    };
+
+    // readers of each phase, spread over slots to avoid contention on a single counter
+    struct alignas(ANY_CACHE_LINE_SIZE) ReaderSlot
+    {
+        std::atomic<size_t> readers[2] = { { 0 }, { 0 } };
+    };
+
+    class ReadGuard
+    {
+    public:
+        explicit ReadGuard(const ConcurrentAnyMap &map) : mCounter(Register(map)) {}
+
+        ~ReadGuard() { mCounter.fetch_sub(1, std::memory_order_release); }
+
+    private:
+        // counts the reader in the counter of the current phase, checking that the phase didn't
+        // change in between: a writer flipping it may have already found that counter at zero
+        static std::atomic<size_t> &Register(const ConcurrentAnyMap &map)
+        {
+            ReaderSlot &slot = map.mReaders[ThreadSlot()];
+
+            for (;;)
+            {
+                const unsigned phase = map.mPhase.load(std::memory_order_seq_cst);
+                std::atomic<size_t> &counter = slot.readers[phase & 1];
+
+                counter.fetch_add(1, std::memory_order_seq_cst);
+
+                if (map.mPhase.load(std::memory_order_seq_cst) == phase)
+                    return counter;
+
+                counter.fetch_sub(1, std::memory_order_release);
+            }
+        }
+
+        std::atomic<size_t> &mCounter;
+    };
+
+    static size_t ThreadSlot()
+    {
+        static std::atomic<size_t> threads{ 0 };
+        thread_local size_t slot = threads.fetch_add(1, std::memory_order_relaxed) % READER_SLOTS;
+
+        return slot;
+    }
+
+    static size_t RoundUpPowerOfTwo(size_t size)
+    {
+        size_t power = 1;
+
+        while (power < size)
+            power <<= 1;
+
+        return power;
+    }
+
+    static size_t Hash(std::string_view key) { return std::hash<std::string_view>()(key); }
+
+    const Node *FindNode(std::string_view key, size_t hash) const;
+
+    // links node in place of the node with the same key, true if the key was inserted
+    bool Publish(Node *node);
+
+    void Retire(Node *node);
+    void Grow();
+    void Synchronize();   // waits until no reader can see the nodes retired so far
+    void Reclaim();
+
+    std::atomic<Table*> mTable;
+    std::unique_ptr<Stripe[]> mStripes;
+    size_t mStripeMask;
+
+    std::atomic<size_t> mSize;
+
+    mutable std::unique_ptr<ReaderSlot[]> mReaders;
+    std::atomic<unsigned> mPhase;
+
+    std::mutex mRetireMutex;
+    std::vector<Node*> mRetiredNodes;
+    std::vector<Table*> mRetiredTables;
+
+    std::mutex mReclaimMutex;
+};
+
+template <size_t SIZE>
+ConcurrentAnyMap<SIZE>::ConcurrentAnyMap(size_t buckets, size_t stripes) :
+    mStripes(new Stripe[RoundUpPowerOfTwo(stripes ? stripes : 1)]), mStripeMask(RoundUpPowerOfTwo(stripes ? stripes : 1) - 1),
+    mSize(0), mReaders(new ReaderSlot[READER_SLOTS]), mPhase(0)
+{
+    // a bucket belongs to a single stripe as long as there are at least as many buckets as stripes
+    size_t size = RoundUpPowerOfTwo(buckets);
+
+    mTable.store(new Table(size > mStripeMask + 1 ? size : mStripeMask + 1), std::memory_order_relaxed);
+}
+
+template <size_t SIZE>
+ConcurrentAnyMap<SIZE>::~ConcurrentAnyMap()
+{
+    Table *table = mTable.load(std::memory_order_relaxed);
+
+    for (size_t i = 0; i <= table->mask; i++)
+        for (Node *node = table->buckets[i].load(std::memory_order_relaxed); node; )
+        {
+            Node *next = node->next.load(std::memory_order_relaxed);
+
+            delete node;
+            node = next;
+        }
+
+    delete table;
+
+    for (Node *node : mRetiredNodes)
+        delete node;
+
+    for (Table *retired : mRetiredTables)
+        delete retired;
+}
+
+template <size_t SIZE>
+const typename ConcurrentAnyMap<SIZE>::Node *ConcurrentAnyMap<SIZE>::FindNode(std::string_view key, size_t hash) const
+{
+    const Table *table = mTable.load(std::memory_order_acquire);
+
+    for (const Node *node = table->buckets[hash & table->mask].load(std::memory_order_acquire); node; node = node->next.load(std::memory_order_acquire))
+        if (node->hash == hash && node->key == key)
+            return node;
+
+    return nullptr;
+}
+
+template <size_t SIZE>
+template <typename F>
+bool ConcurrentAnyMap<SIZE>::Visit(std::string_view key, F f) const
+{
+    ReadGuard guard(*this);
+
+    const Node *node = FindNode(key, Hash(key));
+
+    if (!node)
+        return false;
+
+    f(node->value);
+
+    return true;
+}
+
+template <size_t SIZE>
+bool ConcurrentAnyMap<SIZE>::Find(std::string_view key, Any<SIZE> &value) const
+{
+    ReadGuard guard(*this);
+
+    const Node *node = FindNode(key, Hash(key));
+
+    if (!node)
+        return false;
+
+    value = node->value;
+
+    return true;
+}
+
+template <size_t SIZE>
+template <typename T, typename... Args>
+bool ConcurrentAnyMap<SIZE>::Emplace(std::string_view key, Args &&...args)
+{
+    std::unique_ptr<Node> node(new Node(Hash(key), key));
+
+    node->value.template Emplace<T>(std::forward<Args>(args)...);
+
+    return Publish(node.release());
+}
+
+template <size_t SIZE>
+bool ConcurrentAnyMap<SIZE>::Insert(std::string_view key, Any<SIZE> value)
+{
+    std::unique_ptr<Node> node(new Node(Hash(key), key));
+
+    node->value = std::move(value);
+
+    return Publish(node.release());
+}
+
+template <size_t SIZE>
+bool ConcurrentAnyMap<SIZE>::Publish(Node *node)
+{
+    bool inserted;
+
+    {
+        std::lock_guard<std::mutex> lock(mStripes[node->hash & mStripeMask].mutex);
+
+        // the table is only replaced with all the stripes locked
+        Table *table = mTable.load(std::memory_order_acquire);
+        std::atomic<Node*> *link = &table->buckets[node->hash & table->mask];
+
+        Node *current = link->load(std::memory_order_relaxed);
+
+        while (current && (current->hash != node->hash || current->key != node->key))
+        {
+            link = &current->next;
+            current = link->load(std::memory_order_relaxed);
+        }
+
+        inserted = !current;
+
+        node->next.store(current ? current->next.load(std::memory_order_relaxed) : nullptr, std::memory_order_relaxed);
+        link->store(node, std::memory_order_release);
+
+        if (current)
+            Retire(current);
+    }
+
+    if (inserted && mSize.fetch_add(1, std::memory_order_relaxed) + 1 > mTable.load(std::memory_order_relaxed)->mask + 1)
+        Grow();
+
+    Reclaim();
+
+    return inserted;
+}
+
+template <size_t SIZE>
+bool ConcurrentAnyMap<SIZE>::Erase(std::string_view key)
+{
+    const size_t hash = Hash(key);
+
+    {
+        std::lock_guard<std::mutex> lock(mStripes[hash & mStripeMask].mutex);
+
+        Table *table = mTable.load(std::memory_order_acquire);
+        std::atomic<Node*> *link = &table->buckets[hash & table->mask];
+
+        Node *current = link->load(std::memory_order_relaxed);
+
+        while (current && (current->hash != hash || current->key != key))
+        {
+            link = &current->next;
+            current = link->load(std::memory_order_relaxed);
+        }
+
+        if (!current)
+            return false;
+
+        link->store(current->next.load(std::memory_order_relaxed), std::memory_order_release);
+        mSize.fetch_sub(1, std::memory_order_relaxed);
+
+        Retire(current);
+    }
+
+    Reclaim();
+
+    return true;
+}
+
+template <size_t SIZE>
+void ConcurrentAnyMap<SIZE>::Retire(Node *node)
+{
+    std::lock_guard<std::mutex> lock(mRetireMutex);
+
+    mRetiredNodes.push_back(node);
+}
+
+template <size_t SIZE>
+void ConcurrentAnyMap<SIZE>::Grow()
+{
+    std::vector<std::unique_lock<std::mutex>> locks;
+
+    for (size_t i = 0; i <= mStripeMask; i++)
+        locks.emplace_back(mStripes[i].mutex);
+
+    Table *table = mTable.load(std::memory_order_relaxed);
+
+    if (mSize.load(std::memory_order_relaxed) <= table->mask + 1)  // another writer grew it
+        return;
+
+    // the copies belong to the map, not to the writer's FrameScope or AnyPoolScope: allocate them with operator new
+    struct GlobalHeap
+    {
+        GlobalHeap() : previous(detail::ThreadHeapResource()) { detail::ThreadHeapResource() = nullptr; }
+        ~GlobalHeap() { detail::ThreadHeapResource() = previous; }
+
+        AnyHeapResource *previous;
+    } globalHeap;
+
+    // readers may be traversing the old chains, so the nodes are copied rather than relinked
+    Table *grown = new Table((table->mask + 1) * 2);
+
+    for (size_t i = 0; i <= table->mask; i++)
+        for (Node *node = table->buckets[i].load(std::memory_order_relaxed); node; node = node->next.load(std::memory_order_relaxed))
+        {
+            Node *copy = new Node(node->hash, node->key);
+            copy->value = node->value;
+
+            std::atomic<Node*> &bucket = grown->buckets[node->hash & grown->mask];
+
+            copy->next.store(bucket.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            bucket.store(copy, std::memory_order_relaxed);
+        }
+
+    mTable.store(grown, std::memory_order_release);
+
+    std::lock_guard<std::mutex> lock(mRetireMutex);
+
+    for (size_t i = 0; i <= table->mask; i++)
+        for (Node *node = table->buckets[i].load(std::memory_order_relaxed); node; node = node->next.load(std::memory_order_relaxed))
+            mRetiredNodes.push_back(node);
+
+    mRetiredTables.push_back(table);
+}
+
+template <size_t SIZE>
+void ConcurrentAnyMap<SIZE>::Synchronize()
+{
+    // A reader counted in the previous phase read it again after registering, before the flip
+    // in the single total order of the seq_cst operations, so the waits below see it registered.
+    // A reader counted in the new phase read the flip, which makes the unlinking of the retired
+    // nodes (before the flip) visible to it. Only one writer synchronizes at a time (Reclaim).
+    const unsigned previous = mPhase.fetch_add(1, std::memory_order_seq_cst) & 1;
+
+    for (size_t i = 0; i < READER_SLOTS; i++)
+        while (mReaders[i].readers[previous].load(std::memory_order_seq_cst))
+            std::this_thread::yield();
+}
+
+template <size_t SIZE>
+void ConcurrentAnyMap<SIZE>::Reclaim()
+{
+    std::unique_lock<std::mutex> reclaim(mReclaimMutex, std::try_to_lock);
+
+    if (!reclaim)  // another writer is reclaiming
+        return;
+
+    std::vector<Node*> nodes;
+    std::vector<Table*> tables;
+
+    {
+        std::lock_guard<std::mutex> lock(mRetireMutex);
+
+        if (mRetiredNodes.size() < RECLAIM_THRESHOLD && mRetiredTables.empty())
+            return;
+
+        nodes.swap(mRetiredNodes);
+        tables.swap(mRetiredTables);
+    }
+
+    Synchronize();
+
+    for (Node *node : nodes)
+        delete node;
+
+    for (Table *table : tables)
+        delete table;
+}
+
+#endif  // CONCURRENT_ANY_MAP_H
@@ -0,0 +1,287 @@
+#ifndef MEMO_CACHE_H
+#define MEMO_CACHE_H
+
+#include "any.hpp"
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * Memoization cache keyed by tuples of Any, hashed and compared with the operations of the
+ * type descriptors (keys are never serialized, their types must be AnyHashable). Inserted keys
+ * are deep-copied, so referenced (Handle) and shared keys can change afterwards. The cache is
+ * split in shards, each with a byte budget (footprint of keys and values) and CLOCK eviction.
+ * Lookups only take a shared lock: a hit just sets the entry's reference bit.
+ */
+template <size_t SIZE, typename Value = Any<SIZE>>
+class MemoCache
+{
+public:
+    explicit MemoCache(size_t byteBudget, size_t shards = 16);
+
+    MemoCache(const MemoCache&) = delete;
+    MemoCache &operator=(const MemoCache&) = delete;
+
+    // copies the cached value to value on a hit
+    bool Find(const Any<SIZE> *keys, size_t count, Value &value) const;
+
+    // false if a key isn't hashable, can't be copied or the entry doesn't fit in a shard budget
+    bool Insert(const Any<SIZE> *keys, size_t count, Value value, size_t valueFootprint = sizeof(Value));
+
+    // compute() -> Value is called on a miss, concurrent misses of the same key may compute it more than once
+    template <typename F>
+    Value GetOrCompute(const Any<SIZE> *keys, size_t count, F compute, size_t valueFootprint = sizeof(Value));
+
+    void Clear();
+
+    size_t Bytes() const;   // footprint of the cached entries
+    size_t Entries() const;
+
+private:
+    struct KeyView
+    {
+        const Any<SIZE> *keys;
+        size_t count;
+        size_t hash;
+    };
+
+    struct KeyHash
+    {
+        size_t operator()(const KeyView &key) const { return key.hash; }
+    };
+
+    struct KeyEqual
+    {
+        bool operator()(const KeyView &a, const KeyView &b) const
+        {
+            if (a.hash != b.hash || a.count != b.count)
+                return false;
+
+            for (size_t i = 0; i < a.count; i++)
+                if (!a.keys[i].Equals(b.keys[i]))
+                    return false;
+
+            return true;
+        }
+    };
+
+    struct Node
+    {
+        std::vector<Any<SIZE>> keys;
+        size_t hash;
+        Value value;
+        size_t footprint;
+        mutable std::atomic<bool> referenced;
+    };
+
+    struct alignas(ANY_CACHE_LINE_SIZE) Shard
+    {
+        mutable std::shared_mutex mutex;
+
+        std::unordered_map<KeyView, Node*, KeyHash, KeyEqual> map;   // views point into the nodes' keys
+        std::vector<std::unique_ptr<Node>> clock;
+        size_t hand = 0;
+        size_t bytes = 0;
+    };
+
+    static bool Hash(const Any<SIZE> *keys, size_t count, size_t &hash);
+
+    void Evict(Shard &shard, size_t bytes);
+
+    std::unique_ptr<Shard[]> mShards;
+    size_t mShardCount;
+    size_t mShardBudget;
+};
+
+template <size_t SIZE, typename Value>
+MemoCache<SIZE, Value>::MemoCache(size_t byteBudget, size_t shards) :
+    mShards(new Shard[shards ? shards : 1]), mShardCount(shards ? shards : 1), mShardBudget(byteBudget / (shards ? shards : 1))
+{
+}
+
+template <size_t SIZE, typename Value>
+bool MemoCache<SIZE, Value>::Hash(const Any<SIZE> *keys, size_t count, size_t &hash)
+{
+    hash = count;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if (!keys[i].Hashable() && keys[i])
+            return false;
+
+        // boost::hash_combine, mixing in the type so equal values of different types don't collide
+        size_t h = keys[i].Hash() ^ std::hash<const void*>()(keys[i].Type());
+        hash ^= h + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+    }
+
+    return true;
+}
+
+template <size_t SIZE, typename Value>
+bool MemoCache<SIZE, Value>::Find(const Any<SIZE> *keys, size_t count, Value &value) const
+{
+    size_t hash;
+
+    if (!Hash(keys, count, hash))
+        return false;
+
+    const Shard &shard = mShards[hash % mShardCount];
+
+    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+
+    auto it = shard.map.find(KeyView{ keys, count, hash });
+
+    if (it == shard.map.end())
+        return false;
+
+    it->second->referenced.store(true, std::memory_order_relaxed);
+    value = it->second->value;
+
+    return true;
+}
+
+template <size_t SIZE, typename Value>
+bool MemoCache<SIZE, Value>::Insert(const Any<SIZE> *keys, size_t count, Value value, size_t valueFootprint)
+{
+    size_t hash;
+
+    if (!Hash(keys, count, hash))
+        return false;
+
+    // deep copies: referenced (Handle) and shared keys could change or go away after being hashed
+    std::vector<Any<SIZE>> copies(count);
+    size_t footprint = sizeof(Node) + valueFootprint;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if (copies[i].Assign(keys[i].Type(), keys[i].Data()) != AnyError::None)
+            return false;
+
+        footprint += copies[i].Footprint();
+    }
+
+    if (footprint > mShardBudget)
+        return false;
+
+    std::unique_ptr<Node> node(new Node{ std::move(copies), hash, std::move(value), footprint, { false } });
+
+    Shard &shard = mShards[hash % mShardCount];
+
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+
+    auto it = shard.map.find(KeyView{ keys, count, hash });
+
+    if (it != shard.map.end())  // replace the value
+    {
+        Node &existing = *it->second;
+
+        shard.bytes = shard.bytes - existing.footprint + footprint;
+
+        existing.value = std::move(node->value);
+        existing.footprint = footprint;
+        existing.referenced.store(true, std::memory_order_relaxed);
+
+        Evict(shard, 0);
+
+        return true;
+    }
+
+    Evict(shard, footprint);
+
+    shard.map.emplace(KeyView{ node->keys.data(), count, hash }, node.get());
+    shard.clock.push_back(std::move(node));
+    shard.bytes += footprint;
+
+    return true;
+}
+
+template <size_t SIZE, typename Value>
+template <typename F>
+Value MemoCache<SIZE, Value>::GetOrCompute(const Any<SIZE> *keys, size_t count, F compute, size_t valueFootprint)
+{
+    Value value;
+
+    if (Find(keys, count, value))
+        return value;
+
+    value = compute();
+
+    Insert(keys, count, value, valueFootprint);
+
+    return value;
+}
+
+template <size_t SIZE, typename Value>
+void MemoCache<SIZE, Value>::Evict(Shard &shard, size_t bytes)
+{
+    // CLOCK: entries referenced since the hand last passed get a second chance
+    while (shard.bytes + bytes > mShardBudget && !shard.clock.empty())
+    {
+        if (shard.hand >= shard.clock.size())
+            shard.hand = 0;
+
+        Node &node = *shard.clock[shard.hand];
+
+        if (node.referenced.exchange(false, std::memory_order_relaxed))
+        {
+            shard.hand++;
+            continue;
+        }
+
+        shard.map.erase(KeyView{ node.keys.data(), node.keys.size(), node.hash });
+        shard.bytes -= node.footprint;
+
+        shard.clock[shard.hand] = std::move(shard.clock.back());
+        shard.clock.pop_back();
+    }
+}
+
+template <size_t SIZE, typename Value>
+void MemoCache<SIZE, Value>::Clear()
+{
+    for (size_t i = 0; i < mShardCount; i++)
+    {
+        std::unique_lock<std::shared_mutex> lock(mShards[i].mutex);
+
+        mShards[i].map.clear();
+        mShards[i].clock.clear();
+        mShards[i].hand = 0;
+        mShards[i].bytes = 0;
+    }
+}
+
+template <size_t SIZE, typename Value>
+size_t MemoCache<SIZE, Value>::Bytes() const
+{
+    size_t bytes = 0;
+
+    for (size_t i = 0; i < mShardCount; i++)
+    {
+        std::shared_lock<std::shared_mutex> lock(mShards[i].mutex);
+
+        bytes += mShards[i].bytes;
+    }
+
+    return bytes;
+}
+
+template <size_t SIZE, typename Value>
+size_t MemoCache<SIZE, Value>::Entries() const
+{
+    size_t entries = 0;
+
+    for (size_t i = 0; i < mShardCount; i++)
+    {
+        std::shared_lock<std::shared_mutex> lock(mShards[i].mutex);
+
+        entries += mShards[i].clock.size();
+    }
+
+    return entries;
+}
+
+#endif  // MEMO_CACHE_H
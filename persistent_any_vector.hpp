@@ -0,0 +1,375 @@
+#ifndef PERSISTENT_ANY_VECTOR_H
+#define PERSISTENT_ANY_VECTOR_H
+
+#include "any.hpp"
+#include <atomic>
+#include <cstdint>
+
+/*
+ * Immutable vector of Any with structural sharing: a radix balanced tree of 32-way nodes plus
+ * a tail leaf for appends. Copies (snapshots) are O(1), updates copy only the path from the root
+ * to a leaf and return a new vector. Nodes and elements are reference counted, so versions
+ * share the unchanged nodes and every Any payload is stored once whatever the number of versions.
+ * Versions can be read and updated concurrently, they are never modified.
+ */
+template <size_t SIZE>
+class PersistentAnyVector
+{
+public:
+    PersistentAnyVector() : mSize(0), mShift(BITS), mRoot(nullptr), mTail(nullptr) {}
+
+    PersistentAnyVector(const PersistentAnyVector &other) :
+        mSize(other.mSize), mShift(other.mShift), mRoot(Acquire(other.mRoot)), mTail(Acquire(other.mTail))
+    {
+    }
+
+    PersistentAnyVector(PersistentAnyVector &&other) : mSize(other.mSize), mShift(other.mShift), mRoot(other.mRoot), mTail(other.mTail)
+    {
+        other.mSize = 0;
+        other.mShift = BITS;
+        other.mRoot = nullptr;
+        other.mTail = nullptr;
+    }
+
+    ~PersistentAnyVector()
+    {
+        Release(mRoot, mShift);
+        Release(mTail, 0);
+    }
+
+    PersistentAnyVector &operator=(PersistentAnyVector other)
+    {
+        std::swap(mSize, other.mSize);
+        std::swap(mShift, other.mShift);
+        std::swap(mRoot, other.mRoot);
+        std::swap(mTail, other.mTail);
+
+        return *this;
+    }
+
+    size_t Size() const { return mSize; }
+    bool Empty() const { return !mSize; }
+
+    const Any<SIZE> &operator[](size_t index) const
+    {
+        return static_cast<const Element*>(LeafFor(index)->slots[index & MASK])->value;
+    }
+
+    PersistentAnyVector Set(size_t index, Any<SIZE> value) const;
+    PersistentAnyVector PushBack(Any<SIZE> value) const;
+    PersistentAnyVector PopBack() const;
+
+    // f(const Any<SIZE>&) for each element in order, one leaf at a time
+    template <typename F>
+    void ForEach(F f) const;
+
+private:
+    static constexpr unsigned BITS = 5;
+    static constexpr size_t WIDTH = size_t(1) << BITS;
+    static constexpr size_t MASK = WIDTH - 1;
+
+    // slots are child nodes, or elements in leaves (level 0)
+    struct Node
+    {
+        std::atomic<uint32_t> references{ 1 };
+        void *slots[WIDTH] = {};
+    };
+
+    struct Element
+    {
+        explicit Element(Any<SIZE> &&value) : value(std::move(value)) {}
+
+        std::atomic<uint32_t> references{ 1 };
+        Any<SIZE> value;
+    };
+
+    template <typename T>
+    static T *Acquire(T *counted)
+    {
+        if (counted)
+            counted->references.fetch_add(1, std::memory_order_relaxed);
+
+        return counted;
+    }
+
+    static void AcquireSlot(void *slot, unsigned level)
+    {
+        if (level)
+            Acquire(static_cast<Node*>(slot));
+        else
+            Acquire(static_cast<Element*>(slot));
+    }
+
+    static void ReleaseSlot(void *slot, unsigned level)
+    {
+        if (level)
+            Release(static_cast<Node*>(slot), level - BITS);
+        else if (Element *element = static_cast<Element*>(slot))
+        {
+            if (element->references.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                delete element;
+        }
+    }
+
+    // level is the level of the node's slots plus BITS (0 for leaves)
+    static void Release(Node *node, unsigned level)
+    {
+        if (!node || node->references.fetch_sub(1, std::memory_order_acq_rel) != 1)
+            return;
+
+        for (void *slot : node->slots)
+            if (slot)
+                ReleaseSlot(slot, level);
+
+        delete node;
+    }
+
+    // copy sharing the slots (an empty node if node is nullptr)
+    static Node *Copy(const Node *node, unsigned level)
+    {
+        Node *copy = new Node();
+
+        if (node)
+            for (size_t i = 0; i < WIDTH; i++)
+                if ((copy->slots[i] = node->slots[i]))
+                    AcquireSlot(copy->slots[i], level);
+
+        return copy;
+    }
+
+    // replaces a slot of a node that isn't shared yet, taking ownership of value
+    static void Replace(Node *node, size_t index, void *value, unsigned level)
+    {
+        if (node->slots[index])
+            ReleaseSlot(node->slots[index], level);
+
+        node->slots[index] = value;
+    }
+
+    size_t TailOffset() const { return mSize < WIDTH ? 0 : (mSize - 1) & ~MASK; }
+
+    const Node *LeafFor(size_t index) const
+    {
+        if (index >= TailOffset())
+            return mTail;
+
+        const Node *node = mRoot;
+
+        for (unsigned level = mShift; level > 0; level -= BITS)
+            node = static_cast<const Node*>(node->slots[(index >> level) & MASK]);
+
+        return node;
+    }
+
+    Node *SetIn(const Node *node, unsigned level, size_t index, Element *element) const;
+    Node *PushTail(const Node *parent, unsigned level, Node *tail) const;
+    Node *PopTail(const Node *node, unsigned level) const;
+
+    static Node *NewPath(unsigned level, Node *leaf)
+    {
+        if (!level)
+            return leaf;
+
+        Node *node = new Node();
+        node->slots[0] = NewPath(level - BITS, leaf);
+
+        return node;
+    }
+
+    size_t mSize;
+    unsigned mShift;   // level of the root
+    Node *mRoot;       // nullptr while all the elements fit in the tail
+    Node *mTail;
+};
+
+template <size_t SIZE>
+PersistentAnyVector<SIZE> PersistentAnyVector<SIZE>::Set(size_t index, Any<SIZE> value) const
+{
+    PersistentAnyVector result(*this);
+    Element *element = new Element(std::move(value));
+
+    if (index >= TailOffset())
+    {
+        Node *tail = Copy(mTail, 0);
+        Replace(tail, index & MASK, element, 0);
+
+        Release(result.mTail, 0);
+        result.mTail = tail;
+    }
+    else
+    {
+        Node *root = SetIn(mRoot, mShift, index, element);
+
+        Release(result.mRoot, mShift);
+        result.mRoot = root;
+    }
+
+    return result;
+}
+
+template <size_t SIZE>
+typename PersistentAnyVector<SIZE>::Node *PersistentAnyVector<SIZE>::SetIn(const Node *node, unsigned level, size_t index, Element *element) const
+{
+    Node *copy = Copy(node, level);
+
+    if (!level)
+        Replace(copy, index & MASK, element, 0);
+    else
+    {
+        size_t slot = (index >> level) & MASK;
+
+        Replace(copy, slot, SetIn(static_cast<const Node*>(node->slots[slot]), level - BITS, index, element), level);
+    }
+
+    return copy;
+}
+
+template <size_t SIZE>
+PersistentAnyVector<SIZE> PersistentAnyVector<SIZE>::PushBack(Any<SIZE> value) const
+{
+    PersistentAnyVector result(*this);
+    Element *element = new Element(std::move(value));
+
+    if (mSize - TailOffset() < WIDTH)  // room in the tail
+    {
+        Node *tail = Copy(mTail, 0);
+        Replace(tail, mSize - TailOffset(), element, 0);
+
+        Release(result.mTail, 0);
+        result.mTail = tail;
+        result.mSize++;
+
+        return result;
+    }
+
+    // the full tail moves into the tree (shared, not copied)
+    Node *full = Acquire(mTail);
+    Node *root;
+
+    if ((mSize >> BITS) > (size_t(1) << mShift))  // root overflow: grow a level
+    {
+        root = new Node();
+        root->slots[0] = Acquire(mRoot);
+        root->slots[1] = NewPath(mShift, full);
+
+        result.mShift = mShift + BITS;
+    }
+    else
+        root = PushTail(mRoot, mShift, full);
+
+    Release(result.mRoot, mShift);
+    result.mRoot = root;
+
+    Node *tail = new Node();
+    tail->slots[0] = element;
+
+    Release(result.mTail, 0);
+    result.mTail = tail;
+    result.mSize++;
+
+    return result;
+}
+
+template <size_t SIZE>
+typename PersistentAnyVector<SIZE>::Node *PersistentAnyVector<SIZE>::PushTail(const Node *parent, unsigned level, Node *tail) const
+{
+    Node *copy = Copy(parent, level);
+    size_t slot = ((mSize - 1) >> level) & MASK;
+
+    if (level == BITS)
+        Replace(copy, slot, tail, level);
+    else if (const Node *child = parent ? static_cast<const Node*>(parent->slots[slot]) : nullptr)
+        Replace(copy, slot, PushTail(child, level - BITS, tail), level);
+    else
+        Replace(copy, slot, NewPath(level - BITS, tail), level);
+
+    return copy;
+}
+
+template <size_t SIZE>
+PersistentAnyVector<SIZE> PersistentAnyVector<SIZE>::PopBack() const
+{
+    if (mSize <= 1)
+        return PersistentAnyVector();
+
+    PersistentAnyVector result(*this);
+
+    if (mSize - TailOffset() > 1)  // drop from the tail
+    {
+        Node *tail = Copy(mTail, 0);
+        Replace(tail, mSize - TailOffset() - 1, nullptr, 0);
+
+        Release(result.mTail, 0);
+        result.mTail = tail;
+        result.mSize--;
+
+        return result;
+    }
+
+    // the last leaf of the tree becomes the tail
+    Node *tail = Acquire(const_cast<Node*>(LeafFor(mSize - 2)));
+    Node *root = PopTail(mRoot, mShift);
+    unsigned shift = mShift;
+
+    if (root && shift > BITS && !root->slots[1])  // single child: drop a level
+    {
+        Node *child = Acquire(static_cast<Node*>(root->slots[0]));
+
+        Release(root, shift);
+        root = child;
+        shift -= BITS;
+    }
+
+    Release(result.mRoot, mShift);
+    Release(result.mTail, 0);
+
+    result.mRoot = root;
+    result.mShift = shift;
+    result.mTail = tail;
+    result.mSize--;
+
+    return result;
+}
+
+template <size_t SIZE>
+typename PersistentAnyVector<SIZE>::Node *PersistentAnyVector<SIZE>::PopTail(const Node *node, unsigned level) const
+{
+    size_t slot = ((mSize - 2) >> level) & MASK;
+
+    if (level > BITS)
+    {
+        Node *child = PopTail(static_cast<const Node*>(node->slots[slot]), level - BITS);
+
+        if (!child && !slot)
+            return nullptr;
+
+        Node *copy = Copy(node, level);
+        Replace(copy, slot, child, level);
+
+        return copy;
+    }
+
+    if (!slot)
+        return nullptr;
+
+    Node *copy = Copy(node, level);
+    Replace(copy, slot, nullptr, level);
+
+    return copy;
+}
+
+template <size_t SIZE>
+template <typename F>
+void PersistentAnyVector<SIZE>::ForEach(F f) const
+{
+    for (size_t leaf = 0; leaf < mSize; leaf += WIDTH)
+    {
+        const Node *node = LeafFor(leaf);
+        size_t count = mSize - leaf < WIDTH ? mSize - leaf : WIDTH;
+
+        for (size_t i = 0; i < count; i++)
+            f(static_cast<const Element*>(node->slots[i])->value);
+    }
+}
+
+#endif  // PERSISTENT_ANY_VECTOR_H
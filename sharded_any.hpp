@@ -0,0 +1,149 @@
+#ifndef SHARDED_ANY_H
+#define SHARDED_ANY_H
+
+#include "any.hpp"
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * Accumulator split in one cache-line padded Any per shard. Each thread updates its own 
+ * shard (threads are assigned to shards round-robin), so updates don't contend or false share.
+ * Reduce combines the shards on demand with the merge function registered for the stored type.
+ */
+template <size_t SIZE>
+class ShardedAny
+{
+public:
+    explicit ShardedAny(size_t shards = std::thread::hardware_concurrency());
+
+    ShardedAny(const ShardedAny&) = delete;
+    ShardedAny &operator=(const ShardedAny&) = delete;
+
+    // merge(T &into, const T &from), register before concurrent use
+    template <typename T, typename F>
+    void RegisterMerge(F merge);
+
+    // update(T &object) on the calling thread's shard, a default constructed T is stored first if the shard is empty
+    template <typename T, typename F>
+    void Update(F update);
+
+    // combines the shards in shard order, shards of a type without a merge function are skipped
+    Any<SIZE> Reduce() const;
+
+    void Clear();
+
+    size_t Shards() const { return mShardCount; }
+
+private:
+    using Merge = std::function<void(Any<SIZE> &into, const Any<SIZE> &from)>;
+
+    struct alignas(ANY_CACHE_LINE_SIZE) Shard
+    {
+        mutable std::mutex mutex;  // only contended while reducing
+        Any<SIZE> any;
+    };
+
+    Shard &LocalShard();
+    const Merge *FindMerge(AnyType type) const;
+
+    std::unique_ptr<Shard[]> mShards;
+    size_t mShardCount;
+
+    std::vector<std::pair<AnyType, Merge>> mMerges;
+};
+
+template <size_t SIZE>
+ShardedAny<SIZE>::ShardedAny(size_t shards) : mShards(new Shard[shards ? shards : 1]), mShardCount(shards ? shards : 1)
+{
+}
+
+template <size_t SIZE>
+template <typename T, typename F>
+void ShardedAny<SIZE>::RegisterMerge(F merge)
+{
+    Merge typeErased = [merge](Any<SIZE> &into, const Any<SIZE> &from) { merge(into.template Get<T>(), from.template Get<T>()); };
+
+    for (auto &entry : mMerges)
+        if (entry.first == AnyTypeOf<T>())
+        {
+            entry.second = std::move(typeErased);
+
+            return;
+        }
+
+    mMerges.emplace_back(AnyTypeOf<T>(), std::move(typeErased));
+}
+
+template <size_t SIZE>
+template <typename T, typename F>
+void ShardedAny<SIZE>::Update(F update)
+{
+    Shard &shard = LocalShard();
+
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    if (!shard.any.template Is<T>())
+        shard.any = T();
+
+    update(shard.any.template Get<T>());
+}
+
+template <size_t SIZE>
+Any<SIZE> ShardedAny<SIZE>::Reduce() const
+{
+    Any<SIZE> result;
+
+    for (size_t i = 0; i < mShardCount; i++)
+    {
+        std::lock_guard<std::mutex> lock(mShards[i].mutex);
+
+        const Any<SIZE> &shard = mShards[i].any;
+
+        if (!shard)
+            continue;
+
+        if (!result)
+            result.Assign(shard.Type(), shard.Data());   // a deep copy: merging into a copy of a Shared shard would change the shard
+        else if (shard.Type() == result.Type())
+            if (const Merge *merge = FindMerge(shard.Type()))
+                (*merge)(result, shard);
+    }
+
+    return result;
+}
+
+template <size_t SIZE>
+void ShardedAny<SIZE>::Clear()
+{
+    for (size_t i = 0; i < mShardCount; i++)
+    {
+        std::lock_guard<std::mutex> lock(mShards[i].mutex);
+
+        mShards[i].any = Any<SIZE>();
+    }
+}
+
+template <size_t SIZE>
+typename ShardedAny<SIZE>::Shard &ShardedAny<SIZE>::LocalShard()
+{
+    static std::atomic<size_t> nextThread(0);
+    thread_local size_t thread = nextThread.fetch_add(1, std::memory_order_relaxed);
+
+    return mShards[thread % mShardCount];
+}
+
+template <size_t SIZE>
+const typename ShardedAny<SIZE>::Merge *ShardedAny<SIZE>::FindMerge(AnyType type) const
+{
+    for (const auto &entry : mMerges)
+        if (entry.first == type)
+            return &entry.second;
+
+    return nullptr;
+}
+
+#endif  // SHARDED_ANY_H
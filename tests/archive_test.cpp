@@ -0,0 +1,108 @@
+#include "any_archive.hpp"
+#include "check.hpp"
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    struct Point
+    {
+        double x;
+        double y;
+    };
+
+    const AnySerializer &Serializer()
+    {
+        static AnySerializer serializer;
+        static bool registered = false;
+
+        if (!registered)
+        {
+            serializer.Register<int>("int");
+            serializer.Register<Point>("Point");
+            serializer.Register<std::string>("string",
+                [](const std::string &text, std::vector<unsigned char> &out) { out.insert(out.end(), text.begin(), text.end()); },
+                [](const unsigned char *data, size_t size) { return std::optional<std::string>(std::string(reinterpret_cast<const char*>(data), size)); });
+            registered = true;
+        }
+
+        return serializer;
+    }
+
+    void TestSerializer()
+    {
+        std::vector<unsigned char> bytes;
+        AnySerializer::Id id;
+
+        CHECK(Serializer().Write(Any<16>(std::string("text")), bytes, &id));
+        CHECK(id == AnySerializer::NameId("string"));
+        CHECK(!Serializer().Write(Any<16>(1.5), bytes));
+        CHECK(!Serializer().Write(Any<16>(), bytes));
+
+        Any<16> any;
+
+        CHECK(Serializer().Read(id, bytes.data(), bytes.size(), any) == AnyError::None);
+        CHECK(any.Get<std::string>() == "text");
+        CHECK(Serializer().Read(AnySerializer::NameId("unknown"), bytes.data(), bytes.size(), any) == AnyError::BadCast);
+    }
+
+    void TestLazyArchive()
+    {
+        const char *path = "archive_test.bin";
+
+        AnyArchiveWriter writer(Serializer());
+
+        CHECK(writer.Add(Any<16>(7)));
+        CHECK(writer.Add(Any<16>(Point{ 1.5, 2.5 })));
+        CHECK(writer.Add(Any<16>(std::string(100, 'z'))));
+        CHECK(!writer.Add(Any<16>(1.5)));
+        CHECK(writer.Size() == 3);
+        CHECK(writer.Write(path));
+
+        {
+            AnyArchiveReader<16> reader(Serializer());
+
+            CHECK(reader.Open(path));
+            CHECK(reader.Size() == 3);
+            CHECK(reader.TypeId(1) == AnySerializer::NameId("Point"));
+            CHECK(!reader.IsDecoded(2));
+
+            // concurrent first accesses decode the entry once
+            std::vector<std::thread> threads;
+            std::vector<const Any<16>*> results(4);
+
+            for (size_t t = 0; t < results.size(); t++)
+                threads.emplace_back([&, t]() { results[t] = reader.Get(2); });
+
+            for (std::thread &thread : threads)
+                thread.join();
+
+            CHECK(results[0] && results[0]->Get<std::string>().size() == 100);
+            CHECK(results[1] == results[0] && results[3] == results[0]);
+            CHECK(reader.IsDecoded(2) && !reader.IsDecoded(0));
+
+            CHECK(reader.Get(0)->Get<int>() == 7);
+            CHECK(reader.Get(1)->Get<Point>().y == 2.5);
+        }
+
+        const AnySerializer empty;
+        AnyArchiveReader<16> unregistered(empty);
+
+        CHECK(unregistered.Open(path));
+        CHECK(!unregistered.Get(0));
+
+        std::remove(path);
+
+        CHECK(!unregistered.Open(path));
+    }
+}
+
+int main()
+{
+    TestSerializer();
+    TestLazyArchive();
+
+    return CheckResult();
+}
@@ -0,0 +1,80 @@
+#include "any_arena.hpp"
+#include "check.hpp"
+#include <string>
+#include <vector>
+
+namespace
+{
+    struct Payload
+    {
+        long values[8];
+    };
+
+    struct alignas(4096) Page
+    {
+        unsigned char bytes[4096];
+    };
+
+    void TestAllocationAndReuse()
+    {
+        AnyArena arena(AnyArena::HUGE_PAGE_SIZE, false);
+
+        Any<8> a;
+        CHECK(a.EmplaceIn<Payload>(arena, Payload{ { 1, 2, 3 } }) == AnyError::None);
+        CHECK(a.Get<Payload>().values[2] == 3);
+
+        const Payload *first = &a.Get<Payload>();
+
+        a = Any<8>();
+
+        // the freed slot is reused by the next payload of the type
+        Any<8> b;
+        CHECK(b.EmplaceIn<Payload>(arena, Payload{ { 4 } }) == AnyError::None);
+        CHECK(&b.Get<Payload>() == first);
+        CHECK(arena.Reserved() == AnyArena::HUGE_PAGE_SIZE);
+    }
+
+    // over-aligned payloads filling several chunks stay aligned and inside their chunk
+    void TestOverAlignedPayloadsAcrossChunks()
+    {
+        AnyArena arena(AnyArena::HUGE_PAGE_SIZE, false);
+        std::vector<Any<8>> pages(1200);
+
+        for (size_t i = 0; i < pages.size(); i++)
+        {
+            CHECK(pages[i].EmplaceIn<Page>(arena) == AnyError::None);
+            pages[i].Get<Page>().bytes[4095] = static_cast<unsigned char>(i);
+        }
+
+        for (size_t i = 0; i < pages.size(); i++)
+        {
+            CHECK(reinterpret_cast<uintptr_t>(&pages[i].Get<Page>()) % alignof(Page) == 0);
+            CHECK(pages[i].Get<Page>().bytes[4095] == static_cast<unsigned char>(i));
+        }
+
+        CHECK(arena.Reserved() > AnyArena::HUGE_PAGE_SIZE);
+    }
+
+    void TestConstructWithResource()
+    {
+        AnyArena arena;
+
+        Any<8> text;
+        CHECK(text.Construct(AnyTypeOf<std::string>(), [](void *storage) { ::new(storage) std::string(50, 'z'); return true; }, arena) == AnyError::None);
+        CHECK(text.Get<std::string>() == std::string(50, 'z'));
+
+        Any<8> copy = text;   // copies are allocated with operator new
+        text = Any<8>();
+
+        CHECK(copy.Get<std::string>().size() == 50);
+    }
+}
+
+int main()
+{
+    TestAllocationAndReuse();
+    TestOverAlignedPayloadsAcrossChunks();
+    TestConstructWithResource();
+
+    return CheckResult();
+}
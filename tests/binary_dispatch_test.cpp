@@ -0,0 +1,76 @@
+#include "binary_dispatch.hpp"
+#include "check.hpp"
+#include <string>
+
+namespace
+{
+    struct Plus
+    {
+        template <typename L, typename R>
+        auto operator()(const L &lhs, const R &rhs) const { return lhs + rhs; }
+    };
+
+    void TestDirectAndPromoted()
+    {
+        BinaryDispatch<Plus, 16> add;
+
+        add.Register<int, int>();
+        add.Register<double, double>();
+        add.RegisterPromotion<int, double>();
+
+        CHECK(add(Any<16>(2), Any<16>(3)).Get<int>() == 5);
+        CHECK(add(Any<16>(2), Any<16>(0.5)).Get<double>() == 2.5);
+        CHECK(add(Any<16>(0.5), Any<16>(2)).Get<double>() == 2.5);
+
+        CHECK(add.Supports(AnyTypeOf<int>(), AnyTypeOf<double>()));
+        CHECK(!add.Supports(AnyTypeOf<int>(), AnyTypeOf<std::string>()));
+
+        CHECK(!add(Any<16>(2), Any<16>(std::string("x"))));
+        CHECK(!add(Any<16>(), Any<16>(2)));
+    }
+
+    void TestCustomHandler()
+    {
+        BinaryDispatch<Plus, 16> add;
+
+        add.Register<std::string, std::string>();
+        add.Register<std::string, int>([](const void *lhs, const void *rhs)
+        {
+            return Any<16>(*static_cast<const std::string*>(lhs) + std::to_string(*static_cast<const int*>(rhs)));
+        });
+
+        CHECK(add(Any<16>(std::string("a")), Any<16>(std::string("b"))).Get<std::string>() == "ab");
+        CHECK(add(Any<16>(std::string("n")), Any<16>(7)).Get<std::string>() == "n7");
+        CHECK(!add(Any<16>(7), Any<16>(std::string("n"))));
+    }
+
+    // registering more types keeps the cells already registered
+    void TestManyTypes()
+    {
+        BinaryDispatch<Plus, 16> add;
+
+        add.Register<char, char>();
+        add.Register<short, short>();
+        add.Register<int, int>();
+        add.Register<long, long>();
+        add.Register<long long, long long>();
+        add.Register<unsigned, unsigned>();
+        add.Register<unsigned long, unsigned long>();
+        add.Register<float, float>();
+        add.Register<double, double>();
+
+        CHECK(add(Any<16>(short(1)), Any<16>(short(2))).Get<int>() == 3);
+        CHECK(add(Any<16>(4L), Any<16>(5L)).Get<long>() == 9);
+        CHECK(add(Any<16>(1.5f), Any<16>(1.5f)).Get<float>() == 3.0f);
+        CHECK(!add(Any<16>(1.5f), Any<16>(1.5)));
+    }
+}
+
+int main()
+{
+    TestDirectAndPromoted();
+    TestCustomHandler();
+    TestManyTypes();
+
+    return CheckResult();
+}
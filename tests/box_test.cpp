@@ -0,0 +1,182 @@
+#include "any_box.hpp"
+#include "check.hpp"
+#include <array>
+#include <string>
+#include <vector>
+
+namespace
+{
+    struct Large
+    {
+        long values[8];
+    };
+
+    struct Shared
+    {
+        std::string text;
+    };
+
+    // copies throw once the budget is spent, live counts the objects
+    struct Fragile
+    {
+        static int budget;
+        static int live;
+
+        explicit Fragile(int value) : value(value) { live++; }
+
+        Fragile(const Fragile &other) : value(other.value)
+        {
+            if (budget-- <= 0)
+                throw 1;
+
+            live++;
+        }
+
+        ~Fragile() { live--; }
+
+        int value;
+        char padding[40];
+    };
+
+    int Fragile::budget = 0;
+    int Fragile::live = 0;
+
+    struct SmallFragile
+    {
+        explicit SmallFragile(int value) : value(value) {}
+
+        SmallFragile(const SmallFragile &other) : value(other.value)
+        {
+            if (Fragile::budget-- <= 0)
+                throw 1;
+        }
+
+        int value;
+    };
+}
+
+template <>
+struct AnyStoragePolicy<Shared> : std::integral_constant<AnyStorage, AnyStorage::Shared> {};
+
+namespace
+{
+    void TestInline()
+    {
+        const std::array<int, 5> values = { 1, 2, 3, 4, 5 };
+
+        std::vector<Any<16>> boxed = BoxRange<16>(values);
+
+        CHECK(boxed.size() == 5);
+        CHECK(boxed[4].Get<int>() == 5);
+        CHECK(boxed[0].Footprint() == sizeof(Any<16>));
+
+        // the previous contents are replaced
+        const std::string texts[] = { "a", "b" };
+
+        BoxRange(texts, 2, boxed.data());
+        CHECK(boxed[1].Get<std::string>() == "b");
+        CHECK(boxed[2].Get<int>() == 3);
+    }
+
+    // heap payloads live in one block, released with the last of them
+    void TestSharedBlock()
+    {
+        std::vector<Large> values(100);
+
+        for (size_t i = 0; i < values.size(); i++)
+            values[i].values[7] = static_cast<long>(i);
+
+        std::vector<Any<16>> boxed = BoxRange<16>(values);
+
+        AnyHeapResource *block = detail::ResourceOf(&boxed[0].Get<Large>());
+        bool sameBlock = true;
+        bool copied = true;
+
+        for (size_t i = 0; i < boxed.size(); i++)
+        {
+            sameBlock = sameBlock && detail::ResourceOf(&boxed[i].Get<Large>()) == block;
+            copied = copied && boxed[i].Get<Large>().values[7] == static_cast<long>(i);
+        }
+
+        CHECK(sameBlock);
+        CHECK(copied);
+        CHECK(&boxed[1].Get<Large>() > &boxed[0].Get<Large>());
+
+        // copies get their own allocation, the block outlives the erased payloads
+        Any<16> copy = boxed[50];
+        boxed.erase(boxed.begin(), boxed.begin() + 60);
+
+        CHECK(copy.Get<Large>().values[7] == 50);
+        CHECK(boxed[0].Get<Large>().values[7] == 60);
+    }
+
+    void TestSharedPolicy()
+    {
+        const Shared values[] = { { "one" }, { "two" } };
+
+        std::vector<Any<16>> boxed = BoxRange<16>(values, 2);
+        Any<16> copy = boxed[1];
+
+        CHECK(!boxed[0].OwnsObject());
+        CHECK(&copy.Get<Shared>() == &boxed[1].Get<Shared>());
+        CHECK(&boxed[0].Get<Shared>() != &boxed[1].Get<Shared>());
+
+        boxed.clear();
+        CHECK(copy.Get<Shared>().text == "two");
+    }
+
+    void TestRollbackWhenACopyThrows()
+    {
+        const Fragile values[] = { Fragile(1), Fragile(2), Fragile(3), Fragile(4) };
+        std::vector<Any<16>> out(4);
+
+        out[3] = 7;
+
+        Fragile::budget = 2;
+        bool thrown = false;
+
+        try
+        {
+            BoxRange(values, 4, out.data());
+        }
+        catch (int)
+        {
+            thrown = true;
+        }
+
+        CHECK(thrown);
+        CHECK(Fragile::live == 4);
+        CHECK(!out[0] && !out[1] && !out[2] && !out[3]);
+
+        const SmallFragile small[] = { SmallFragile(1), SmallFragile(2), SmallFragile(3) };
+
+        Fragile::budget = 1;
+        thrown = false;
+
+        try
+        {
+            BoxRange(small, 3, out.data());
+        }
+        catch (int)
+        {
+            thrown = true;
+        }
+
+        CHECK(thrown);
+        CHECK(!out[0] && !out[1] && !out[2]);
+
+        Fragile::budget = 100;
+        BoxRange(values, 4, out.data());
+        CHECK(out[3].Get<Fragile>().value == 4);
+    }
+}
+
+int main()
+{
+    TestInline();
+    TestSharedBlock();
+    TestSharedPolicy();
+    TestRollbackWhenACopyThrows();
+
+    return CheckResult();
+}
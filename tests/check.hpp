@@ -0,0 +1,36 @@
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <cstdio>
+#include <cstdlib>
+
+/*
+ * Minimal checks for the standalone tests (they don't depend on assert, so they also run with NDEBUG).
+ * Each test is a single source file built against the repository root, e.g.
+ *   c++ -std=c++17 -pthread -I. tests/frame_test.cpp -o frame_test && ./frame_test
+ */
+#define CHECK(condition) ((condition) ? (void)0 : CheckFailed(#condition, __FILE__, __LINE__))
+
+inline int &CheckFailures()
+{
+    static int failures = 0;
+
+    return failures;
+}
+
+inline void CheckFailed(const char *condition, const char *file, int line)
+{
+    std::fprintf(stderr, "%s:%d: check failed: %s\n", file, line, condition);
+    CheckFailures()++;
+}
+
+// exit code of the test
+inline int CheckResult()
+{
+    if (CheckFailures())
+        std::fprintf(stderr, "%d check(s) failed\n", CheckFailures());
+
+    return CheckFailures() ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+#endif  // CHECK_H
@@ -0,0 +1,173 @@
+#include "any_cold.hpp"
+#include "check.hpp"
+#include <string>
+#include <vector>
+
+namespace
+{
+    struct Document
+    {
+        std::string text;
+    };
+
+    // fails to deserialize while gCorrupt is set, as if its compressed bytes were damaged
+    struct Record
+    {
+        std::string text;
+    };
+
+    bool gCorrupt = false;
+}
+
+template <>
+struct AnyStoragePolicy<Document> : std::integral_constant<AnyStorage, AnyStorage::Shared> {};
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    AnySerializer &Serializer()
+    {
+        static AnySerializer serializer;
+        static bool registered = false;
+
+        if (!registered)
+        {
+            auto write = [](const std::string &text, std::vector<unsigned char> &out) { out.insert(out.end(), text.begin(), text.end()); };
+            auto read = [](const unsigned char *data, size_t size) { return std::optional<std::string>(std::string(reinterpret_cast<const char*>(data), size)); };
+
+            serializer.Register<std::string>("string", write, read);
+            serializer.Register<Document>("Document",
+                [write](const Document &document, std::vector<unsigned char> &out) { write(document.text, out); },
+                [read](const unsigned char *data, size_t size) { return std::optional<Document>(Document{ *read(data, size) }); });
+            serializer.Register<Record>("Record",
+                [write](const Record &record, std::vector<unsigned char> &out) { write(record.text, out); },
+                [read](const unsigned char *data, size_t size) { return gCorrupt ? std::optional<Record>() : std::optional<Record>(Record{ *read(data, size) }); });
+            registered = true;
+        }
+
+        return serializer;
+    }
+
+    std::string Text()
+    {
+        std::string text;
+
+        for (int i = 0; i < 2000; i++)
+            text += "line " + std::to_string(i % 20) + "\n";
+
+        return text;
+    }
+
+    void TestCodecRoundTrip()
+    {
+        const std::string text = Text();
+        const unsigned char *bytes = reinterpret_cast<const unsigned char*>(text.data());
+
+        std::vector<unsigned char> packed;
+        detail::LzCompress(bytes, text.size(), packed);
+
+        std::vector<unsigned char> unpacked(text.size());
+
+        CHECK(packed.size() < text.size() / 4);
+        CHECK(detail::LzDecompress(packed.data(), packed.size(), unpacked.data(), unpacked.size()));
+        CHECK(std::equal(unpacked.begin(), unpacked.end(), bytes));
+        CHECK(!detail::LzDecompress(packed.data(), packed.size() / 2, unpacked.data(), unpacked.size()));
+    }
+
+    void TestIdleEntriesAreCompressed()
+    {
+        AnyColdStore<16> store(std::chrono::seconds(10), 64, Serializer());
+
+        const size_t text = store.Add(Any<16>(Text()));
+        const size_t small = store.Add(Any<16>(3));
+
+        const Clock::time_point now = Clock::now();
+
+        CHECK(store.Sweep(now) == 0);
+        CHECK(store.Sweep(now + std::chrono::seconds(5)) == 0);
+        CHECK(store.Sweep(now + std::chrono::seconds(10)) == 1);
+        CHECK(store.IsCompressed(text));
+        CHECK(!store.IsCompressed(small));
+        CHECK(store.CompressedBytes() > 0);
+
+        CHECK(store.Get<std::string>(text) == Text());
+        CHECK(!store.IsCompressed(text));
+        CHECK(store.CompressedBytes() == 0);
+        CHECK(store.Get<int>(small) == 3);
+    }
+
+    // an access between two sweeps restarts the idle time from the next sweep
+    void TestAccessRestartsIdleTime()
+    {
+        AnyColdStore<16> store(std::chrono::seconds(10), 64, Serializer());
+
+        const size_t text = store.Add(Any<16>(Text()));
+        const Clock::time_point now = Clock::now();
+
+        store.Sweep(now);
+        store.Sweep(now + std::chrono::seconds(9));
+
+        CHECK(store.TryGet<std::string>(text));
+
+        CHECK(store.Sweep(now + std::chrono::seconds(11)) == 0);
+        CHECK(store.Sweep(now + std::chrono::seconds(20)) == 0);
+        CHECK(store.Sweep(now + std::chrono::seconds(21)) == 1);
+    }
+
+    // compressing a shared payload wouldn't free it
+    void TestSharedPayloadsAreSkipped()
+    {
+        AnyColdStore<16> store(std::chrono::seconds(10), 64, Serializer());
+
+        Any<16> document = Document{ Text() };
+        const size_t index = store.Add(document);
+        const Clock::time_point now = Clock::now();
+
+        store.Sweep(now);
+
+        CHECK(store.Sweep(now + std::chrono::seconds(10)) == 0);
+        CHECK(!store.IsCompressed(index));
+    }
+
+    // an entry that can't be decoded stays compressed, a later access can still decode it
+    void TestUndecodableEntriesAreKept()
+    {
+        AnyColdStore<16> store(std::chrono::seconds(10), 64, Serializer());
+
+        const size_t index = store.Add(Any<16>(Record{ Text() }));
+        const Clock::time_point now = Clock::now();
+
+        store.Sweep(now);
+
+        CHECK(store.Sweep(now + std::chrono::seconds(10)) == 1);
+
+        const size_t compressed = store.CompressedBytes();
+
+        gCorrupt = true;
+
+        CHECK(store.TryValue(index).Error() == AnyError::Construction);
+        CHECK(!store.Value(index));
+        CHECK(!store.TryGet<Record>(index));
+        CHECK(store.IsCompressed(index));
+        CHECK(store.CompressedBytes() == compressed);
+
+        gCorrupt = false;
+
+        CHECK(store.TryValue(index).Error() == AnyError::None);
+        CHECK(store.Get<Record>(index).text == Text());
+        CHECK(!store.IsCompressed(index));
+        CHECK(store.CompressedBytes() == 0);
+    }
+}
+
+int main()
+{
+    TestCodecRoundTrip();
+    TestIdleEntriesAreCompressed();
+    TestAccessRestartsIdleTime();
+    TestSharedPayloadsAreSkipped();
+    TestUndecodableEntriesAreKept();
+
+    return CheckResult();
+}
@@ -0,0 +1,92 @@
+#include "any_columns.hpp"
+#include "check.hpp"
+#include <string>
+#include <vector>
+
+namespace
+{
+    struct Pair
+    {
+        int a;
+        int b;
+    };
+
+    std::vector<Any<16>> Rows()
+    {
+        std::vector<Any<16>> rows;
+
+        rows.emplace_back(int32_t(1));
+        rows.emplace_back(2.5);
+        rows.emplace_back(int32_t(3));
+        rows.emplace_back(std::string("not unboxed"));
+        rows.emplace_back();
+        rows.emplace_back(Pair{ 4, 5 });
+
+        return rows;
+    }
+
+    void TestUnboxAndBox()
+    {
+        const std::vector<Any<16>> rows = Rows();
+        const AnyColumns columns = Unbox(rows.begin(), rows.end());
+
+        CHECK(columns.Columns().size() == 3);
+        CHECK(columns.TypeIds()[3] == AnyColumns::NOT_UNBOXED && columns.TypeIds()[4] == AnyColumns::NOT_UNBOXED);
+
+        const AnyColumn *ints = columns.Find<int32_t>();
+
+        CHECK(ints && ints->Length() == rows.size() && ints->NullCount() == 4);
+        CHECK(ints->IsValid(0) && !ints->IsValid(1) && ints->IsValid(2));
+        CHECK(ints->Values<int32_t>()[2] == 3);
+        CHECK(!ints->Values<double>());
+        CHECK(columns.Find<Pair>()->Values<Pair>()[5].b == 5);
+
+        std::vector<Any<16>> boxed(rows.size());
+        Box(columns, boxed.begin());
+
+        CHECK(boxed[0].Get<int32_t>() == 1);
+        CHECK(boxed[1].Get<double>() == 2.5);
+        CHECK(boxed[5].Get<Pair>().a == 4);
+        CHECK(!boxed[3] && !boxed[4]);
+    }
+
+    void TestExportArrow()
+    {
+        const std::vector<Any<16>> rows = Rows();
+        AnyColumns columns = Unbox(rows.begin(), rows.end());
+
+        const AnyColumn *doubles = columns.Find<double>();
+        const void *values = doubles->Values();
+
+        ArrowArray array;
+        ArrowSchema schema;
+
+        ExportArrow(std::move(columns.Columns()[static_cast<size_t>(columns.TypeIds()[1])]), &array, &schema);
+
+        CHECK(std::string(schema.format) == "g");
+        CHECK(array.length == 6 && array.null_count == 5 && array.n_buffers == 2);
+        CHECK(array.buffers[1] == values);   // zero-copy
+        CHECK(static_cast<const double*>(array.buffers[1])[1] == 2.5);
+        CHECK(static_cast<const uint8_t*>(array.buffers[0])[0] == 0x02);
+
+        array.release(&array);
+        schema.release(&schema);
+
+        CHECK(!array.release && !schema.release);
+
+        ExportArrow(std::move(columns.Columns()[static_cast<size_t>(columns.TypeIds()[5])]), &array, &schema);
+
+        CHECK(std::string(schema.format) == "w:8");
+
+        array.release(&array);
+        schema.release(&schema);
+    }
+}
+
+int main()
+{
+    TestUnboxAndBox();
+    TestExportArrow();
+
+    return CheckResult();
+}
@@ -0,0 +1,154 @@
+#include "concurrent_any_map.hpp"
+#include "any_frame.hpp"
+#include "check.hpp"
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace
+{
+    void TestInsertFindErase()
+    {
+        ConcurrentAnyMap<16> map(4, 2);
+
+        CHECK(map.Insert("one", 1));
+        CHECK(map.Emplace<std::string>("two", 3, 'x'));
+        CHECK(!map.Insert("one", 11));
+        CHECK(map.Size() == 2);
+
+        Any<16> value;
+
+        CHECK(map.Find("one", value) && value.Get<int>() == 11);
+        CHECK(map.Contains("two"));
+        CHECK(!map.Find("three", value));
+
+        CHECK(map.Erase("one"));
+        CHECK(!map.Erase("one"));
+        CHECK(!map.Contains("one"));
+        CHECK(map.Size() == 1);
+    }
+
+    // the table grows past its initial buckets
+    void TestGrowth()
+    {
+        ConcurrentAnyMap<16> map(4, 4);
+
+        for (int i = 0; i < 1000; i++)
+            map.Insert(std::to_string(i), i);
+
+        bool found = true;
+
+        for (int i = 0; i < 1000; i++)
+            found = map.Visit(std::to_string(i), [&](const Any<16> &value) { found = found && value.Get<int>() == i; }) && found;
+
+        CHECK(found);
+        CHECK(map.Size() == 1000);
+    }
+
+    struct CountingFrame : FrameScope
+    {
+        void *Allocate(const detail::VTable *type) override
+        {
+            allocations++;
+
+            return FrameScope::Allocate(type);
+        }
+
+        size_t allocations = 0;
+    };
+
+    // the nodes copied by a grow are owned by the map, they outlive the writer's frame
+    void TestGrowthInFrame()
+    {
+        ConcurrentAnyMap<16> map(4, 2);
+
+        for (int i = 0; i < 4; i++)
+            map.Insert(std::to_string(i), std::string(100, static_cast<char>('a' + i)));
+
+        {
+            CountingFrame frame;
+
+            map.Insert("4", 4);   // grows the table
+
+            CHECK(frame.allocations == 0);
+        }
+
+        Any<16> value;
+
+        CHECK(map.Find("0", value) && value.Get<std::string>() == std::string(100, 'a'));
+        CHECK(map.Find("3", value) && value.Get<std::string>() == std::string(100, 'd'));
+        CHECK(map.Find("4", value) && value.Get<int>() == 4);
+    }
+
+    // the visitor gets a read-only view
+    void TestVisitIsConst()
+    {
+        ConcurrentAnyMap<16> map;
+
+        map.Insert("key", std::string("value"));
+
+        CHECK(map.Visit("key", [](auto &value)
+        {
+            static_assert(std::is_const<std::remove_reference_t<decltype(value)>>::value, "Visit must not hand out a mutable value");
+        }));
+    }
+
+    // readers see whole values while writers replace them and reclaim the old nodes
+    void TestConcurrentReplace()
+    {
+        ConcurrentAnyMap<16> map(16, 4);
+
+        for (int i = 0; i < 16; i++)
+            map.Insert(std::to_string(i), std::string(64, 'a'));
+
+        std::atomic<bool> stop{ false };
+        std::atomic<size_t> torn{ 0 };
+        std::vector<std::thread> readers;
+
+        for (int t = 0; t < 4; t++)
+            readers.emplace_back([&]()
+            {
+                while (!stop.load(std::memory_order_relaxed))
+                    for (int i = 0; i < 16; i++)
+                        map.Visit(std::to_string(i), [&](const Any<16> &value)
+                        {
+                            const std::string &text = value.Get<std::string>();
+
+                            if (text.size() != 64 || text.find_first_not_of(text[0]) != std::string::npos)
+                                torn++;
+                        });
+            });
+
+        std::vector<std::thread> writers;
+
+        for (int t = 0; t < 2; t++)
+            writers.emplace_back([&, t]()
+            {
+                for (int n = 0; n < 5000; n++)
+                    map.Insert(std::to_string(n % 16), std::string(64, static_cast<char>('b' + (n + t) % 20)));
+            });
+
+        for (std::thread &writer : writers)
+            writer.join();
+
+        stop = true;
+
+        for (std::thread &reader : readers)
+            reader.join();
+
+        CHECK(torn == 0);
+        CHECK(map.Size() == 16);
+    }
+}
+
+int main()
+{
+    TestInsertFindErase();
+    TestGrowth();
+    TestGrowthInFrame();
+    TestVisitIsConst();
+    TestConcurrentReplace();
+
+    return CheckResult();
+}
@@ -0,0 +1,91 @@
+#include "any.hpp"
+#include "check.hpp"
+#include <string>
+
+/*
+ * C++20 constexpr subset, checked at compile time (build with -std=c++20).
+ */
+namespace
+{
+    struct Point
+    {
+        int x;
+        int y;
+    };
+
+    struct Padded
+    {
+        char c;
+        int i;
+    };
+
+    struct Vector
+    {
+        double x;
+        double y;
+    };
+
+    struct Literal
+    {
+        constexpr Literal(int value) : value(value) {}
+        constexpr Literal(const Literal &other) : value(other.value) {}
+
+        int value;
+    };
+}
+
+template <>
+struct AnyConstexprStorable<Vector> : std::true_type {};
+
+// supported subset
+static_assert(Any<16>::IsConstexprStorable<int>());
+static_assert(Any<16>::IsConstexprStorable<char>());
+static_assert(Any<16>::IsConstexprStorable<bool>());
+static_assert(Any<16>::IsConstexprStorable<double>());
+static_assert(Any<16>::IsConstexprStorable<Point>());
+static_assert(Any<16>::IsConstexprStorable<Vector>());   // specialized
+
+// limits
+static_assert(!Any<16>::IsConstexprStorable<Padded>(), "padding bits");
+static_assert(!Any<16>::IsConstexprStorable<long double>(), "padding bits on x86");
+static_assert(!Any<16>::IsConstexprStorable<const int*>(), "pointers");
+static_assert(!Any<16>::IsConstexprStorable<Literal>(), "not trivially copyable");
+static_assert(!Any<16>::IsConstexprStorable<std::string>());
+static_assert(!Any<4>::IsConstexprStorable<Point>(), "doesn't fit in the small buffer");
+
+#ifdef ANY_CONSTEXPR_ANY
+constexpr Any<16> TABLE[] = { 42, 'c', true, 2.5, Point{ 1, 2 }, Vector{ 3.5, 4.5 } };
+
+static_assert(TABLE[0].Is<int>() && TABLE[0].GetValue<int>() == 42);
+static_assert(TABLE[1].Is<char>() && TABLE[1].GetValue<char>() == 'c');
+static_assert(TABLE[2].GetValue<bool>());
+static_assert(TABLE[3].GetValue<double>() == 2.5);
+static_assert(TABLE[4].GetValue<Point>().y == 2);
+static_assert(TABLE[5].GetValue<Vector>().x == 3.5);
+static_assert(!TABLE[4].Is<Vector>());
+
+constexpr Any<16> COPY = TABLE[4];
+static_assert(COPY.GetValue<Point>().x == 1);
+
+constexpr Any<16> EMPTY;
+static_assert(!EMPTY);
+#endif
+
+int main()
+{
+#ifdef ANY_CONSTEXPR_ANY
+    // the constant-initialized values are usable at run time
+    CHECK(TABLE[0].Get<int>() == 42);
+    CHECK(TABLE[4].Get<Point>().x == 1);
+    CHECK(COPY.Get<Point>().y == 2);
+#endif
+
+    // the types outside of the subset still work at run time
+    Any<16> padded = Padded{ 'a', 7 };
+    Any<16> literal = Literal(5);
+
+    CHECK(padded.Get<Padded>().i == 7);
+    CHECK(literal.Get<Literal>().value == 5);
+
+    return CheckResult();
+}
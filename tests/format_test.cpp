@@ -0,0 +1,99 @@
+#include "any_format.hpp"
+#include "check.hpp"
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <string_view>
+
+namespace
+{
+    struct Point
+    {
+        int x, y;
+    };
+}
+
+template <>
+struct AnyFormatter<Point>
+{
+    static constexpr bool TEXT = false;
+
+    static size_t Format(const Point &point, char *buffer, size_t size)
+    {
+        return detail::FormatText(point.x == point.y ? "diagonal" : "point", point.x == point.y ? 8 : 5, buffer, size);
+    }
+};
+
+namespace
+{
+    std::string Text(const Any<16> &any)
+    {
+        char buffer[64];
+
+        return std::string(buffer, AnyFormat(any, buffer, sizeof(buffer)));
+    }
+
+    void TestNumbers()
+    {
+        CHECK(Text(Any<16>(static_cast<signed char>(-7))) == "-7");
+        CHECK(Text(Any<16>(static_cast<unsigned char>(200))) == "200");
+        CHECK(Text(Any<16>(static_cast<short>(-300))) == "-300");
+        CHECK(Text(Any<16>(42)) == "42");
+        CHECK(Text(Any<16>(42u)) == "42");
+        CHECK(Text(Any<16>(std::numeric_limits<long>::min())) == std::to_string(std::numeric_limits<long>::min()));
+        CHECK(Text(Any<16>(std::numeric_limits<unsigned long long>::max())) == "18446744073709551615");
+        CHECK(Text(Any<16>(0.5f)) == "0.5");
+        CHECK(Text(Any<16>(-1.25)) == "-1.25");
+        CHECK(Text(Any<16>(2.5L)) == "2.5");
+        CHECK(Text(Any<16>(false)) == "false");
+        CHECK(!Any<16>(1).Type()->text);
+    }
+
+    void TestText()
+    {
+        const char *literal = "literal";
+
+        CHECK(Text(Any<16>('x')) == "x");
+        CHECK(Text(Any<16>(literal)) == "literal");
+        CHECK(Text(Any<16>(std::string("string"))) == "string");
+        CHECK(Text(Any<16>(std::string_view("view"))) == "view");
+
+        CHECK(Any<16>('x').Type()->text);
+        CHECK(Any<16>(literal).Type()->text);
+        CHECK(Any<16>(std::string()).Type()->text);
+    }
+
+    void TestFormatters()
+    {
+        CHECK(Text(Any<16>(Point{ 1, 1 })) == "diagonal");
+        CHECK(Text(Any<16>(Point{ 1, 2 })) == "point");
+
+        CHECK(!AnyFormattable(Any<16>()));
+        CHECK(!AnyFormattable(Any<16>(std::u16string(u"x"))));
+        CHECK(Text(Any<16>()).empty());
+    }
+
+    // the full length is returned when the buffer is too small
+    void TestTruncation()
+    {
+        char buffer[4] = { '.', '.', '.', '.' };
+
+        CHECK(AnyFormat(Any<16>(123456), buffer, 3) == 6);
+        CHECK(std::string(buffer, 4) == "123.");
+
+        CHECK(AnyFormat(Any<16>(std::string("abcdef")), buffer, 2) == 6);
+        CHECK(std::string(buffer, 4) == "ab3.");
+
+        CHECK(AnyFormat(Any<16>(0.125), nullptr, 0) == 5);
+    }
+}
+
+int main()
+{
+    TestNumbers();
+    TestText();
+    TestFormatters();
+    TestTruncation();
+
+    return CheckResult();
+}
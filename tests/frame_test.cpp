@@ -0,0 +1,119 @@
+#include "any_frame.hpp"
+#include "check.hpp"
+#include <string>
+#include <vector>
+
+namespace
+{
+    struct Pair
+    {
+        long a;
+        long b;
+    };
+
+    struct alignas(16) Aligned
+    {
+        long values[3];
+    };
+
+    void TestPayloadsComeFromTheFrame()
+    {
+        std::string text(100, 'x');
+
+        FrameScope frame;
+
+        Any<8> a = text;
+        Any<8> copy = a;
+
+        CHECK(a.Get<std::string>() == text);
+        CHECK(copy.Get<std::string>() == text);
+        CHECK(detail::ThreadHeapResource() == &frame);
+    }
+
+    void TestScopesNest()
+    {
+        FrameScope outer;
+
+        {
+            FrameScope inner;
+            CHECK(detail::ThreadHeapResource() == &inner);
+        }
+
+        CHECK(detail::ThreadHeapResource() == &outer);
+    }
+
+    // a chunk end that isn't aligned for the next payload must start a new chunk
+    void TestAlignmentAtTheEndOfAChunk()
+    {
+        FrameScope frame(1000);
+
+        std::vector<Any<8>> pairs;
+        pairs.reserve(64);
+
+        for (int i = 0; i < 41; i++)
+            pairs.emplace_back(Pair{ i, i });
+
+        Any<8> aligned = Aligned{ { 1, 2, 3 } };
+
+        CHECK(reinterpret_cast<uintptr_t>(&aligned.Get<Aligned>()) % alignof(Aligned) == 0);
+        CHECK(aligned.Get<Aligned>().values[2] == 3);
+        CHECK(pairs[40].Get<Pair>().b == 40);
+    }
+
+    // stands for a frame that can't get more memory
+    struct ExhaustedResource : AnyHeapResource
+    {
+        void Deallocate(void *, const detail::VTable *) override {}
+    };
+
+    void TestAllocationFailureIsReported()
+    {
+        ExhaustedResource exhausted;
+        AnyHeapResource *previous = detail::ThreadHeapResource();
+
+        detail::ThreadHeapResource() = &exhausted;
+
+        bool thrown = false;
+
+        try
+        {
+            Any<8> a = std::string(100, 'x');
+        }
+        catch (const std::bad_alloc&)
+        {
+            thrown = true;
+        }
+
+        Any<8> b;
+        CHECK(b.TryEmplace<std::string>(100, 'y') == AnyError::OutOfMemory);
+        CHECK(!b);
+
+        detail::ThreadHeapResource() = previous;
+
+        CHECK(thrown);
+    }
+
+    void TestLargePayloadGetsItsOwnChunk()
+    {
+        FrameScope frame(64);
+
+        Any<8> large = std::vector<char>(10000, 'y');
+        Any<8> aligned = Aligned{ { 4, 5, 6 } };
+
+        CHECK(large.Get<std::vector<char>>().size() == 10000);
+        CHECK(aligned.Get<Aligned>().values[0] == 4);
+    }
+}
+
+int main()
+{
+    TestPayloadsComeFromTheFrame();
+    TestScopesNest();
+    TestAlignmentAtTheEndOfAChunk();
+    TestLargePayloadGetsItsOwnChunk();
+    TestAllocationFailureIsReported();
+
+    CHECK(detail::ThreadHeapResource() == nullptr);
+
+    return CheckResult();
+}
@@ -0,0 +1,93 @@
+#include "any_json.hpp"
+#include "check.hpp"
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace
+{
+    struct Level
+    {
+        int value;
+    };
+
+    struct Opaque
+    {
+        int value;
+    };
+}
+
+template <>
+struct AnyFormatter<Level>
+{
+    static constexpr bool TEXT = true;
+
+    static size_t Format(const Level &level, char *buffer, size_t size)
+    {
+        return level.value > 2 ? detail::FormatText("error", 5, buffer, size) : detail::FormatText("info", 4, buffer, size);
+    }
+};
+
+namespace
+{
+    std::string Encode(const Any<16> &any)
+    {
+        AnyJsonWriter writer;
+
+        writer.Value(any);
+
+        return writer.Text();
+    }
+
+    void TestValues()
+    {
+        CHECK(Encode(Any<16>(42)) == "42");
+        CHECK(Encode(Any<16>(-1.5)) == "-1.5");
+        CHECK(Encode(Any<16>(true)) == "true");
+        CHECK(Encode(Any<16>('c')) == "\"c\"");
+        CHECK(Encode(Any<16>(std::string("a \"quoted\"\n\\ \x01"))) == "\"a \\\"quoted\\\"\\n\\\\ \\u0001\"");
+        CHECK(Encode(Any<16>(Level{ 3 })) == "\"error\"");
+        CHECK(Encode(Any<16>(Opaque{ 1 })) == "null");
+        CHECK(Encode(Any<16>()) == "null");
+
+        // not valid JSON numbers
+        CHECK(Encode(Any<16>(std::numeric_limits<double>::quiet_NaN())) == "null");
+        CHECK(Encode(Any<16>(-std::numeric_limits<double>::infinity())) == "null");
+    }
+
+    // values longer than the initial format buffer
+    void TestLongText()
+    {
+        const std::string text(1000, 'x');
+
+        CHECK(Encode(Any<16>(text)) == "\"" + text + "\"");
+    }
+
+    void TestRecordsAndLines()
+    {
+        AnyJsonWriter writer;
+
+        const char *names[] = { "id", "level", "message" };
+        const Any<16> values[] = { 7, Level{ 1 }, std::string("started") };
+
+        writer.Record(names, values, 3);
+
+        CHECK(writer.Text() == "{\"id\":7,\"level\":\"info\",\"message\":\"started\"}\n");
+
+        writer.Clear();
+
+        const std::vector<Any<16>> lines = { 1, 2.5, std::string("three") };
+        writer.Lines(lines.begin(), lines.end());
+
+        CHECK(writer.Text() == "1\n2.5\n\"three\"\n");
+    }
+}
+
+int main()
+{
+    TestValues();
+    TestLongText();
+    TestRecordsAndLines();
+
+    return CheckResult();
+}
@@ -0,0 +1,218 @@
+#include "memo_cache.hpp"
+#include "check.hpp"
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    struct Point
+    {
+        int x;
+        int y;
+
+        bool operator==(const Point &other) const { return x == other.x && y == other.y; }
+    };
+
+    // has std::hash and operator== but doesn't opt in
+    struct Name
+    {
+        std::string text;
+
+        bool operator==(const Name &other) const { return text == other.text; }
+    };
+
+    // copies of its Any share the object
+    struct Label
+    {
+        std::string text;
+
+        bool operator==(const Label &other) const { return text == other.text; }
+    };
+}
+
+template <>
+struct std::hash<Point>
+{
+    size_t operator()(const Point &point) const { return std::hash<int>()(point.x) * 31 + std::hash<int>()(point.y); }
+};
+
+template <>
+struct std::hash<Name>
+{
+    size_t operator()(const Name &name) const { return std::hash<std::string>()(name.text); }
+};
+
+template <>
+struct std::hash<Label>
+{
+    size_t operator()(const Label &label) const { return std::hash<std::string>()(label.text); }
+};
+
+template <>
+struct AnyHashable<Point> : std::true_type {};
+
+template <>
+struct AnyHashable<Label> : std::true_type {};
+
+template <>
+struct AnyStoragePolicy<Label> : std::integral_constant<AnyStorage, AnyStorage::Shared> {};
+
+namespace
+{
+    void TestHashingIsOptIn()
+    {
+        CHECK(Any<16>(1).Hashable());
+        CHECK(Any<16>(std::string("key")).Hashable());
+        CHECK(Any<16>(Point{ 1, 2 }).Hashable());
+        CHECK(!Any<16>(Name{ "name" }).Hashable());
+        CHECK(!AnyTypeOf<Name>()->hash && !AnyTypeOf<Name>()->equal);
+
+        CHECK(Any<16>(Point{ 1, 2 }).Equals(Any<16>(Point{ 1, 2 })));
+        CHECK(!Any<16>(Point{ 1, 2 }).Equals(Any<16>(Point{ 2, 1 })));
+        CHECK(!Any<16>(1).Equals(Any<16>(1L)));
+        CHECK(Any<16>().Equals(Any<16>()));
+    }
+
+    // equal values hash equal with the built-in hashes
+    void TestBuiltinHashes()
+    {
+        enum class Color { Red, Green };
+
+        const char *text = "text";
+
+        CHECK(Any<16>(0.0).Hash() == Any<16>(-0.0).Hash());
+        CHECK(Any<16>(0.0).Equals(Any<16>(-0.0)));
+        CHECK(Any<16>(0.0f).Hash() == Any<16>(-0.0f).Hash());
+        CHECK(Any<16>(1.5L).Hash() == Any<16>(1.5L).Hash());
+        CHECK(Any<16>(1.5).Hash() != Any<16>(2.5).Hash());
+        CHECK(Any<16>(7).Hash() != Any<16>(8).Hash());
+        CHECK(Any<16>(Color::Green).Hash() == Any<16>(Color::Green).Hash());
+        CHECK(Any<16>(Color::Green).Hash() != Any<16>(Color::Red).Hash());
+        CHECK(Any<16>(text).Hash() == Any<16>(text).Hash());
+
+        const std::string a(100, 'a');
+        const std::string b = a;
+
+        CHECK(Any<16>(a).Hash() == Any<16>(b).Hash());
+        CHECK(Any<16>(a).Hash() != Any<16>(a + "b").Hash());
+        CHECK(Any<16>(std::string_view(a)).Hash() == Any<16>(std::string_view(b)).Hash());
+        CHECK(Any<16>(std::string_view(a)).Equals(Any<16>(std::string_view(b))));
+    }
+
+    void TestFindInsert()
+    {
+        MemoCache<16> cache(1 << 20, 4);
+
+        const Any<16> keys[] = { 1, std::string("two"), Point{ 3, 4 } };
+        Any<16> value;
+
+        CHECK(!cache.Find(keys, 3, value));
+        CHECK(cache.Insert(keys, 3, Any<16>(2.5)));
+        CHECK(cache.Find(keys, 3, value) && value.Get<double>() == 2.5);
+        CHECK(cache.Entries() == 1);
+
+        const Any<16> other[] = { 1, std::string("two"), Point{ 4, 3 } };
+
+        CHECK(!cache.Find(other, 3, value));
+        CHECK(!cache.Find(keys, 2, value));
+
+        const Any<16> unhashable[] = { Name{ "name" } };
+
+        CHECK(!cache.Insert(unhashable, 1, Any<16>(0)));
+
+        int computed = 0;
+        auto compute = [&]() { computed++; return Any<16>(computed); };
+
+        CHECK(cache.GetOrCompute(other, 3, compute).Get<int>() == 1);
+        CHECK(cache.GetOrCompute(other, 3, compute).Get<int>() == 1);
+        CHECK(computed == 1);
+
+        cache.Clear();
+        CHECK(cache.Entries() == 0 && cache.Bytes() == 0);
+    }
+
+    // the cache keeps its own copies of keys that don't own their object
+    void TestKeysAreCopied()
+    {
+        MemoCache<16> cache(1 << 20, 1);
+        Any<16> value;
+
+        std::string *text = new std::string("referenced key, long enough to be allocated");
+        const Any<16> referenced = Handle<std::string>(*text);
+
+        CHECK(cache.Insert(&referenced, 1, Any<16>(1)));
+
+        const Any<16> same = *text;
+        delete text;
+
+        CHECK(cache.Find(&same, 1, value) && value.Get<int>() == 1);
+
+        Any<16> shared = Label{ "original" };
+        const Any<16> alias = shared;
+
+        CHECK(cache.Insert(&alias, 1, Any<16>(2)));
+
+        shared.Get<Label>().text = "changed";
+
+        const Any<16> original = Label{ "original" };
+
+        CHECK(cache.Find(&original, 1, value) && value.Get<int>() == 2);
+        CHECK(!cache.Find(&shared, 1, value));
+    }
+
+    void TestEviction()
+    {
+        MemoCache<16, int> cache(64 * 1024, 1);
+
+        for (int i = 0; i < 10000; i++)
+        {
+            const Any<16> key = i;
+
+            cache.Insert(&key, 1, i);
+        }
+
+        CHECK(cache.Bytes() <= 64 * 1024);
+        CHECK(cache.Entries() < 10000);
+
+        const Any<16> last = 9999;
+        int value = 0;
+
+        CHECK(cache.Find(&last, 1, value) && value == 9999);
+    }
+
+    void TestConcurrentLookups()
+    {
+        MemoCache<16, int> cache(1 << 20);
+        std::vector<std::thread> threads;
+
+        for (int t = 0; t < 4; t++)
+            threads.emplace_back([&]()
+            {
+                for (int i = 0; i < 2000; i++)
+                {
+                    const Any<16> key = i % 100;
+
+                    cache.GetOrCompute(&key, 1, [&]() { return i % 100; });
+                }
+            });
+
+        for (std::thread &thread : threads)
+            thread.join();
+
+        CHECK(cache.Entries() == 100);
+    }
+}
+
+int main()
+{
+    TestHashingIsOptIn();
+    TestBuiltinHashes();
+    TestFindInsert();
+    TestKeysAreCopied();
+    TestEviction();
+    TestConcurrentLookups();
+
+    return CheckResult();
+}
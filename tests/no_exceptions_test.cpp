@@ -0,0 +1,139 @@
+// built with -fno-exceptions, e.g.
+//   c++ -std=c++17 -fno-exceptions -pthread -I. tests/no_exceptions_test.cpp -o no_exceptions_test
+#include "any.hpp"
+#include "check.hpp"
+#include <cstdlib>
+#include <string>
+
+#ifndef ANY_NO_EXCEPTIONS
+#error "build this test with -fno-exceptions"
+#endif
+
+namespace
+{
+    // makes heap payload allocations (nothrow new in this mode) fail
+    bool gOutOfMemory = false;
+}
+
+void *operator new(size_t size)
+{
+    if (void *memory = std::malloc(size ? size : 1))
+        return memory;
+
+    std::abort();
+}
+
+void *operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    return gOutOfMemory ? nullptr : std::malloc(size ? size : 1);
+}
+
+void operator delete(void *memory) noexcept { std::free(memory); }
+void operator delete(void *memory, size_t) noexcept { std::free(memory); }
+
+namespace
+{
+    struct Payload
+    {
+        long values[8];
+    };
+
+    struct ExhaustedResource : AnyHeapResource
+    {
+        void Deallocate(void *, const detail::VTable *) override {}
+    };
+
+    void TestGetExpected()
+    {
+        Any<8> any = 42;
+        const Any<8> &constAny = any;
+
+        CHECK(any.GetExpected<int>().Error() == AnyError::None);
+        CHECK(*any.GetExpected<int>() == 42);
+        CHECK(constAny.GetExpected<int>().Error() == AnyError::None);
+
+        CHECK(!any.GetExpected<double>());
+        CHECK(any.GetExpected<double>().Error() == AnyError::BadCast);
+        CHECK(constAny.GetExpected<std::string>().Error() == AnyError::BadCast);
+
+        Any<8> empty;
+
+        CHECK(!empty.GetExpected<int>());
+        CHECK(empty.GetExpected<int>().Error() == AnyError::Empty);
+    }
+
+    void TestTryEmplace()
+    {
+        Any<8> any;
+
+        CHECK(any.TryEmplace<Payload>(Payload{ { 1 } }) == AnyError::None);
+        CHECK(any.GetExpected<Payload>()->values[0] == 1);
+
+        // replaced by a different type
+        CHECK(any.TryEmplace<int>(7) == AnyError::None);
+        CHECK(any.GetExpected<Payload>().Error() == AnyError::BadCast);
+        CHECK(*any.GetExpected<int>() == 7);
+
+        gOutOfMemory = true;
+
+        Any<8> failed = 1;
+
+        CHECK(failed.TryEmplace<Payload>() == AnyError::OutOfMemory);
+        CHECK(*failed.GetExpected<int>() == 1);  // unchanged
+
+        CHECK(failed.TryEmplace<int>(2) == AnyError::None);  // inline, doesn't allocate
+        CHECK(*failed.GetExpected<int>() == 2);
+
+        gOutOfMemory = false;
+    }
+
+    void TestTryAssign()
+    {
+        const Any<8> payload = Payload{ { 3 } };
+        const Any<8> empty;
+
+        Any<8> any = 1;
+
+        CHECK(any.TryAssign(payload) == AnyError::None);
+        CHECK(any.GetExpected<Payload>()->values[0] == 3);
+        CHECK(any.GetExpected<int>().Error() == AnyError::BadCast);
+
+        CHECK(any.TryAssign(empty) == AnyError::None);
+        CHECK(!any);
+        CHECK(any.GetExpected<Payload>().Error() == AnyError::Empty);
+
+        any = 5;
+        gOutOfMemory = true;
+
+        CHECK(any.TryAssign(payload) == AnyError::OutOfMemory);
+        CHECK(*any.GetExpected<int>() == 5);  // unchanged
+
+        gOutOfMemory = false;
+    }
+
+    // the thread's resource (frame, pool) reports running out of memory without aborting
+    void TestExhaustedResource()
+    {
+        ExhaustedResource exhausted;
+        AnyHeapResource *previous = detail::ThreadHeapResource();
+
+        detail::ThreadHeapResource() = &exhausted;
+
+        Any<8> any = 1;
+
+        CHECK(any.TryEmplace<Payload>() == AnyError::OutOfMemory);
+        CHECK(*any.GetExpected<int>() == 1);
+
+        detail::ThreadHeapResource() = previous;
+    }
+}
+
+int main()
+{
+    TestGetExpected();
+    TestTryEmplace();
+    TestTryAssign();
+    TestExhaustedResource();
+
+    return CheckResult();
+}
@@ -0,0 +1,104 @@
+#include "any_parallel.hpp"
+#include "check.hpp"
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace
+{
+    std::vector<Any<16>> Values(size_t count)
+    {
+        std::vector<Any<16>> values;
+
+        for (size_t i = 0; i < count; i++)
+        {
+            if (i % 3 == 0)
+                values.emplace_back(static_cast<int>(i));
+            else if (i % 3 == 1)
+                values.emplace_back(static_cast<double>(i));
+            else
+                values.emplace_back(std::string("skipped"));
+        }
+
+        return values;
+    }
+
+    void TestTransformFilterReduce()
+    {
+        AnyThreadPool pool(4);
+        AnyParallelOptions options;
+        options.pool = &pool;
+        options.chunkSize = 100;
+
+        const std::vector<Any<16>> values = Values(10000);
+
+        std::vector<double> doubled(values.size(), -1);
+        ParallelTransform(AnyTypeList<int, double>(), values.begin(), values.end(), doubled.begin(), [](auto x) { return 2.0 * x; }, options);
+
+        CHECK(doubled[3] == 6 && doubled[4] == 8 && doubled[5] == -1);
+
+        std::vector<size_t> odd = ParallelFilter(AnyTypeList<int>(), values.begin(), values.end(), [](int x) { return x % 2 != 0; }, options);
+
+        CHECK(odd.size() == 1667 && odd[0] == 3 && odd[1] == 9);
+
+        const double sum = ParallelReduce(AnyTypeList<int, double>(), values.begin(), values.end(), 0.0,
+            [](double total, auto x) { return total + x; }, [](double a, double b) { return a + b; }, options);
+
+        double expected = 0;
+
+        for (size_t i = 0; i < values.size(); i++)
+            if (i % 3 != 2)
+                expected += static_cast<double>(i);
+
+        CHECK(sum == expected);
+    }
+
+    // exceptions thrown on the calling thread or on a worker reach the caller of Run
+    void TestExceptions()
+    {
+        AnyThreadPool pool(4);
+
+        for (int round = 0; round < 20; round++)
+        {
+            // the threads that don't throw are slowed down so that the throwing one gets tasks
+            const bool callerThrows = round % 2 == 0;
+            std::atomic<size_t> ran{ 0 };
+            bool thrown = false;
+
+            try
+            {
+                pool.Run(200, [&](size_t, size_t thread)
+                {
+                    ran++;
+
+                    if (callerThrows == (thread == 0))
+                        throw std::runtime_error("task");
+
+                    std::this_thread::sleep_for(std::chrono::microseconds(50));
+                });
+            }
+            catch (const std::runtime_error &)
+            {
+                thrown = true;
+            }
+
+            CHECK(thrown);
+            CHECK(ran < 200);   // the tasks not started are skipped
+        }
+
+        std::atomic<size_t> ran{ 0 };
+
+        pool.Run(100, [&](size_t, size_t) { ran++; });
+
+        CHECK(ran == 100);
+    }
+}
+
+int main()
+{
+    TestTransformFilterReduce();
+    TestExceptions();
+
+    return CheckResult();
+}
@@ -0,0 +1,135 @@
+#include "persistent_any_vector.hpp"
+#include "check.hpp"
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    using Vector = PersistentAnyVector<16>;
+
+    // enough elements for the tail, a full root and a second level
+    constexpr int COUNT = 32 * 32 + 100;
+
+    Vector Fill(int count)
+    {
+        Vector vector;
+
+        for (int i = 0; i < count; i++)
+            vector = vector.PushBack(Any<16>(i));
+
+        return vector;
+    }
+
+    void TestPushBackAndIndex()
+    {
+        Vector vector = Fill(COUNT);
+
+        CHECK(vector.Size() == COUNT);
+
+        bool ordered = true;
+
+        for (int i = 0; i < COUNT; i++)
+            ordered = ordered && vector[i].Get<int>() == i;
+
+        CHECK(ordered);
+    }
+
+    void TestSetKeepsTheOldVersion()
+    {
+        const Vector before = Fill(COUNT);
+        const Vector after = before.Set(500, Any<16>(std::string("five hundred"))).Set(COUNT - 1, Any<16>(-1));
+
+        CHECK(before[500].Get<int>() == 500);
+        CHECK(before[COUNT - 1].Get<int>() == COUNT - 1);
+        CHECK(after[500].Get<std::string>() == "five hundred");
+        CHECK(after[COUNT - 1].Get<int>() == -1);
+        CHECK(after[499].Get<int>() == 499);
+        CHECK(after.Size() == before.Size());
+    }
+
+    void TestPopBackToEmpty()
+    {
+        Vector vector = Fill(COUNT);
+        const Vector snapshot = vector;
+
+        bool ordered = true;
+
+        for (int i = COUNT - 1; i >= 0; i--)
+        {
+            ordered = ordered && vector[vector.Size() - 1].Get<int>() == i;
+            vector = vector.PopBack();
+        }
+
+        CHECK(ordered);
+        CHECK(vector.Empty());
+        CHECK(snapshot.Size() == COUNT);
+        CHECK(snapshot[COUNT - 1].Get<int>() == COUNT - 1);
+
+        // the empty vector is usable again
+        vector = vector.PushBack(Any<16>(7));
+        CHECK(vector.Size() == 1 && vector[0].Get<int>() == 7);
+    }
+
+    void TestForEachInOrder()
+    {
+        const Vector vector = Fill(COUNT);
+
+        int expected = 0;
+        bool ordered = true;
+
+        vector.ForEach([&](const Any<16> &value) { ordered = ordered && value.Get<int>() == expected++; });
+
+        CHECK(ordered);
+        CHECK(expected == COUNT);
+    }
+
+    void TestPayloadsAreShared()
+    {
+        const Vector first = Vector().PushBack(Any<16>(std::string(100, 'x')));
+        const Vector second = first.PushBack(Any<16>(1));
+
+        CHECK(&first[0].Get<std::string>() == &second[0].Get<std::string>());
+    }
+
+    // versions are read and derived from other threads while the original is dropped
+    void TestConcurrentSnapshots()
+    {
+        Vector vector = Fill(COUNT);
+        std::vector<std::thread> threads;
+        std::vector<int> results(4, 0);
+
+        for (int t = 0; t < 4; t++)
+        {
+            threads.emplace_back([snapshot = vector, t, &results]
+            {
+                Vector mine = snapshot.Set(t, Any<16>(-t));
+                long sum = 0;
+
+                mine.ForEach([&](const Any<16> &value) { sum += value.Get<int>(); });
+
+                results[t] = mine[t].Get<int>() == -t && snapshot[t].Get<int>() == t && sum == long(COUNT) * (COUNT - 1) / 2 - 2 * t;
+            });
+        }
+
+        vector = Vector();
+
+        for (std::thread &thread : threads)
+            thread.join();
+
+        for (int result : results)
+            CHECK(result == 1);
+    }
+}
+
+int main()
+{
+    TestPushBackAndIndex();
+    TestSetKeepsTheOldVersion();
+    TestPopBackToEmpty();
+    TestForEachInOrder();
+    TestPayloadsAreShared();
+    TestConcurrentSnapshots();
+
+    return CheckResult();
+}
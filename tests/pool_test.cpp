@@ -0,0 +1,210 @@
+#include "any_pool.hpp"
+#include "check.hpp"
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    // makes the pool's slab allocations (nothrow new) fail
+    std::atomic<bool> gOutOfMemory{ false };
+}
+
+void *operator new(size_t size)
+{
+    if (void *memory = std::malloc(size ? size : 1))
+        return memory;
+
+    throw std::bad_alloc();
+}
+
+void *operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    return gOutOfMemory ? nullptr : std::malloc(size ? size : 1);
+}
+
+void operator delete(void *memory) noexcept { std::free(memory); }
+void operator delete(void *memory, size_t) noexcept { std::free(memory); }
+
+namespace
+{
+    struct Payload
+    {
+        long values[8];
+    };
+
+    struct Large
+    {
+        unsigned char bytes[40000];
+    };
+
+    // runs first: the pool of the main thread has no slab yet
+    void TestOutOfMemory()
+    {
+        const Any<8> original = Payload{ { 5 } };   // from operator new, outside the scope
+
+        AnyPoolScope scope;
+
+        gOutOfMemory = true;
+
+        bool constructThrew = false;
+        bool copyThrew = false;
+
+        try
+        {
+            Any<8> a = Payload{ { 1 } };
+        }
+        catch (const std::bad_alloc&)
+        {
+            constructThrew = true;
+        }
+
+        try
+        {
+            Any<8> copy = original;
+        }
+        catch (const std::bad_alloc&)
+        {
+            copyThrew = true;
+        }
+
+        Any<8> b;
+        const AnyError error = b.TryEmplace<Payload>();
+
+        gOutOfMemory = false;
+
+        CHECK(constructThrew);
+        CHECK(copyThrew);
+        CHECK(error == AnyError::OutOfMemory && !b);
+
+        Any<8> c = Payload{ { 2 } };
+        CHECK(c.Get<Payload>().values[0] == 2);
+    }
+
+    void TestReuseInTheOwningThread()
+    {
+        AnyPoolScope scope;
+
+        Any<8> a = Payload{ { 1, 2, 3 } };
+        const Payload *first = &a.Get<Payload>();
+
+        CHECK(detail::ResourceOf(const_cast<Payload*>(first)) == &AnyPool::Thread());
+
+        a = Any<8>();
+
+        Any<8> b = Payload{ { 4 } };
+        CHECK(&b.Get<Payload>() == first);
+        CHECK(b.Get<Payload>().values[0] == 4);
+    }
+
+    // payloads freed by another thread come back to the owner once its free list is empty
+    void TestRemoteFreesAreReused()
+    {
+        AnyPoolScope scope;
+
+        std::vector<Any<8>> produced(100);
+        std::vector<const Payload*> addresses;
+
+        for (size_t i = 0; i < produced.size(); i++)
+        {
+            CHECK(produced[i].EmplaceIn<Payload>(AnyPool::Thread(), Payload{ { long(i) } }) == AnyError::None);
+            addresses.push_back(&produced[i].Get<Payload>());
+        }
+
+        std::thread consumer([moved = std::move(produced)]() mutable { moved.clear(); });
+        consumer.join();
+
+        // the local free list of the class is empty, so the remote list is taken as a whole
+        size_t reused = 0;
+        std::vector<Any<8>> again(100);
+
+        for (Any<8> &any : again)
+        {
+            any = Payload{};
+
+            for (const Payload *address : addresses)
+                reused += &any.Get<Payload>() == address;
+        }
+
+        CHECK(reused == addresses.size());
+    }
+
+    void TestLargePayloadsAreNotPooled()
+    {
+        AnyPoolScope scope;
+
+        Any<8> large = Large{};
+        large.Get<Large>().bytes[39999] = 7;
+
+        CHECK(large.Get<Large>().bytes[39999] == 7);
+
+        // freed from another thread, without going through the remote lists
+        std::thread consumer([&large]() { large = Any<8>(); });
+        consumer.join();
+
+        CHECK(!large);
+    }
+
+    void TestScopesRestoreThePreviousResource()
+    {
+        AnyHeapResource *previous = detail::ThreadHeapResource();
+
+        {
+            AnyPoolScope outer;
+            CHECK(detail::ThreadHeapResource() == &AnyPool::Thread());
+
+            {
+                AnyPoolScope inner;
+            }
+
+            CHECK(detail::ThreadHeapResource() == &AnyPool::Thread());
+        }
+
+        CHECK(detail::ThreadHeapResource() == previous);
+    }
+
+    // the pool of a finished thread is adopted by the next one, payloads outliving the thread stay valid
+    void TestPoolsOfFinishedThreads()
+    {
+        Any<8> survivor;
+        AnyPool *first = nullptr;
+        AnyPool *second = nullptr;
+
+        std::thread producer([&]()
+        {
+            AnyPoolScope scope;
+
+            survivor = Payload{ { 42 } };
+            first = &AnyPool::Thread();
+        });
+        producer.join();
+
+        CHECK(survivor.Get<Payload>().values[0] == 42);
+
+        survivor = Any<8>();
+
+        std::thread next([&]()
+        {
+            AnyPoolScope scope;
+
+            Any<8> local = Payload{ { 43 } };
+            second = &AnyPool::Thread();
+        });
+        next.join();
+
+        CHECK(first == second);
+    }
+}
+
+int main()
+{
+    TestOutOfMemory();
+    TestReuseInTheOwningThread();
+    TestRemoteFreesAreReused();
+    TestLargePayloadsAreNotPooled();
+    TestScopesRestoreThePreviousResource();
+    TestPoolsOfFinishedThreads();
+
+    return CheckResult();
+}
@@ -0,0 +1,85 @@
+#define ANY_PROFILE
+#include "any.hpp"
+#include "check.hpp"
+#include <cstdio>
+#include <string>
+#include <utility>
+
+namespace
+{
+    struct Payload
+    {
+        char bytes[24];
+    };
+
+    const AnyProfileRecord *Find(const std::vector<AnyProfileRecord> &records, size_t anySize, const char *tag, size_t typeSize)
+    {
+        for (const AnyProfileRecord &record : records)
+            if (record.anySize == anySize && record.tag == tag && record.typeSize == typeSize)
+                return &record;
+
+        return nullptr;
+    }
+
+    void TestCounters()
+    {
+        AnyProfile::Reset();
+
+        {
+            AnyProfileTag tag("orders");
+
+            for (int i = 0; i < 100; i++)
+            {
+                Any<8> payload = Payload{};
+                Any<8> copy = payload;
+                Any<8> moved = std::move(copy);
+            }
+
+            Any<8> small = 1;
+        }
+
+        const std::vector<AnyProfileRecord> records = AnyProfile::Snapshot();
+        const AnyProfileRecord *payloads = Find(records, 8, "orders", sizeof(Payload));
+
+        CHECK(payloads && payloads->stores == 100 && payloads->copies == 100 && payloads->moves == 100);
+        CHECK(Find(records, 8, "orders", sizeof(int)));
+        CHECK(!Find(records, 8, "", sizeof(Payload)));
+    }
+
+    void TestDumpLoadAdvise()
+    {
+        const char *path = "profile_test.txt";
+
+        CHECK(AnyProfile::Dump(path));
+
+        std::vector<AnyProfileRecord> records;
+
+        CHECK(AnyProfile::Load(path, records));
+        CHECK(records.size() == AnyProfile::Snapshot().size());
+
+        std::remove(path);
+
+        // the 24 byte payloads are stored and copied often enough to move them in the small buffer
+        const std::vector<AnySizeAdvice> advice = AnySizeAdvisor(records);
+        bool found = false;
+
+        for (const AnySizeAdvice &entry : advice)
+            if (entry.anySize == 8 && entry.tag == "orders")
+            {
+                found = true;
+
+                CHECK(entry.recommended == 24);
+                CHECK(entry.allocations == 200 && entry.recommendedAllocations == 0);
+            }
+
+        CHECK(found);
+    }
+}
+
+int main()
+{
+    TestCounters();
+    TestDumpLoadAdvise();
+
+    return CheckResult();
+}
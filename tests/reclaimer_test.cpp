@@ -0,0 +1,250 @@
+#include "any_reclaimer.hpp"
+#include "check.hpp"
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+namespace
+{
+    std::atomic<bool> gEntered{ false };   // a blocking payload is being destroyed
+    std::atomic<bool> gOpen{ true };       // blocking payloads may finish their destruction
+    std::atomic<int> gDestroyed{ 0 };
+    std::atomic<bool> gOtherThread{ false };
+
+    std::thread::id gMainThread;
+
+    // large payload recording where it's destroyed, optionally blocking its destructor until gOpen
+    // (the tests emplace the payloads, temporaries would count as destroyed)
+    struct Tree
+    {
+        explicit Tree(bool block = false) : block(block) {}
+
+        ~Tree()
+        {
+            if (block)
+            {
+                gEntered = true;
+
+                while (!gOpen)
+                    std::this_thread::yield();
+            }
+
+            gOtherThread = std::this_thread::get_id() != gMainThread;
+            gDestroyed++;
+        }
+
+        bool block;
+        char nodes[8192];
+    };
+
+    struct Leaf
+    {
+        ~Leaf()
+        {
+            gOtherThread = std::this_thread::get_id() != gMainThread;
+            gDestroyed++;
+        }
+
+        long values[4];
+    };
+
+    struct Marked
+    {
+        ~Marked()
+        {
+            gOtherThread = std::this_thread::get_id() != gMainThread;
+            gDestroyed++;
+        }
+
+        long values[4];
+    };
+}
+
+template <>
+struct AnyDeferredDestruction<Marked> : std::true_type {};
+
+namespace
+{
+    void Reset()
+    {
+        gEntered = false;
+        gOpen = true;
+        gDestroyed = 0;
+        gOtherThread = false;
+    }
+
+    void TestLargePayloadsAreDeferred()
+    {
+        Reset();
+
+        AnyReclaimer reclaimer;
+
+        {
+            AnyReclaimerScope scope(reclaimer);
+
+            Any<8> tree;
+            tree.Emplace<Tree>();
+            tree = Any<8>();
+        }
+
+        reclaimer.Flush();
+
+        CHECK(gDestroyed == 1);
+        CHECK(gOtherThread);
+        CHECK(reclaimer.Deferred() == 1);
+        CHECK(reclaimer.Overflowed() == 0);
+    }
+
+    void TestSmallPayloadsAreDestroyedInPlace()
+    {
+        Reset();
+
+        AnyReclaimer reclaimer;
+
+        {
+            AnyReclaimerScope scope(reclaimer);
+
+            Any<8> leaf;
+            leaf.Emplace<Leaf>();
+        }
+
+        CHECK(gDestroyed == 1);
+        CHECK(!gOtherThread);
+        CHECK(reclaimer.Deferred() == 0);
+    }
+
+    void TestMarkedTypesAreDeferred()
+    {
+        Reset();
+
+        AnyReclaimer reclaimer;
+
+        {
+            AnyReclaimerScope scope(reclaimer);
+
+            Any<8> marked;
+            marked.Emplace<Marked>();
+        }
+
+        reclaimer.Flush();
+
+        CHECK(gDestroyed == 1);
+        CHECK(gOtherThread);
+        CHECK(reclaimer.Deferred() == 1);
+    }
+
+    // with the reclaimer stuck on a payload and the queue full, the next payload is destroyed in place
+    void TestOverflowInline()
+    {
+        Reset();
+        gOpen = false;
+
+        AnyReclaimer reclaimer(4096, 1);
+
+        {
+            AnyReclaimerScope scope(reclaimer);
+
+            Any<8> blocking;
+            blocking.Emplace<Tree>(true);
+            blocking = Any<8>();
+
+            while (!gEntered)
+                std::this_thread::yield();
+
+            Any<8> queued;
+            queued.Emplace<Tree>();
+            queued = Any<8>();
+
+            Any<8> overflowed;
+            overflowed.Emplace<Tree>();
+            overflowed = Any<8>();
+
+            CHECK(gDestroyed == 1);
+            CHECK(!gOtherThread);
+        }
+
+        gOpen = true;
+        reclaimer.Flush();
+
+        CHECK(gDestroyed == 3);
+        CHECK(reclaimer.Deferred() == 2);
+        CHECK(reclaimer.Overflowed() == 1);
+    }
+
+    // with Overflow::Wait the destruction blocks until the reclaimer makes room
+    void TestOverflowWait()
+    {
+        Reset();
+        gOpen = false;
+
+        AnyReclaimer reclaimer(4096, 1, 1, AnyReclaimer::Overflow::Wait);
+        std::atomic<bool> done{ false };
+
+        std::thread worker([&]()
+        {
+            AnyReclaimerScope scope(reclaimer);
+
+            Any<8> blocking;
+            blocking.Emplace<Tree>(true);
+            blocking = Any<8>();
+
+            while (!gEntered)
+                std::this_thread::yield();
+
+            Any<8> queued;
+            queued.Emplace<Tree>();
+            queued = Any<8>();
+
+            Any<8> waiting;
+            waiting.Emplace<Tree>();
+            waiting = Any<8>();
+
+            done = true;
+        });
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+        CHECK(!done);
+
+        gOpen = true;
+        worker.join();
+        reclaimer.Flush();
+
+        CHECK(gDestroyed == 3);
+        CHECK(reclaimer.Deferred() == 3);
+        CHECK(reclaimer.Overflowed() == 0);
+    }
+
+    // the reclaimer destroys the pending payloads when it's destroyed
+    void TestPendingPayloadsAtDestruction()
+    {
+        Reset();
+
+        {
+            AnyReclaimer reclaimer;
+            AnyReclaimerScope scope(reclaimer);
+
+            for (int i = 0; i < 100; i++)
+            {
+                Any<8> tree;
+                tree.Emplace<Tree>();
+            }
+        }
+
+        CHECK(gDestroyed == 100);
+    }
+}
+
+int main()
+{
+    gMainThread = std::this_thread::get_id();
+
+    TestLargePayloadsAreDeferred();
+    TestSmallPayloadsAreDestroyedInPlace();
+    TestMarkedTypesAreDeferred();
+    TestOverflowInline();
+    TestOverflowWait();
+    TestPendingPayloadsAtDestruction();
+
+    return CheckResult();
+}
@@ -0,0 +1,138 @@
+#define ANY_SAMPLE
+#define ANY_SAMPLE_RATE 16
+#include "any.hpp"
+#include "check.hpp"
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    struct Payload
+    {
+        std::string text;
+        long value;
+    };
+
+    uint64_t Samples(AnyType type, size_t anySize, AnySampleOp op)
+    {
+        uint64_t samples = 0;
+
+        for (const AnySampleHistogram &histogram : AnySampler::Snapshot())
+            if (histogram.type == type && histogram.anySize == anySize && histogram.op == op)
+                samples += histogram.samples;
+
+        return samples;
+    }
+
+    void TestBuckets()
+    {
+        bool roundTrip = true;
+        bool ordered = true;
+
+        for (size_t bucket = 0; bucket < 200; bucket++)
+        {
+            roundTrip = roundTrip && AnySampleHistogram::Bucket(AnySampleHistogram::BucketValue(bucket)) == bucket;
+            ordered = ordered && AnySampleHistogram::BucketValue(bucket) < AnySampleHistogram::BucketValue(bucket + 1);
+        }
+
+        CHECK(roundTrip);
+        CHECK(ordered);
+        CHECK(AnySampleHistogram::Bucket(3) == 3);
+        CHECK(AnySampleHistogram::Bucket(UINT64_MAX) < AnySampleHistogram::BUCKETS);
+
+        // relative error of the lower bound under 25%
+        CHECK(AnySampleHistogram::BucketValue(AnySampleHistogram::Bucket(1000)) > 750);
+    }
+
+    void TestPercentiles()
+    {
+        AnySampleHistogram histogram;
+
+        for (uint64_t cycles = 1; cycles <= 100; cycles++)
+            histogram.Add(cycles);
+
+        CHECK(histogram.samples == 100);
+        CHECK(histogram.max == 100);
+        CHECK(histogram.Mean() == 50.5);
+        CHECK(histogram.Percentile(0) == 1);
+        CHECK(histogram.Percentile(0.5) >= 40 && histogram.Percentile(0.5) <= 51);
+        CHECK(histogram.Percentile(0.99) >= 75 && histogram.Percentile(0.99) <= 100);
+
+        AnySampleHistogram other;
+        other.Add(1000);
+        histogram.Merge(other);
+
+        CHECK(histogram.samples == 101);
+        CHECK(histogram.max == 1000);
+        CHECK(histogram.Percentile(1) == 1000);
+    }
+
+    // about one operation in ANY_SAMPLE_RATE is sampled, with a jittered interval
+    void TestOperationsAreSampled()
+    {
+        AnySampler::Reset();
+
+        constexpr int COUNT = 20000;
+
+        Any<64> original = Payload{ std::string(40, 'x'), 1 };
+
+        for (int i = 0; i < COUNT; i++)
+        {
+            Any<64> copy = original;
+            Any<64> moved = std::move(copy);
+        }
+
+        const uint64_t copies = Samples(AnyTypeOf<Payload>(), 64, AnySampleOp::Copy);
+        const uint64_t moves = Samples(AnyTypeOf<Payload>(), 64, AnySampleOp::Move);
+        const uint64_t destroys = Samples(AnyTypeOf<Payload>(), 64, AnySampleOp::Destroy);
+
+        // copy, move and destruction of the moved value per iteration
+        const uint64_t total = copies + moves + destroys;
+
+        CHECK(copies > 0 && moves > 0 && destroys > 0);
+        CHECK(total > 3 * COUNT / ANY_SAMPLE_RATE / 2 && total < 3 * COUNT / ANY_SAMPLE_RATE * 2);
+        CHECK(Samples(AnyTypeOf<Payload>(), 32, AnySampleOp::Copy) == 0);
+
+        AnySampler::Reset();
+        CHECK(Samples(AnyTypeOf<Payload>(), 64, AnySampleOp::Copy) == 0);
+    }
+
+    // samples of finished threads are kept and merged
+    void TestThreadsAreMerged()
+    {
+        AnySampler::Reset();
+
+        constexpr int COUNT = 4000;
+
+        std::vector<std::thread> threads;
+
+        for (int t = 0; t < 4; t++)
+        {
+            threads.emplace_back([]
+            {
+                Any<16> original = std::string(100, 'y');
+
+                for (int i = 0; i < COUNT; i++)
+                    Any<16> copy = original;
+            });
+        }
+
+        for (std::thread &thread : threads)
+            thread.join();
+
+        const uint64_t copies = Samples(AnyTypeOf<std::string>(), 16, AnySampleOp::Copy);
+
+        CHECK(copies > 4 * COUNT / ANY_SAMPLE_RATE / 2 / 2);
+    }
+}
+
+int main()
+{
+    TestBuckets();
+    TestPercentiles();
+    TestOperationsAreSampled();
+    TestThreadsAreMerged();
+
+    return CheckResult();
+}
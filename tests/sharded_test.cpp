@@ -0,0 +1,92 @@
+#include "sharded_any.hpp"
+#include "check.hpp"
+#include <thread>
+#include <vector>
+
+namespace
+{
+    struct Stats
+    {
+        long count = 0;
+        long sum = 0;
+    };
+
+    struct Tally
+    {
+        long count = 0;
+    };
+}
+
+template <>
+struct AnyStoragePolicy<Tally> : std::integral_constant<AnyStorage, AnyStorage::Shared> {};
+
+namespace
+{
+    void TestConcurrentUpdates()
+    {
+        ShardedAny<16> accumulator(4);
+
+        accumulator.RegisterMerge<Stats>([](Stats &into, const Stats &from)
+        {
+            into.count += from.count;
+            into.sum += from.sum;
+        });
+
+        std::vector<std::thread> threads;
+
+        for (int t = 0; t < 8; t++)
+            threads.emplace_back([&]()
+            {
+                for (long i = 1; i <= 1000; i++)
+                    accumulator.Update<Stats>([&](Stats &stats) { stats.count++; stats.sum += i; });
+            });
+
+        for (std::thread &thread : threads)
+            thread.join();
+
+        const Any<16> total = accumulator.Reduce();
+
+        CHECK(total.Get<Stats>().count == 8000);
+        CHECK(total.Get<Stats>().sum == 8 * 500500);
+    }
+
+    void TestReduceWithoutMerge()
+    {
+        ShardedAny<16> accumulator(2);
+
+        CHECK(!accumulator.Reduce());
+
+        accumulator.Update<int>([](int &value) { value = 5; });
+
+        CHECK(accumulator.Reduce().Get<int>() == 5);
+
+        accumulator.Clear();
+
+        CHECK(!accumulator.Reduce());
+        CHECK(accumulator.Shards() == 2);
+    }
+
+    // the result doesn't share the object of the first shard, merging into it leaves the shard alone
+    void TestReduceDoesntChangeSharedShards()
+    {
+        ShardedAny<16> accumulator(4);
+
+        accumulator.RegisterMerge<Tally>([](Tally &into, const Tally &from) { into.count += from.count; });
+
+        // four consecutive threads get the four shards
+        for (int t = 0; t < 4; t++)
+            std::thread([&]() { accumulator.Update<Tally>([](Tally &tally) { tally.count++; }); }).join();
+
+        CHECK(accumulator.Reduce().Get<Tally>().count == 4);
+        CHECK(accumulator.Reduce().Get<Tally>().count == 4);
+    }
+}
+
+int main()
+{
+    TestConcurrentUpdates();
+    TestReduceWithoutMerge();
+    TestReduceDoesntChangeSharedShards();
+
+    return CheckResult();
+}
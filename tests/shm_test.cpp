@@ -0,0 +1,310 @@
+#include "any_shm.hpp"
+#include "check.hpp"
+#include <string>
+
+#if defined(ANY_SHM)
+#include <fcntl.h>
+#include <sys/mman.h>
+#endif
+
+#if defined(__linux__)
+#include <csignal>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+#endif
+
+namespace
+{
+    struct Point
+    {
+        int x;
+        int y;
+    };
+
+    const AnySerializer &Serializer()
+    {
+        static AnySerializer serializer;
+        static bool registered = false;
+
+        if (!registered)
+        {
+            serializer.Register<int>("int");
+            serializer.Register<Point>("Point");
+            serializer.Register<std::string>("string",
+                [](const std::string &text, std::vector<unsigned char> &out) { out.insert(out.end(), text.begin(), text.end()); },
+                [](const unsigned char *data, size_t size) { return std::optional<std::string>(std::string(reinterpret_cast<const char*>(data), size)); });
+            registered = true;
+        }
+
+        return serializer;
+    }
+
+    // unique per process so that concurrent runs don't share segments
+    std::string Name(const char *test)
+    {
+        return "/any_shm_test_" + std::to_string(::getpid()) + "_" + test;
+    }
+
+    void TestPushAndPop()
+    {
+        const std::string name = Name("push");
+        AnyShmRing ring(Serializer());
+
+        CHECK(ring.Create(name.c_str(), 1000));
+        CHECK(ring.Capacity() == 4096);
+
+        Any<16> any;
+        CHECK(ring.Pop(any) == AnyError::Empty);
+
+        CHECK(ring.Push(Any<16>(7)) == AnyError::None);
+        CHECK(ring.Push(Any<16>(Point{ 1, 2 })) == AnyError::None);
+        CHECK(ring.Push(Any<16>(std::string(100, 'z'))) == AnyError::None);
+        CHECK(ring.Push(Any<16>(std::string())) == AnyError::None);
+
+        CHECK(ring.Pop(any) == AnyError::None && any.Get<int>() == 7);
+        CHECK(ring.Pop(any) == AnyError::None && any.Get<Point>().y == 2);
+        CHECK(ring.Pop(any) == AnyError::None && any.Get<std::string>() == std::string(100, 'z'));
+        CHECK(ring.Pop(any) == AnyError::None && any.Get<std::string>().empty());
+        CHECK(ring.Pop(any) == AnyError::Empty);
+
+        CHECK(ring.Push(Any<16>()) == AnyError::Empty);
+        CHECK(ring.Push(Any<16>(1.5)) == AnyError::BadCast);
+
+        CHECK(AnyShmRing::Unlink(name.c_str()));
+    }
+
+    // records of varying sizes wrap around the end of the data many times, with padding records
+    void TestWraparound()
+    {
+        const std::string name = Name("wrap");
+        AnyShmRing ring(Serializer());
+
+        CHECK(ring.Create(name.c_str(), 4096));
+
+        bool same = true;
+        Any<16> any;
+
+        for (size_t i = 0; i < 2000; i++)
+        {
+            const std::string text(i % 700, static_cast<char>('a' + i % 26));
+
+            CHECK(ring.Push(Any<16>(text)) == AnyError::None);
+            CHECK(ring.Push(Any<16>(static_cast<int>(i))) == AnyError::None);
+
+            same = same && ring.Pop(any) == AnyError::None && any.Get<std::string>() == text;
+            same = same && ring.Pop(any) == AnyError::None && any.Get<int>() == static_cast<int>(i);
+        }
+
+        CHECK(same);
+        CHECK(ring.Pop(any) == AnyError::Empty);
+
+        AnyShmRing::Unlink(name.c_str());
+    }
+
+    void TestFullRing()
+    {
+        const std::string name = Name("full");
+        AnyShmRing ring(Serializer());
+
+        CHECK(ring.Create(name.c_str(), 4096));
+
+        const Any<16> text = std::string(1000, 'f');
+        int pushed = 0;
+
+        while (ring.Push(text) == AnyError::None)
+            pushed++;
+
+        CHECK(pushed == 4);
+        CHECK(ring.Push(text) == AnyError::OutOfMemory);
+
+        // a record larger than the ring never fits
+        CHECK(ring.Push(Any<16>(std::string(5000, 'g'))) == AnyError::OutOfMemory);
+
+        Any<16> any;
+        CHECK(ring.Pop(any) == AnyError::None);
+        CHECK(ring.Push(text) == AnyError::None);
+
+        AnyShmRing::Unlink(name.c_str());
+    }
+
+    // the consumer drops records of types it doesn't know and goes on with the next ones
+    void TestUnregisteredTypes()
+    {
+        const std::string name = Name("types");
+
+        AnySerializer producerTypes;
+        producerTypes.Register<int>("int");
+        producerTypes.Register<double>("double");
+
+        AnySerializer consumerTypes;
+        consumerTypes.Register<int>("int");
+
+        AnyShmRing producer(producerTypes);
+        AnyShmRing consumer(consumerTypes);
+
+        CHECK(!consumer.Open(name.c_str()));
+        CHECK(producer.Create(name.c_str(), 4096));
+        CHECK(consumer.Open(name.c_str()));
+
+        CHECK(producer.Push(Any<16>(2.5)) == AnyError::None);
+        CHECK(producer.Push(Any<16>(3)) == AnyError::None);
+
+        Any<16> any;
+        CHECK(consumer.Pop(any) == AnyError::BadCast);
+        CHECK(consumer.Pop(any) == AnyError::None && any.Get<int>() == 3);
+        CHECK(consumer.Pop(any) == AnyError::Empty);
+
+        AnyShmRing::Unlink(name.c_str());
+    }
+
+#if defined(ANY_SHM)
+    // the data of a segment mapped on its own, as another process could write it
+    struct Segment
+    {
+        explicit Segment(const std::string &name, size_t capacity) : size(DataOffset() + capacity)
+        {
+            const int descriptor = ::shm_open(name.c_str(), O_RDWR, 0600);
+
+            mapping = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+            ::close(descriptor);
+        }
+
+        ~Segment() { ::munmap(mapping, size); }
+
+        static size_t DataOffset()
+        {
+            return (sizeof(detail::ShmRingHeader) + ANY_CACHE_LINE_SIZE - 1) / ANY_CACHE_LINE_SIZE * ANY_CACHE_LINE_SIZE;
+        }
+
+        detail::ShmRecord *Record(size_t offset) const
+        {
+            return reinterpret_cast<detail::ShmRecord*>(static_cast<unsigned char*>(mapping) + DataOffset() + offset);
+        }
+
+        size_t size;
+        void *mapping;
+    };
+
+    // corrupt records are dropped instead of being read out of bounds
+    void TestCorruptRecords()
+    {
+        const std::string name = Name("corrupt");
+        AnyShmRing ring(Serializer());
+
+        CHECK(ring.Create(name.c_str(), 4096));
+
+        Segment segment(name, ring.Capacity());
+        Any<16> any;
+
+        CHECK(segment.mapping != MAP_FAILED);
+
+        // payload size beyond the record
+        CHECK(ring.Push(Any<16>(std::string(100, 'a'))) == AnyError::None);
+        CHECK(ring.Push(Any<16>(1)) == AnyError::None);
+
+        segment.Record(0)->size = 1 << 30;
+
+        CHECK(ring.Pop(any) == AnyError::Construction);
+        CHECK(ring.Pop(any) == AnyError::None && any.Get<int>() == 1);
+
+        // record length beyond the data: the following records can't be found anymore
+        const size_t offset = sizeof(detail::ShmRecord) + 104 + sizeof(detail::ShmRecord) + 8;
+
+        CHECK(ring.Push(Any<16>(2)) == AnyError::None);
+        CHECK(ring.Push(Any<16>(3)) == AnyError::None);
+
+        segment.Record(offset)->length.store(1 << 20);
+
+        CHECK(ring.Pop(any) == AnyError::Construction);
+        CHECK(ring.Pop(any) == AnyError::Empty);
+
+        // length shorter than a record header
+        CHECK(ring.Push(Any<16>(4)) == AnyError::None);
+
+        segment.Record(offset + 2 * (sizeof(detail::ShmRecord) + 8))->length.store(8);
+
+        CHECK(ring.Pop(any) == AnyError::Construction);
+
+        // the ring is usable again
+        CHECK(ring.Push(Any<16>(5)) == AnyError::None);
+        CHECK(ring.Pop(any) == AnyError::None && any.Get<int>() == 5);
+        CHECK(ring.Pop(any) == AnyError::Empty);
+
+        AnyShmRing::Unlink(name.c_str());
+    }
+#endif
+
+#if defined(__linux__)
+    // a child process produces, the parent consumes
+    void TestAcrossProcesses()
+    {
+        constexpr int COUNT = 100000;
+
+        const std::string name = Name("fork");
+        AnyShmRing ring(Serializer());
+
+        CHECK(ring.Create(name.c_str(), 4096));
+
+        const pid_t child = ::fork();
+
+        if (child == 0)
+        {
+            ::prctl(PR_SET_PDEATHSIG, SIGKILL);
+
+            AnyShmRing producer(Serializer());
+
+            if (!producer.Open(name.c_str()))
+                ::_exit(EXIT_FAILURE);
+
+            for (int i = 0; i < COUNT; i++)
+            {
+                const Any<16> value = i % 10 ? Any<16>(i) : Any<16>(std::to_string(i));
+
+                while (producer.Push(value) == AnyError::OutOfMemory)
+                    ;
+            }
+
+            ::_exit(EXIT_SUCCESS);
+        }
+
+        CHECK(child > 0);
+
+        bool ordered = true;
+        bool exited = false;   // the child can't push anymore, stop at the first empty ring
+        int status = 0;
+        Any<16> any;
+
+        for (int i = 0; i < COUNT && child > 0; i++)
+        {
+            AnyError error;
+
+            while ((error = ring.Pop(any)) == AnyError::Empty && !exited)
+                exited = ::waitpid(child, &status, WNOHANG) == child;
+
+            ordered = ordered && error == AnyError::None && (i % 10 ? any.Get<int>() == i : any.Get<std::string>() == std::to_string(i));
+        }
+
+        CHECK(exited || ::waitpid(child, &status, 0) == child);
+        CHECK(WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS);
+        CHECK(ordered);
+
+        AnyShmRing::Unlink(name.c_str());
+    }
+#endif
+}
+
+int main()
+{
+    TestPushAndPop();
+    TestWraparound();
+    TestFullRing();
+    TestUnregisteredTypes();
+#if defined(ANY_SHM)
+    TestCorruptRecords();
+#endif
+#if defined(__linux__)
+    TestAcrossProcesses();
+#endif
+
+    return CheckResult();
+}
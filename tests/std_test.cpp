@@ -0,0 +1,101 @@
+#include "any_std.hpp"
+#include "check.hpp"
+#include <string>
+#include <vector>
+
+namespace
+{
+    struct Document
+    {
+        std::string text;
+    };
+}
+
+template <>
+struct AnyStoragePolicy<Document> : std::integral_constant<AnyStorage, AnyStorage::Shared> {};
+
+namespace
+{
+    void TestRoundTrip()
+    {
+        std::any standard = std::string(100, 'a');
+        Any<8> any;
+
+        CHECK(FromStdAny<std::string>(std::move(standard), any) == AnyError::None);
+        CHECK(!standard.has_value());
+        CHECK(any.Get<std::string>().size() == 100);
+
+        CHECK(ToStdAny<std::string>(std::move(any), standard) == AnyError::None);
+        CHECK(!any);
+        CHECK(std::any_cast<std::string&>(standard).size() == 100);
+
+        CHECK(ToStdAny<int>(Any<8>(std::string()), standard) == AnyError::BadCast);
+        CHECK(ToStdAny<int>(Any<8>(), standard) == AnyError::Empty);
+    }
+
+    // a referenced object is copied, not moved from
+    void TestHandleIsCopied()
+    {
+        std::string text(50, 'b');
+        std::any standard;
+
+        CHECK(ToStdAny<std::string>(Any<8>(Handle<std::string>(text)), standard) == AnyError::None);
+        CHECK(text.size() == 50);
+        CHECK(std::any_cast<std::string&>(standard) == text);
+
+        AnyStdInterop interop;
+        interop.Register<std::string>();
+
+        CHECK(interop.ToStd(Any<8>(Handle<std::string>(text)), standard) == AnyError::None);
+        CHECK(text.size() == 50);
+    }
+
+    // the other owners of a shared object keep it
+    void TestSharedIsCopied()
+    {
+        Any<8> owner = Document{ std::string(60, 'c') };
+        Any<8> copy = owner;
+        std::any standard;
+
+        CHECK(!copy.OwnsObject());
+        CHECK(ToStdAny<Document>(std::move(copy), standard) == AnyError::None);
+        CHECK(owner.Get<Document>().text.size() == 60);
+
+        AnyStdInterop interop;
+        interop.Register<Document>();
+
+        copy = owner;
+        CHECK(interop.ToStd(std::move(copy), standard) == AnyError::None);
+        CHECK(owner.Get<Document>().text.size() == 60);
+        CHECK(std::any_cast<Document&>(standard).text.size() == 60);
+    }
+
+    void TestInterop()
+    {
+        AnyStdInterop interop;
+        interop.Register<std::vector<int>>();
+
+        std::any standard = std::vector<int>{ 1, 2, 3 };
+
+        CHECK(interop.Ref(standard).Type() == AnyTypeOf<std::vector<int>>());
+
+        Any<8> any;
+
+        CHECK(interop.FromStd(std::move(standard), any) == AnyError::None);
+        CHECK(any.Get<std::vector<int>>().size() == 3);
+        CHECK(interop.FromStd(std::any(1.5), any) == AnyError::BadCast);
+
+        CHECK(interop.ToStd(std::move(any), standard) == AnyError::None);
+        CHECK(std::any_cast<std::vector<int>&>(standard)[2] == 3);
+    }
+}
+
+int main()
+{
+    TestRoundTrip();
+    TestHandleIsCopied();
+    TestSharedIsCopied();
+    TestInterop();
+
+    return CheckResult();
+}
@@ -0,0 +1,155 @@
+#include "any.hpp"
+#include "check.hpp"
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    struct Small
+    {
+        long value;
+    };
+
+    struct Boxed
+    {
+        long value;
+    };
+
+    struct Big
+    {
+        std::string text;
+        char padding[64];
+    };
+
+    struct Exact
+    {
+        char bytes[16];
+    };
+
+    template <typename T>
+    bool IsInline(const Any<16> &any)
+    {
+        const unsigned char *object = reinterpret_cast<const unsigned char*>(&any.Get<T>());
+        const unsigned char *self = reinterpret_cast<const unsigned char*>(&any);
+
+        return object >= self && object < self + sizeof(any);
+    }
+}
+
+template <>
+struct AnyStoragePolicy<Small> : std::integral_constant<AnyStorage, AnyStorage::Inline> {};
+
+template <>
+struct AnyStoragePolicy<Boxed> : std::integral_constant<AnyStorage, AnyStorage::Heap> {};
+
+template <>
+struct AnyStoragePolicy<Big> : std::integral_constant<AnyStorage, AnyStorage::Shared> {};
+
+namespace
+{
+    void TestInlinePolicy()
+    {
+        Any<16> a = Small{ 1 };
+        Any<16> b = a;
+
+        b.Get<Small>().value = 2;
+
+        CHECK(IsInline<Small>(a));
+        CHECK(a.Get<Small>().value == 1);
+        CHECK(a.Footprint() == sizeof(Any<16>));
+    }
+
+    void TestHeapPolicy()
+    {
+        Any<16> a = Boxed{ 1 };
+        Any<16> b = a;
+
+        b.Get<Boxed>().value = 2;
+
+        CHECK(!IsInline<Boxed>(a));
+        CHECK(a.OwnsObject());
+        CHECK(a.Get<Boxed>().value == 1);
+        CHECK(a.Footprint() == sizeof(Any<16>) + sizeof(Boxed));
+
+        // the type-erased paths follow the policy
+        Any<16> c;
+        CHECK(c.Assign(AnyTypeOf<Boxed>(), &a.Get<Boxed>()) == AnyError::None);
+        CHECK(!IsInline<Boxed>(c) && c.Get<Boxed>().value == 1);
+    }
+
+    void TestSharedPolicy()
+    {
+        Any<16> a = Big{ "one", {} };
+        Any<16> b = a;
+
+        CHECK(!a.OwnsObject());
+        CHECK(&a.Get<Big>() == &b.Get<Big>());
+
+        // copies see the changes made through Get
+        b.Get<Big>().text = "changed";
+        CHECK(a.Get<Big>().text == "changed");
+
+        // an assignment replaces the object of the assigned Any only
+        b = Big{ "two", {} };
+        CHECK(a.Get<Big>().text == "changed");
+        CHECK(b.Get<Big>().text == "two");
+        CHECK(&a.Get<Big>() != &b.Get<Big>());
+
+        // type-erased copies get their own object
+        Any<16> c;
+        CHECK(c.Assign(a.Type(), a.Data()) == AnyError::None);
+        CHECK(&c.Get<Big>() != &a.Get<Big>() && c.Get<Big>().text == "changed");
+    }
+
+    // the last copy released from any thread destroys the object
+    void TestSharedAcrossThreads()
+    {
+        std::vector<std::thread> threads;
+
+        {
+            Any<16> shared = Big{ std::string(100, 's'), {} };
+
+            for (int t = 0; t < 4; t++)
+                threads.emplace_back([copy = shared]() mutable
+                {
+                    for (int i = 0; i < 1000; i++)
+                    {
+                        Any<16> local = copy;
+                        copy = local;
+                    }
+                });
+        }
+
+        for (std::thread &thread : threads)
+            thread.join();
+    }
+
+    // a type of exactly SIZE bytes fits the small buffer, whatever the path storing it
+    void TestTypeOfExactlySize()
+    {
+        Any<16> constructed = Exact{};
+        Any<16> assigned;
+        assigned = Exact{};
+        Any<16> emplaced;
+        emplaced.Emplace<Exact>();
+        Any<16> erased;
+        CHECK(erased.Assign(AnyTypeOf<Exact>(), &constructed.Get<Exact>()) == AnyError::None);
+
+        CHECK(IsInline<Exact>(constructed));
+        CHECK(IsInline<Exact>(assigned));
+        CHECK(IsInline<Exact>(emplaced));
+        CHECK(IsInline<Exact>(erased));
+    }
+}
+
+int main()
+{
+    TestInlinePolicy();
+    TestHeapPolicy();
+    TestSharedPolicy();
+    TestSharedAcrossThreads();
+    TestTypeOfExactlySize();
+
+    return CheckResult();
+}
@@ -0,0 +1,209 @@
+#include "tracked_any.hpp"
+#include "check.hpp"
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace
+{
+    struct Position
+    {
+        int x;
+        int y;
+    };
+
+    AnySerializer &Serializer()
+    {
+        static AnySerializer serializer;
+        static bool registered = false;
+
+        if (!registered)
+        {
+            serializer.Register<int>("int");
+            serializer.Register<Position>("Position");
+            registered = true;
+        }
+
+        return serializer;
+    }
+
+    void TestDeltaCarriesOnlyChanges()
+    {
+        TrackedAnyStore<16> source(Serializer());
+        TrackedAnyStore<16> replica(Serializer());
+
+        source.Add(1);
+        source.Add(Position{ 2, 3 });
+
+        std::vector<unsigned char> delta;
+
+        CHECK(source.SerializeDelta(delta));
+        CHECK(source.DirtyCount() == 0);
+        CHECK(replica.ApplyDelta(delta.data(), delta.size()));
+        CHECK(replica.Size() == 2);
+        CHECK(replica.Get<Position>(1).y == 3);
+
+        source.Get<Position>(1).x = 7;
+        CHECK(source.DirtyCount() == 1);
+
+        delta.clear();
+        CHECK(source.SerializeDelta(delta));
+        CHECK(replica.ApplyDelta(delta.data(), delta.size()));
+        CHECK(replica.Get<Position>(1).x == 7);
+        CHECK(replica.Get<int>(0) == 1);
+    }
+
+    // empty entries must not block the deltas
+    void TestEmptyEntries()
+    {
+        TrackedAnyStore<16> source(Serializer());
+        TrackedAnyStore<16> replica(Serializer());
+
+        source.Add(Any<16>());
+        source.Add(4);
+
+        std::vector<unsigned char> delta;
+
+        CHECK(source.SerializeDelta(delta));
+        CHECK(replica.ApplyDelta(delta.data(), delta.size()));
+        CHECK(!replica.Get(0));
+        CHECK(replica.Get<int>(1) == 4);
+
+        source.Erase(1);
+        source.Set(0, 5);
+
+        delta.clear();
+        CHECK(source.SerializeDelta(delta));
+        CHECK(replica.ApplyDelta(delta.data(), delta.size()));
+        CHECK(replica.Get<int>(0) == 5);
+        CHECK(!replica.Get(1));
+
+        source.Set(0, Any<16>());
+
+        delta.clear();
+        CHECK(source.SerializeDelta(delta));
+        CHECK(replica.ApplyDelta(delta.data(), delta.size()));
+        CHECK(!replica.Get(0));
+    }
+
+    void TestUnregisteredTypeFails()
+    {
+        TrackedAnyStore<16> source(Serializer());
+
+        source.Add(std::string("not registered"));
+
+        std::vector<unsigned char> delta;
+
+        CHECK(!source.SerializeDelta(delta));
+        CHECK(delta.empty());
+        CHECK(source.IsDirty(0));
+    }
+
+    void TestDiffHook()
+    {
+        TrackedAnyStore<16> source(Serializer());
+        TrackedAnyStore<16> replica(Serializer());
+
+        // sends only x
+        source.RegisterDiff<Position>(
+            [](const Position &previous, const Position &current, std::vector<unsigned char> &out)
+            {
+                if (previous.y != current.y)
+                    return false;
+
+                out.insert(out.end(), reinterpret_cast<const unsigned char*>(&current.x), reinterpret_cast<const unsigned char*>(&current.x + 1));
+                return true;
+            },
+            [](Position &, const unsigned char *, size_t) { return false; });
+        replica.RegisterDiff<Position>(
+            [](const Position &, const Position &, std::vector<unsigned char> &) { return false; },
+            [](Position &position, const unsigned char *data, size_t size)
+            {
+                if (size != sizeof(position.x))
+                    return false;
+
+                std::memcpy(&position.x, data, size);
+                return true;
+            });
+
+        source.Add(Position{ 1, 1 });
+
+        std::vector<unsigned char> delta;
+
+        CHECK(source.SerializeDelta(delta));
+        CHECK(replica.ApplyDelta(delta.data(), delta.size()));
+
+        source.Get<Position>(0).x = 9;
+
+        delta.clear();
+        CHECK(source.SerializeDelta(delta));
+        CHECK(delta.size() < sizeof(uint64_t) * 5 + sizeof(Position));
+        CHECK(replica.ApplyDelta(delta.data(), delta.size()));
+        CHECK(replica.Get<Position>(0).x == 9);
+    }
+
+    // a delta failing on a later entry must not count the earlier ones as sent
+    void TestFailedDeltaIsRetried()
+    {
+        AnySerializer serializer;
+        serializer.Register<int>("int");
+        serializer.Register<std::string>("string",
+            [](const std::string &text, std::vector<unsigned char> &out) { out.insert(out.end(), text.begin(), text.end()); },
+            [](const unsigned char *data, size_t size) { return std::optional<std::string>(std::string(reinterpret_cast<const char*>(data), size)); });
+
+        TrackedAnyStore<16> source(serializer);
+        TrackedAnyStore<16> replica(serializer);
+
+        // appends send only the new suffix
+        auto diff = [](const std::string &previous, const std::string &current, std::vector<unsigned char> &out)
+        {
+            if (current.compare(0, previous.size(), previous) != 0)
+                return false;
+
+            out.insert(out.end(), current.begin() + static_cast<std::ptrdiff_t>(previous.size()), current.end());
+            return true;
+        };
+        auto patch = [](std::string &text, const unsigned char *data, size_t size)
+        {
+            text.append(reinterpret_cast<const char*>(data), size);
+            return true;
+        };
+
+        source.RegisterDiff<std::string>(diff, patch);
+        replica.RegisterDiff<std::string>(diff, patch);
+
+        source.Add(std::string("abc"));
+        source.Add(1);
+
+        std::vector<unsigned char> delta;
+
+        CHECK(source.SerializeDelta(delta));
+        CHECK(replica.ApplyDelta(delta.data(), delta.size()));
+
+        source.Get<std::string>(0) += "def";
+        source.Set(1, 1.5);   // not registered
+
+        delta.clear();
+        CHECK(!source.SerializeDelta(delta));
+        CHECK(delta.empty());
+        CHECK(source.IsDirty(0) && source.IsDirty(1));
+
+        source.Set(1, 2);
+
+        CHECK(source.SerializeDelta(delta));
+        CHECK(replica.ApplyDelta(delta.data(), delta.size()));
+        CHECK(replica.Get<std::string>(0) == "abcdef");
+        CHECK(replica.Get<int>(1) == 2);
+    }
+}
+
+int main()
+{
+    TestDeltaCarriesOnlyChanges();
+    TestEmptyEntries();
+    TestUnregisteredTypeFails();
+    TestDiffHook();
+    TestFailedDeltaIsRetried();
+
+    return CheckResult();
+}
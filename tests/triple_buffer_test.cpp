@@ -0,0 +1,74 @@
+#include "triple_buffer_any.hpp"
+#include "check.hpp"
+#include <string>
+#include <thread>
+
+namespace
+{
+    struct Sample
+    {
+        long sequence;
+        long check;   // -sequence, a torn read would mix two samples
+    };
+
+    void TestLatestValue()
+    {
+        TripleBufferAny<16> buffer;
+
+        CHECK(!buffer.Read());
+        CHECK(!buffer.Update());
+
+        buffer.Publish(1);
+        buffer.Publish(2);
+
+        CHECK(buffer.Update());
+        CHECK(buffer.Front().Get<int>() == 2);
+        CHECK(!buffer.Update());
+        CHECK(buffer.Read().Get<int>() == 2);
+
+        buffer.Back() = std::string("in place");
+        buffer.Commit();
+
+        CHECK(buffer.Read().Get<std::string>() == "in place");
+    }
+
+    void TestConcurrentPublishing()
+    {
+        TripleBufferAny<16> buffer;
+        constexpr long COUNT = 200000;
+
+        std::thread writer([&]()
+        {
+            for (long i = 1; i <= COUNT; i++)
+                buffer.Publish(Sample{ i, -i });
+        });
+
+        long last = 0;
+        bool ordered = true;
+
+        while (last < COUNT)
+        {
+            const Any<16> &value = buffer.Read();
+
+            if (!value)
+                continue;
+
+            const Sample &sample = value.Get<Sample>();
+
+            ordered = ordered && sample.check == -sample.sequence && sample.sequence >= last;
+            last = sample.sequence;
+        }
+
+        writer.join();
+
+        CHECK(ordered);
+    }
+}
+
+int main()
+{
+    TestLatestValue();
+    TestConcurrentPublishing();
+
+    return CheckResult();
+}
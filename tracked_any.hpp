@@ -0,0 +1,282 @@
+#ifndef TRACKED_ANY_H
+#define TRACKED_ANY_H
+
+#include "any_serialization.hpp"
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * Change-tracked array of Any. Mutable access (non-const Get/TryGet, Set) marks an entry dirty
+ * and SerializeDelta writes only the entries changed since the previous delta. Types with a
+ * registered diff hook are written as a diff against the value sent in the previous delta.
+ *
+ * Delta layout (native byte order): count, then count records of
+ *   { index, kind (full, diff or empty), type id, size, bytes }
+ * where an empty record (id and size 0) stands for an entry emptied by Set or Erase.
+ */
+template <size_t SIZE>
+class TrackedAnyStore
+{
+public:
+    explicit TrackedAnyStore(const AnySerializer &serializer = AnySerializer::Default()) : mSerializer(serializer) {}
+
+    size_t Size() const { return mEntries.size(); }
+
+    size_t Add(Any<SIZE> any);
+
+    const Any<SIZE> &Get(size_t index) const { return mEntries[index].any; }
+
+    template <typename T>
+    const T &Get(size_t index) const { return mEntries[index].any.template Get<T>(); }
+
+    template <typename T>
+    T &Get(size_t index)
+    {
+        MarkDirty(index);
+
+        return mEntries[index].any.template Get<T>();
+    }
+
+    template <typename T>
+    T *TryGet(size_t index)
+    {
+        T *object = mEntries[index].any.template TryGet<T>();
+
+        if (object)
+            MarkDirty(index);
+
+        return object;
+    }
+
+    template <typename T>
+    void Set(size_t index, T &&object)
+    {
+        mEntries[index].any = std::forward<T>(object);
+
+        MarkDirty(index);
+    }
+
+    // empties the entry, the next delta erases it on the other side
+    void Erase(size_t index)
+    {
+        mEntries[index].any = Any<SIZE>();
+
+        MarkDirty(index);
+    }
+
+    bool IsDirty(size_t index) const { return mEntries[index].dirty; }
+    size_t DirtyCount() const { return mDirty.size(); }
+
+    /*
+     * diff(const T &previous, const T &current, std::vector<unsigned char> &out) -> bool appends a diff to out
+     * (false to send the whole value), patch(T &object, const unsigned char *data, size_t size) -> bool applies it.
+     */
+    template <typename T, typename Diff, typename Patch>
+    void RegisterDiff(Diff diff, Patch patch);
+
+    // appends the changed entries to out and clears the dirty marks, false if a type isn't registered
+    bool SerializeDelta(std::vector<unsigned char> &out);
+
+    // applies a delta produced by SerializeDelta (entries are created as needed), doesn't mark entries dirty
+    bool ApplyDelta(const unsigned char *data, size_t size);
+
+private:
+    enum Kind : unsigned char
+    {
+        FULL,
+        DIFF,
+        EMPTY
+    };
+
+    struct Record
+    {
+        uint64_t index;
+        uint64_t kind;
+        uint64_t id;
+        uint64_t size;
+    };
+
+    struct Entry
+    {
+        Any<SIZE> any;
+        Any<SIZE> sent;  // value sent in the previous delta, only kept for types with a diff hook
+        bool dirty = false;
+    };
+
+    struct DiffHooks
+    {
+        std::function<bool(const Any<SIZE> &previous, const Any<SIZE> &current, std::vector<unsigned char> &out)> diff;
+        std::function<bool(Any<SIZE> &object, const unsigned char *data, size_t size)> patch;
+    };
+
+    void MarkDirty(size_t index)
+    {
+        if (!mEntries[index].dirty)
+        {
+            mEntries[index].dirty = true;
+            mDirty.push_back(index);
+        }
+    }
+
+    const AnySerializer &mSerializer;
+
+    std::vector<Entry> mEntries;
+    std::vector<size_t> mDirty;
+
+    std::unordered_map<AnyType, DiffHooks> mDiffs;
+};
+
+template <size_t SIZE>
+size_t TrackedAnyStore<SIZE>::Add(Any<SIZE> any)
+{
+    mEntries.emplace_back();
+    mEntries.back().any = std::move(any);
+
+    MarkDirty(mEntries.size() - 1);
+
+    return mEntries.size() - 1;
+}
+
+template <size_t SIZE>
+template <typename T, typename Diff, typename Patch>
+void TrackedAnyStore<SIZE>::RegisterDiff(Diff diff, Patch patch)
+{
+    mDiffs[AnyTypeOf<T>()] = DiffHooks
+    {
+        [diff](const Any<SIZE> &previous, const Any<SIZE> &current, std::vector<unsigned char> &out)
+        {
+            return diff(previous.template Get<T>(), current.template Get<T>(), out);
+        },
+        [patch](Any<SIZE> &object, const unsigned char *data, size_t size)
+        {
+            return object.template Is<T>() && patch(object.template Get<T>(), data, size);
+        }
+    };
+}
+
+template <size_t SIZE>
+bool TrackedAnyStore<SIZE>::SerializeDelta(std::vector<unsigned char> &out)
+{
+    // nothing is written (nor marked as sent) unless every entry can be
+    for (size_t index : mDirty)
+    {
+        const Any<SIZE> &any = mEntries[index].any;
+
+        if (any && !mSerializer.Find(any.Type()))
+            return false;  // leave the dirty marks so the delta can be retried
+    }
+
+    const size_t start = out.size();
+    uint64_t count = mDirty.size();
+
+    out.resize(out.size() + sizeof(count));
+    std::memcpy(out.data() + start, &count, sizeof(count));
+
+    for (size_t index : mDirty)
+    {
+        Entry &entry = mEntries[index];
+
+        if (!entry.any)
+        {
+            const Record record{ index, EMPTY, 0, 0 };
+
+            out.resize(out.size() + sizeof(Record));
+            std::memcpy(out.data() + out.size() - sizeof(Record), &record, sizeof(Record));
+            continue;
+        }
+
+        const AnySerializer::Entry *serializable = mSerializer.Find(entry.any.Type());
+        const size_t recordOffset = out.size();
+        Record record{ index, FULL, serializable->id, 0 };
+
+        out.resize(out.size() + sizeof(Record));
+
+        auto hooks = mDiffs.find(entry.any.Type());
+
+        if (hooks != mDiffs.end() && entry.sent.Type() == entry.any.Type() && hooks->second.diff(entry.sent, entry.any, out))
+            record.kind = DIFF;
+        else
+        {
+            out.resize(recordOffset + sizeof(Record));  // drop a partial diff
+            serializable->serialize(entry.any.Data(), out);
+        }
+
+        record.size = out.size() - recordOffset - sizeof(Record);
+        std::memcpy(out.data() + recordOffset, &record, sizeof(Record));
+    }
+
+    for (size_t index : mDirty)
+    {
+        Entry &entry = mEntries[index];
+
+        // a deep copy: a shared payload would follow the later changes of the entry
+        if (entry.any && mDiffs.count(entry.any.Type()))
+            entry.sent.Assign(entry.any.Type(), entry.any.Data());
+        else
+            entry.sent = Any<SIZE>();
+
+        entry.dirty = false;
+    }
+
+    mDirty.clear();
+
+    return true;
+}
+
+template <size_t SIZE>
+bool TrackedAnyStore<SIZE>::ApplyDelta(const unsigned char *data, size_t size)
+{
+    uint64_t count;
+
+    if (size < sizeof(count))
+        return false;
+
+    std::memcpy(&count, data, sizeof(count));
+
+    size_t offset = sizeof(count);
+
+    for (uint64_t i = 0; i < count; i++)
+    {
+        Record record;
+
+        if (size - offset < sizeof(Record))
+            return false;
+
+        std::memcpy(&record, data + offset, sizeof(Record));
+        offset += sizeof(Record);
+
+        if (record.size > size - offset)
+            return false;
+
+        if (record.index >= mEntries.size())
+            mEntries.resize(static_cast<size_t>(record.index) + 1);
+
+        Entry &entry = mEntries[static_cast<size_t>(record.index)];
+        const unsigned char *bytes = data + offset;
+
+        if (record.kind == EMPTY)
+        {
+            if (record.size)
+                return false;
+
+            entry.any = Any<SIZE>();
+        }
+        else if (record.kind == DIFF)
+        {
+            const AnySerializer::Entry *serializable = mSerializer.Find(record.id);
+            auto hooks = serializable ? mDiffs.find(serializable->type) : mDiffs.end();
+
+            if (hooks == mDiffs.end() || !hooks->second.patch(entry.any, bytes, static_cast<size_t>(record.size)))
+                return false;
+        }
+        else if (mSerializer.Read(record.id, bytes, static_cast<size_t>(record.size), entry.any) != AnyError::None)
+            return false;
+
+        offset += static_cast<size_t>(record.size);
+    }
+
+    return true;
+}
+
+#endif  // TRACKED_ANY_H
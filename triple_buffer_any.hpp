@@ -0,0 +1,91 @@
+#ifndef TRIPLE_BUFFER_ANY_H
+#define TRIPLE_BUFFER_ANY_H
+
+#include "any.hpp"
+#include <atomic>
+
+/*
+ * Lock-free single producer/single consumer "latest value" publisher.
+ * The writer fills its back slot and swaps it with the middle slot, the reader swaps 
+ * the middle slot with its front slot when a new value is available. Slots are only 
+ * exchanged by index, so the writer never blocks, the reader always sees a complete 
+ * value and objects that fit the small buffer are never allocated.
+ */
+template <size_t SIZE>
+class TripleBufferAny
+{
+public:
+    TripleBufferAny() : mMiddle(1), mBack(2), mFront(0) {}
+
+    TripleBufferAny(const TripleBufferAny&) = delete;
+    TripleBufferAny &operator=(const TripleBufferAny&) = delete;
+
+    /**** writer ****/
+    template <typename T>
+    void Publish(T &&object);
+
+    // construct the next value in place and publish it with Commit
+    Any<SIZE> &Back() { return mSlots[mBack].any; }
+    void Commit();
+
+    /**** reader ****/
+    bool Update();  // returns true if a new value was acquired
+
+    const Any<SIZE> &Front() const { return mSlots[mFront].any; }
+
+    // latest published value (empty if nothing has been published yet)
+    const Any<SIZE> &Read()
+    {
+        Update();
+
+        return Front();
+    }
+
+private:
+    static constexpr unsigned char FRESH = 0x4;   // set in mMiddle when the middle slot contains an unread value
+    static constexpr unsigned char INDEX = 0x3;
+
+    struct alignas(ANY_CACHE_LINE_SIZE) Slot
+    {
+        Any<SIZE> any;
+    };
+
+    Slot mSlots[3];
+
+    alignas(ANY_CACHE_LINE_SIZE) std::atomic<unsigned char> mMiddle;
+
+    alignas(ANY_CACHE_LINE_SIZE) unsigned char mBack;    // owned by the writer
+    alignas(ANY_CACHE_LINE_SIZE) unsigned char mFront;   // owned by the reader
+};
+
+template <size_t SIZE>
+template <typename T>
+void TripleBufferAny<SIZE>::Publish(T &&object)
+{
+    mSlots[mBack].any = std::forward<T>(object);  // assigns in place if the slot already contains a T
+
+    Commit();
+}
+
+template <size_t SIZE>
+void TripleBufferAny<SIZE>::Commit()
+{
+    unsigned char previous = mMiddle.exchange(mBack | FRESH, std::memory_order_acq_rel);
+
+    mBack = previous & INDEX;
+}
+
+template <size_t SIZE>
+bool TripleBufferAny<SIZE>::Update()
+{
+    if (!(mMiddle.load(std::memory_order_relaxed) & FRESH))
+        return false;
+
+    unsigned char previous = mMiddle.exchange(mFront, std::memory_order_acq_rel);
+
+    mFront = previous & INDEX;
+
+    return true;
+}
+
+#endif  // TRIPLE_BUFFER_ANY_H